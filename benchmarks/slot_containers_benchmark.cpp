@@ -0,0 +1,1575 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+//
+// Microbenchmarks for slot_array and slot_map against the std containers they usually replace.
+// Built against Google Benchmark, with plf::colony as an extra baseline when <plf_colony.h> is on the include path:
+//
+//   g++ -std=c++17 -O2 -march=native -DNDEBUG slot_containers_benchmark.cpp -lbenchmark -lpthread -o slot_containers_benchmark
+//   ./slot_containers_benchmark --benchmark_format=json --benchmark_out=results.json
+//
+// Every benchmark works on a container of bench_capacity slots. Iteration benchmarks take the occupancy (in percent)
+// as their argument, and every benchmark is instantiated for several payload sizes so layout changes show up.
+// The large slot_map benchmarks report a cache_misses_per_op counter when the kernel exposes hardware counters
+// through perf_event_open (Linux only, may need kernel.perf_event_paranoid <= 2).
+#include <benchmark/benchmark.h>
+#include <cstdint>       // uint32_t, uint64_t
+#include <array>
+#include <memory>        // unique_ptr
+#include <random>        // mt19937
+#include <algorithm>     // shuffle
+#include <numeric>       // iota
+#include <unordered_map>
+#include <vector>
+#include <chrono>        // steady_clock
+#include <new>           // align_val_t
+#include <cstring>       // memcmp, memset
+#include <shared_mutex>  // shared_mutex, shared_lock
+#include "../slot_array.hpp"
+#include "../slot_map.hpp"
+#include "../parallel_for_each.hpp"
+#include "../tracked_slot_map.hpp"
+#include "../concurrent_slot_map.hpp"
+#include "../slot_pool.hpp"
+#include "../slot_map_join.hpp"
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__has_include)
+#if __has_include(<plf_colony.h>)
+#include <plf_colony.h>
+#define ADL_BENCH_HAS_COLONY 1
+#endif
+#endif
+
+namespace
+{
+  const unsigned bench_capacity = 16384u;
+
+  /*
+  * @brief A trivially copyable payload of _Bytes bytes. The first word is read by every iteration benchmark.
+  */
+  template<unsigned _Bytes>
+  struct payload
+  {
+    static_assert(_Bytes >= sizeof(uint64_t) && _Bytes % sizeof(uint64_t) == 0u, "Payloads are made of whole 64 bit words.");
+    payload() = default;
+    explicit payload(uint64_t value) : words{ value } {}
+    uint64_t words[_Bytes / sizeof(uint64_t)];
+  };
+
+  template<typename T>
+  using bench_array = ADL::slot_array<T, bench_capacity>;
+
+  template<typename T>
+  using bench_map = slot_map<T>;
+
+  // Returns the indices 0..count-1 in a fixed pseudo-random order, so runs are comparable.
+  std::vector<unsigned> shuffled_indices(unsigned count)
+  {
+    std::vector<unsigned> indices(count);
+    std::iota(indices.begin(), indices.end(), 0u);
+    std::shuffle(indices.begin(), indices.end(), std::mt19937{ 1337u });
+    return indices;
+  }
+
+  // Number of live objects for an occupancy given in percent.
+  unsigned live_count(const benchmark::State &state)
+  {
+    return static_cast<unsigned>(bench_capacity * state.range(0) / 100);
+  }
+
+  /*
+  * @brief The pool most code uses before switching to a slot_array: a vector of objects with generation counters
+  * and a LIFO free list of indices. Handles are index in the low 32 bits and generation in the high bits.
+  */
+  template<typename T>
+  class vector_pool
+  {
+  public:
+    using id_type = uint64_t;
+
+    explicit vector_pool(unsigned capacity)
+      : m_objects(capacity), m_generations(capacity, 0u), m_alive(capacity, false)
+    {
+      m_free.reserve(capacity);
+      for (unsigned i{ capacity }; i > 0u; --i)
+      {
+        m_free.push_back(i - 1u);
+      }
+    }
+
+    id_type alloc(const T &value)
+    {
+      const uint32_t index{ m_free.back() };
+      m_free.pop_back();
+      m_objects[index] = value;
+      m_alive[index] = true;
+      return ( id_type{ m_generations[index] } << 32 ) | index;
+    }
+
+    void free(id_type ID)
+    {
+      const uint32_t index{ static_cast<uint32_t>(ID) };
+      m_alive[index] = false;
+      ++m_generations[index];
+      m_free.push_back(index);
+    }
+
+    T* get_safely(id_type ID)
+    {
+      const uint32_t index{ static_cast<uint32_t>(ID) };
+      if (index >= m_objects.size() || !m_alive[index] || m_generations[index] != static_cast<uint32_t>(ID >> 32))
+      {
+        return nullptr;
+      }
+      return &m_objects[index];
+    }
+
+    template<typename Function>
+    void for_each(Function f)
+    {
+      for (size_t i{ 0u }; i < m_objects.size(); ++i)
+      {
+        if (m_alive[i])
+        {
+          f(m_objects[i]);
+        }
+      }
+    }
+
+  private:
+    std::vector<T> m_objects;
+    std::vector<uint32_t> m_generations;
+    std::vector<bool> m_alive;
+    std::vector<uint32_t> m_free;
+  };
+
+  // Leaves a slot_array holding live_count objects spread over all of its slots, and returns their IDs.
+  template<typename T>
+  std::vector<typename bench_array<T>::id_type> fill_array(bench_array<T> &array, unsigned live)
+  {
+    using id_type = typename bench_array<T>::id_type;
+    std::vector<id_type> IDs(bench_capacity);
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      IDs[i] = array.get_ID(array.alloc(T{ i }));
+    }
+    std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (unsigned i{ live }; i < bench_capacity; ++i)
+    {
+      array.free(array.get(IDs[order[i]]));
+    }
+    std::vector<id_type> live_IDs;
+    live_IDs.reserve(live);
+    for (unsigned i{ 0u }; i < live; ++i)
+    {
+      live_IDs.push_back(IDs[order[i]]);
+    }
+    return live_IDs;
+  }
+
+#pragma region alloc_free
+
+  // Allocates a full container worth of objects and frees them in random order.
+  template<typename T>
+  void BM_slot_array_alloc_free(benchmark::State &state)
+  {
+    auto array{ std::make_unique<bench_array<T>>() };
+    std::vector<T*> objects(bench_capacity);
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        objects[i] = &array->alloc(T{ i });
+      }
+      for (unsigned i : order)
+      {
+        array->free(*objects[i]);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  template<typename T>
+  void BM_slot_array_alloc_free_n(benchmark::State &state)
+  {
+    auto array{ std::make_unique<bench_array<T>>() };
+    std::vector<typename bench_array<T>::id_type> IDs(bench_capacity);
+    for (auto _ : state)
+    {
+      array->alloc_n(bench_capacity, [](unsigned i) { return T{ i }; }, IDs.data());
+      array->free_n(IDs.data(), bench_capacity);
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  template<typename T>
+  void BM_vector_pool_alloc_free(benchmark::State &state)
+  {
+    vector_pool<T> pool{ bench_capacity };
+    std::vector<uint64_t> IDs(bench_capacity);
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        IDs[i] = pool.alloc(T{ i });
+      }
+      for (unsigned i : order)
+      {
+        pool.free(IDs[i]);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  template<typename T>
+  void BM_unordered_map_insert_erase(benchmark::State &state)
+  {
+    std::unordered_map<uint64_t, T> map;
+    map.reserve(bench_capacity);
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        map.emplace(i, T{ i });
+      }
+      for (unsigned i : order)
+      {
+        map.erase(i);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+#ifdef ADL_BENCH_HAS_COLONY
+  template<typename T>
+  void BM_colony_insert_erase(benchmark::State &state)
+  {
+    plf::colony<T> colony;
+    colony.reserve(bench_capacity);
+    std::vector<typename plf::colony<T>::iterator> positions(bench_capacity);
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        positions[i] = colony.insert(T{ i });
+      }
+      for (unsigned i : order)
+      {
+        colony.erase(positions[i]);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+#endif
+
+#pragma endregion
+
+#pragma region cache_misses
+
+  /*
+  * @brief Counts last level cache misses of the calling thread while it is running. Disabled when the hardware
+  * counter can't be opened, in which case no counter is reported.
+  */
+  class cache_miss_counter
+  {
+  public:
+    cache_miss_counter()
+    {
+#if defined(__linux__)
+      perf_event_attr attributes;
+      std::memset(&attributes, 0, sizeof(attributes));
+      attributes.size = sizeof(attributes);
+      attributes.type = PERF_TYPE_HARDWARE;
+      attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+      attributes.disabled = 1;
+      attributes.exclude_kernel = 1;
+      attributes.exclude_hv = 1;
+      m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+    }
+    cache_miss_counter(const cache_miss_counter &) = delete;
+    cache_miss_counter& operator=(const cache_miss_counter &) = delete;
+    ~cache_miss_counter()
+    {
+#if defined(__linux__)
+      if (m_fd >= 0)
+      {
+        close(m_fd);
+      }
+#endif
+    }
+
+    bool enabled() const { return m_fd >= 0; }
+
+    void start()
+    {
+#if defined(__linux__)
+      if (enabled())
+      {
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+    }
+
+    void stop()
+    {
+#if defined(__linux__)
+      if (enabled())
+      {
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+#endif
+    }
+
+    uint64_t read() const
+    {
+      uint64_t count{ 0u };
+#if defined(__linux__)
+      if (enabled() && ::read(m_fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count)))
+      {
+        count = 0u;
+      }
+#endif
+      return count;
+    }
+
+    // Reports the misses counted so far divided by the number of operations the benchmark performed.
+    void report(benchmark::State &state, int64_t operations) const
+    {
+      if (enabled() && operations > 0)
+      {
+        state.counters["cache_misses_per_op"] = static_cast<double>(read()) / static_cast<double>(operations);
+      }
+    }
+
+  private:
+    int m_fd{ -1 };
+  };
+
+#pragma endregion
+
+#pragma region lookup
+
+  // Looks up every live object once per iteration in random order.
+  template<typename T>
+  void BM_slot_array_get(benchmark::State &state)
+  {
+    auto array{ std::make_unique<bench_array<T>>() };
+    const auto IDs{ fill_array(*array, live_count(state)) };
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (auto ID : IDs)
+      {
+        sum += array->get(ID).words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * IDs.size());
+  }
+
+  template<typename T>
+  void BM_slot_array_get_safely(benchmark::State &state)
+  {
+    auto array{ std::make_unique<bench_array<T>>() };
+    const auto IDs{ fill_array(*array, live_count(state)) };
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (auto ID : IDs)
+      {
+        sum += array->get_safely(ID)->words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * IDs.size());
+  }
+
+  template<typename T>
+  void BM_vector_pool_get_safely(benchmark::State &state)
+  {
+    vector_pool<T> pool{ bench_capacity };
+    std::vector<uint64_t> IDs(bench_capacity);
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      IDs[i] = pool.alloc(T{ i });
+    }
+    std::shuffle(IDs.begin(), IDs.end(), std::mt19937{ 1337u });
+    for (unsigned i{ live_count(state) }; i < bench_capacity; ++i)
+    {
+      pool.free(IDs[i]);
+    }
+    IDs.resize(live_count(state));
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (auto ID : IDs)
+      {
+        sum += pool.get_safely(ID)->words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * IDs.size());
+  }
+
+  template<typename T>
+  void BM_unordered_map_find(benchmark::State &state)
+  {
+    std::unordered_map<uint64_t, T> map;
+    std::vector<uint64_t> IDs;
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (unsigned i{ 0u }; i < live_count(state); ++i)
+    {
+      map.emplace(order[i], T{ i });
+      IDs.push_back(order[i]);
+    }
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (auto ID : IDs)
+      {
+        sum += map.find(ID)->second.words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * IDs.size());
+  }
+
+#pragma endregion
+
+#pragma region iteration
+
+  // Visits every live object once per iteration.
+  template<typename T>
+  void BM_slot_array_iterate(benchmark::State &state)
+  {
+    auto array{ std::make_unique<bench_array<T>>() };
+    fill_array(*array, live_count(state));
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (T &object : *array)
+      {
+        sum += object.words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * array->size());
+  }
+
+  template<typename T>
+  void BM_vector_pool_iterate(benchmark::State &state)
+  {
+    vector_pool<T> pool{ bench_capacity };
+    std::vector<uint64_t> IDs(bench_capacity);
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      IDs[i] = pool.alloc(T{ i });
+    }
+    std::shuffle(IDs.begin(), IDs.end(), std::mt19937{ 1337u });
+    for (unsigned i{ live_count(state) }; i < bench_capacity; ++i)
+    {
+      pool.free(IDs[i]);
+    }
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      pool.for_each([&sum](const T &object) { sum += object.words[0]; });
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * live_count(state));
+  }
+
+  template<typename T>
+  void BM_slot_map_iterate(benchmark::State &state)
+  {
+    bench_map<T> map;
+    for (unsigned i{ 0u }; i < live_count(state); ++i)
+    {
+      map.emplace(i);
+    }
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (const T &object : map)
+      {
+        sum += object.words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+  }
+
+  template<typename T>
+  void BM_unordered_map_iterate(benchmark::State &state)
+  {
+    std::unordered_map<uint64_t, T> map;
+    for (unsigned i{ 0u }; i < live_count(state); ++i)
+    {
+      map.emplace(i, T{ i });
+    }
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (const auto &entry : map)
+      {
+        sum += entry.second.words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+  }
+
+#ifdef ADL_BENCH_HAS_COLONY
+  template<typename T>
+  void BM_colony_iterate(benchmark::State &state)
+  {
+    plf::colony<T> colony;
+    std::vector<typename plf::colony<T>::iterator> positions(bench_capacity);
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      positions[i] = colony.insert(T{ i });
+    }
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (unsigned i{ live_count(state) }; i < bench_capacity; ++i)
+    {
+      colony.erase(positions[order[i]]);
+    }
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (const T &object : colony)
+      {
+        sum += object.words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * colony.size());
+  }
+#endif
+
+#pragma endregion
+
+#pragma region slot_map
+
+  template<typename T>
+  void BM_slot_map_insert_erase(benchmark::State &state)
+  {
+    bench_map<T> map;
+    map.reserve(bench_capacity);
+    std::vector<typename bench_map<T>::key_type> keys(bench_capacity);
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        keys[i] = map.insert(T{ i });
+      }
+      for (unsigned i : order)
+      {
+        map.erase(keys[i]);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  template<typename T>
+  void BM_slot_map_emplace_erase(benchmark::State &state)
+  {
+    bench_map<T> map;
+    map.reserve(bench_capacity);
+    std::vector<typename bench_map<T>::key_type> keys(bench_capacity);
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        keys[i] = map.emplace(i);
+      }
+      for (unsigned i : order)
+      {
+        map.erase(keys[i]);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  template<typename T>
+  void BM_slot_map_emplace_n(benchmark::State &state)
+  {
+    std::vector<typename bench_map<T>::key_type> keys(bench_capacity);
+    for (auto _ : state)
+    {
+      bench_map<T> map;
+      map.emplace_n(bench_capacity, [](unsigned i) { return T{ i }; }, keys.begin());
+      benchmark::DoNotOptimize(keys.data());
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  // Inserts a full container worth of objects and erases them in contiguous runs of the argument's size.
+  template<typename T>
+  void BM_slot_map_erase_range(benchmark::State &state)
+  {
+    bench_map<T> map;
+    map.reserve(bench_capacity);
+    const auto run{ static_cast<unsigned>(state.range(0)) };
+    for (auto _ : state)
+    {
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        map.emplace(i);
+      }
+      while (!map.empty())
+      {
+        const unsigned count{ std::min<unsigned>(run, map.size()) };
+        map.erase(map.begin() + ( map.size() - count ) / 2u, map.begin() + ( map.size() - count ) / 2u + count);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  // Fills a slot_map to the requested occupancy of bench_capacity keys and returns the live keys in random order.
+  template<typename T>
+  std::vector<typename bench_map<T>::key_type> fill_map(bench_map<T> &map, unsigned live)
+  {
+    std::vector<typename bench_map<T>::key_type> keys(bench_capacity);
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      keys[i] = map.emplace(i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ 1337u });
+    for (unsigned i{ live }; i < bench_capacity; ++i)
+    {
+      map.erase(keys[i]);
+    }
+    keys.resize(live);
+    return keys;
+  }
+
+  template<typename T>
+  void BM_slot_map_find(benchmark::State &state)
+  {
+    bench_map<T> map;
+    const auto keys{ fill_map(map, live_count(state)) };
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (const auto &key : keys)
+      {
+        sum += map.find(key)->words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+  }
+
+  template<typename T>
+  void BM_slot_map_find_unchecked(benchmark::State &state)
+  {
+    bench_map<T> map;
+    const auto keys{ fill_map(map, live_count(state)) };
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (const auto &key : keys)
+      {
+        sum += map.find_unchecked(key).words[0];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+  }
+
+  // Validates a batch of keys, a quarter of them stale, with find() one at a time and with validate().
+  template<bool _Batched>
+  void BM_slot_map_validate(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<16>>;
+    map_type map;
+    std::vector<typename map_type::key_type> keys(bench_capacity);
+    map.emplace_n(bench_capacity, [](unsigned i) { return payload<16>{ i }; }, keys.begin());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ 1337u });
+    for (unsigned i{ 0u }; i < bench_capacity / 4u; ++i)
+    {
+      map.erase(keys[i]);
+      map.emplace(i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ 7u });
+    std::vector<uint64_t> valid(( keys.size() + 63u ) / 64u);
+    for (auto _ : state)
+    {
+      if (_Batched)
+      {
+        map.validate(keys.data(), static_cast<map_type::size_type>(keys.size()), valid.data());
+      }
+      else
+      {
+        for (size_t i{ 0u }; i < keys.size(); ++i)
+        {
+          if (map.find(keys[i]) != map.end())
+          {
+            valid[i / 64u] |= uint64_t{ 1 } << ( i % 64u );
+          }
+          else
+          {
+            valid[i / 64u] &= ~( uint64_t{ 1 } << ( i % 64u ) );
+          }
+        }
+      }
+      benchmark::DoNotOptimize(valid.data());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+  }
+
+  template<bool _Batched>
+  void BM_slot_array_validate(benchmark::State &state)
+  {
+    using array_type = bench_array<payload<16>>;
+    auto array{ std::make_unique<array_type>() };
+    auto IDs{ fill_array(*array, bench_capacity) };
+    for (unsigned i{ 0u }; i < bench_capacity / 4u; ++i)
+    {
+      array->free(array->get(IDs[i]));
+      array->alloc(payload<16>{ i });
+    }
+    std::shuffle(IDs.begin(), IDs.end(), std::mt19937{ 7u });
+    std::vector<uint64_t> valid(( IDs.size() + 63u ) / 64u);
+    for (auto _ : state)
+    {
+      if (_Batched)
+      {
+        array->validate(IDs.data(), static_cast<unsigned>(IDs.size()), valid.data());
+      }
+      else
+      {
+        for (size_t i{ 0u }; i < IDs.size(); ++i)
+        {
+          if (array->get_safely(IDs[i]))
+          {
+            valid[i / 64u] |= uint64_t{ 1 } << ( i % 64u );
+          }
+          else
+          {
+            valid[i / 64u] &= ~( uint64_t{ 1 } << ( i % 64u ) );
+          }
+        }
+      }
+      benchmark::DoNotOptimize(valid.data());
+    }
+    state.SetItemsProcessed(state.iterations() * IDs.size());
+  }
+
+#pragma endregion
+
+#pragma region soa
+
+  struct particle
+  {
+    float position[4];
+    float velocity[4];
+    float color[4];
+    uint64_t flags;
+  };
+
+  // Integrates positions of every particle, touching two of the three arrays of floats.
+  void BM_slot_map_aos_integrate(benchmark::State &state)
+  {
+    slot_map<particle> map;
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      map.insert(particle{ { float(i) }, { 1.f }, { 0.f }, i });
+    }
+    for (auto _ : state)
+    {
+      for (particle &p : map)
+      {
+        p.position[0] += p.velocity[0];
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+  }
+
+  void BM_slot_map_soa_integrate(benchmark::State &state)
+  {
+    using vec4 = std::array<float, 4>;
+    slot_map<soa<vec4, vec4, vec4, uint64_t>> map;
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      map.emplace(vec4{ float(i) }, vec4{ 1.f }, vec4{ 0.f }, uint64_t{ i });
+    }
+    for (auto _ : state)
+    {
+      auto positions{ map.column<0>() };
+      auto velocities{ map.column<1>() };
+      for (size_t i{ 0u }; i < positions.size(); ++i)
+      {
+        positions[i][0] += velocities[i][0];
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+  }
+
+#pragma endregion
+
+#pragma region layout
+
+  template<typename T, typename Layout>
+  using layout_map = slot_map<T, std::pair<unsigned, unsigned>, std::vector, Layout>;
+
+  const unsigned large_map_size = 10000000u;
+  const unsigned large_map_batch = 1u << 20;
+
+  // Random lookups into a map of large_map_size elements, which is far larger than the last level cache.
+  template<typename Layout>
+  void BM_slot_map_large_find(benchmark::State &state)
+  {
+    layout_map<payload<16>, Layout> map;
+    std::vector<typename layout_map<payload<16>, Layout>::key_type> keys(large_map_size);
+    map.emplace_n(large_map_size, [](unsigned i) { return payload<16>{ i }; }, keys.begin());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ 1337u });
+    keys.resize(large_map_batch);
+    cache_miss_counter misses;
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      misses.start();
+      for (const auto &key : keys)
+      {
+        sum += map.find(key)->words[0];
+      }
+      misses.stop();
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+    misses.report(state, state.iterations() * static_cast<int64_t>(keys.size()));
+  }
+
+  // Erases a random element and inserts a replacement, so the size stays at large_map_size.
+  template<typename Layout>
+  void BM_slot_map_large_erase_insert(benchmark::State &state)
+  {
+    layout_map<payload<16>, Layout> map;
+    std::vector<typename layout_map<payload<16>, Layout>::key_type> keys(large_map_size);
+    map.emplace_n(large_map_size, [](unsigned i) { return payload<16>{ i }; }, keys.begin());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ 1337u });
+    cache_miss_counter misses;
+    size_t next{ 0u };
+    for (auto _ : state)
+    {
+      misses.start();
+      for (unsigned i{ 0u }; i < large_map_batch; ++i, ++next)
+      {
+        auto &key{ keys[next % keys.size()] };
+        map.erase(key);
+        key = map.emplace(static_cast<uint64_t>(i));
+      }
+      misses.stop();
+    }
+    state.SetItemsProcessed(state.iterations() * large_map_batch);
+    misses.report(state, state.iterations() * static_cast<int64_t>(large_map_batch));
+  }
+
+  // Batched random lookups into a large map, one key at a time and through find_many().
+  template<bool _Batched>
+  void BM_slot_map_large_lookup(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<16>>;
+    map_type map;
+    std::vector<map_type::key_type> keys(large_map_size);
+    map.emplace_n(large_map_size, [](unsigned i) { return payload<16>{ i }; }, keys.begin());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ 1337u });
+    keys.resize(large_map_batch);
+    std::vector<payload<16>*> found(keys.size());
+    for (auto _ : state)
+    {
+      if (_Batched)
+      {
+        map.find_many(keys.data(), static_cast<map_type::size_type>(keys.size()), found.data());
+      }
+      else
+      {
+        for (size_t i{ 0u }; i < keys.size(); ++i)
+        {
+          auto it{ map.find(keys[i]) };
+          found[i] = it != map.end() ? &*it : nullptr;
+        }
+      }
+      benchmark::DoNotOptimize(found.data());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+  }
+
+  // Batched random lookups into a slot_array of 4M slots, through get_safely() and get_many().
+  template<bool _Batched, typename Layout>
+  void BM_slot_array_large_lookup(benchmark::State &state)
+  {
+    using array_type = ADL::slot_array<payload<64>, ( 1u << 22 ), true, Layout, ADL::slot_key_64>;
+    auto array{ std::make_unique<array_type>() };
+    std::vector<typename array_type::id_type> IDs(array->capacity());
+    array->alloc_n(array->capacity(), [](unsigned i) { return payload<64>{ i }; }, IDs.data());
+    std::shuffle(IDs.begin(), IDs.end(), std::mt19937{ 1337u });
+    IDs.resize(large_map_batch);
+    std::vector<payload<64>*> found(IDs.size());
+    for (auto _ : state)
+    {
+      if (_Batched)
+      {
+        array->get_many(IDs.data(), static_cast<unsigned>(IDs.size()), found.data());
+      }
+      else
+      {
+        for (size_t i{ 0u }; i < IDs.size(); ++i)
+        {
+          found[i] = array->get_safely(IDs[i]);
+        }
+      }
+      benchmark::DoNotOptimize(found.data());
+    }
+    state.SetItemsProcessed(state.iterations() * IDs.size());
+  }
+
+  // Random get_safely() lookups of the same 4M objects in one slot_array and in a slot_pool of 64k object blocks,
+  // which pays one block table lookup per ID on top of the slot_array lookup.
+  template<bool _Pooled>
+  void BM_slot_pool_large_lookup(benchmark::State &state)
+  {
+    using array_type = ADL::slot_array<payload<64>, ( 1u << 22 ), true, ADL::slot_layout::in_place, ADL::slot_key_64>;
+    using pool_type = ADL::slot_pool<payload<64>, 65534u>;
+    using container_type = typename std::conditional<_Pooled, pool_type, array_type>::type;
+    auto container{ std::make_unique<container_type>() };
+    std::vector<typename container_type::id_type> IDs;
+    IDs.reserve(1u << 22);
+    for (unsigned i{ 0u }; i < ( 1u << 22 ) - 1u; ++i)
+    {
+      IDs.push_back(container->get_ID(container->alloc(payload<64>{ i })));
+    }
+    std::shuffle(IDs.begin(), IDs.end(), std::mt19937{ 1337u });
+    IDs.resize(large_map_batch);
+    std::vector<payload<64>*> found(IDs.size());
+    for (auto _ : state)
+    {
+      for (size_t i{ 0u }; i < IDs.size(); ++i)
+      {
+        found[i] = container->get_safely(IDs[i]);
+      }
+      benchmark::DoNotOptimize(found.data());
+    }
+    state.SetItemsProcessed(state.iterations() * IDs.size());
+  }
+
+  // Grows a map from empty to large_map_size / 4 elements, reporting the slowest single insertion.
+  // The vector backed map moves every element when it crosses a power of two, the paged map only appends pages.
+  template<template<typename...> typename Container>
+  void BM_slot_map_growth(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<64>, std::pair<unsigned, unsigned>, Container>;
+    double worst_ns{ 0.0 };
+    for (auto _ : state)
+    {
+      map_type map;
+      for (unsigned i{ 0u }; i < large_map_size / 4u; ++i)
+      {
+        const auto start{ std::chrono::steady_clock::now() };
+        benchmark::DoNotOptimize(map.emplace(static_cast<uint64_t>(i)));
+        const std::chrono::duration<double, std::nano> elapsed{ std::chrono::steady_clock::now() - start };
+        worst_ns = std::max(worst_ns, elapsed.count());
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * ( large_map_size / 4u ));
+    state.counters["worst_insert_us"] = worst_ns / 1000.0;
+  }
+
+#pragma endregion
+
+#pragma region parallel
+
+  // Updates every element of a large map through parallel_for_each, Arg is the number of worker threads.
+  void BM_slot_map_parallel_for_each(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<64>>;
+    map_type map;
+    std::vector<map_type::key_type> keys(large_map_size / 4u);
+    map.emplace_n(keys.size(), [](unsigned i) { return payload<64>{ i }; }, keys.begin());
+    const ADL::thread_scheduler scheduler{ static_cast<unsigned>(state.range(0)) };
+    for (auto _ : state)
+    {
+      ADL::parallel_for_each(scheduler, map, [](payload<64> &p) { p.words[1] += p.words[0] * 3u; }, 16384u);
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+  }
+
+  // Updates every live object of a half full slot_array of 4M slots, Arg is the number of worker threads.
+  void BM_slot_array_parallel_for_each(benchmark::State &state)
+  {
+    using array_type = ADL::slot_array<payload<64>, ( 1u << 22 ), true, ADL::slot_layout::in_place, ADL::slot_key_64>;
+    auto array{ std::make_unique<array_type>() };
+    std::vector<array_type::id_type> IDs(array->capacity());
+    array->alloc_n(array->capacity(), [](unsigned i) { return payload<64>{ i }; }, IDs.data());
+    for (size_t i{ 0u }; i < IDs.size(); i += 2u)
+    {
+      array->free(array->get(IDs[i]));
+    }
+    const ADL::thread_scheduler scheduler{ static_cast<unsigned>(state.range(0)) };
+    for (auto _ : state)
+    {
+      ADL::parallel_for_each(scheduler, *array, [](payload<64> &p) { p.words[1] += p.words[0] * 3u; }, 16384u);
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * array->size());
+  }
+
+#pragma endregion
+
+#pragma region concurrent_reads
+
+  // Random lookups from every benchmark thread into one shared map of bench_capacity elements, 64 keys per
+  // read section or shared lock.
+  const unsigned lookups_per_section = 64u;
+
+  std::vector<std::pair<unsigned, unsigned>> shuffled_keys(std::vector<std::pair<unsigned, unsigned>> keys, unsigned seed)
+  {
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ seed });
+    return keys;
+  }
+
+  void BM_concurrent_slot_map_find(benchmark::State &state)
+  {
+    using map_type = concurrent_slot_map<payload<64>>;
+    static map_type map;
+    static const std::vector<map_type::key_type> keys{ []
+    {
+      std::vector<map_type::key_type> result;
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        result.push_back(map.emplace(payload<64>{ i }));
+      }
+      return result;
+    }() };
+    const std::vector<map_type::key_type> order{ shuffled_keys(keys, 1337u + static_cast<unsigned>(state.thread_index())) };
+    map_type::reader reader{ map };
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (unsigned i{ 0u }; i < bench_capacity; i += lookups_per_section)
+      {
+        map_type::read_section section{ reader };
+        for (unsigned j{ i }; j < i + lookups_per_section; ++j)
+        {
+          sum += section.find(order[j])->words[0];
+        }
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  // The same lookups into a slot_map behind a reader-writer lock.
+  void BM_shared_mutex_slot_map_find(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<64>>;
+    static map_type map;
+    static std::shared_mutex mutex;
+    static const std::vector<map_type::key_type> keys{ []
+    {
+      std::vector<map_type::key_type> result(bench_capacity);
+      map.emplace_n(bench_capacity, [](unsigned i) { return payload<64>{ i }; }, result.begin());
+      return result;
+    }() };
+    const std::vector<map_type::key_type> order{ shuffled_keys(keys, 1337u + static_cast<unsigned>(state.thread_index())) };
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (unsigned i{ 0u }; i < bench_capacity; i += lookups_per_section)
+      {
+        std::shared_lock<std::shared_mutex> lock{ mutex };
+        for (unsigned j{ i }; j < i + lookups_per_section; ++j)
+        {
+          sum += map.find(order[j])->words[0];
+        }
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+#pragma endregion
+
+#pragma region locality
+
+  // Visits the elements of a churned map in insertion order through their keys, as a traversal which follows
+  // another structure would. Arg 1 sorts the map by insertion order first, which keeps every key valid.
+  void BM_slot_map_sorted_traversal(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<64>>;
+    map_type map;
+    const unsigned count{ large_map_size / 8u };
+    std::vector<map_type::key_type> keys(count);
+    map.emplace_n(count, [](unsigned i) { return payload<64>{ i }; }, keys.begin());
+    // Erasing and reinserting a random half scatters the elements, the last element fills every hole.
+    std::vector<unsigned> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::shuffle(order.begin(), order.end(), std::mt19937{ 1337u });
+    order.resize(count / 2u);
+    for (const unsigned i : order)
+    {
+      map.erase(keys[i]);
+    }
+    for (const unsigned i : order)
+    {
+      keys[i] = map.emplace(payload<64>{ i });
+    }
+    if (state.range(0) != 0)
+    {
+      map.sort([](const payload<64> &a, const payload<64> &b) { return a.words[0] < b.words[0]; });
+    }
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      for (const auto &key : keys)
+      {
+        sum += map.find_unchecked(key).words[1];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+  }
+
+#pragma endregion
+
+#pragma region relocation
+
+  /*
+  * @brief A 160 byte payload owning a heap buffer, so it isn't trivially copyable.
+  *        owning_payload<true> is declared trivially relocatable below, see relocate.hpp.
+  */
+  template<bool _Relocatable>
+  struct owning_payload
+  {
+    explicit owning_payload(uint64_t value) : buffer{ new uint64_t[4]{ value } }, words{ value } {}
+    std::unique_ptr<uint64_t[]> buffer;
+    uint64_t words[19];
+  };
+}
+
+template<>
+struct trivially_relocatable<owning_payload<true>> : std::true_type { };
+
+namespace
+{
+  // Erases every element of a full map in random order, each erase moves the last element into the hole.
+  template<bool _Relocatable>
+  void BM_slot_map_relocate_erase(benchmark::State &state)
+  {
+    using map_type = slot_map<owning_payload<_Relocatable>>;
+    std::vector<typename map_type::key_type> keys(bench_capacity);
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      state.PauseTiming();
+      map_type map;
+      map.reserve(bench_capacity);
+      for (unsigned i{ 0u }; i < bench_capacity; ++i)
+      {
+        keys[i] = map.emplace(i);
+      }
+      state.ResumeTiming();
+      for (unsigned i : order)
+      {
+        map.erase(keys[i]);
+      }
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+  // Applies a random permutation to the elements, one swap per element.
+  template<bool _Relocatable>
+  void BM_slot_map_relocate_reorder(benchmark::State &state)
+  {
+    using map_type = slot_map<owning_payload<_Relocatable>>;
+    map_type map;
+    for (unsigned i{ 0u }; i < bench_capacity; ++i)
+    {
+      map.emplace(i);
+    }
+    const std::vector<unsigned> order{ shuffled_indices(bench_capacity) };
+    for (auto _ : state)
+    {
+      map.reorder(order.data());
+      benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bench_capacity);
+  }
+
+#pragma endregion
+
+#pragma region statistics
+
+  // Random find() calls, a quarter of them with stale keys, without instrumentation and with relaxed counters.
+  template<typename _Stats>
+  void BM_slot_map_find_statistics(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<16>, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::separate,
+                              slot_map_growth::automatic, _Stats>;
+    map_type map;
+    std::vector<typename map_type::key_type> keys(bench_capacity);
+    map.emplace_n(bench_capacity, [](unsigned i) { return payload<16>{ i }; }, keys.begin());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{ 1337u });
+    for (unsigned i{ 0u }; i < bench_capacity / 4u; ++i)
+    {
+      map.erase(keys[i]);
+    }
+    for (auto _ : state)
+    {
+      unsigned found{ 0u };
+      for (const auto &key : keys)
+      {
+        found += map.find(key) != map.end();
+      }
+      benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+  }
+
+#pragma endregion
+
+#pragma region replication
+
+  // One replication tick of a large map where 1% of the elements were modified: Arg 0 diffs every element against
+  // the last sent copy, Arg 1 visits the changes recorded by a tracked_slot_map.
+  void BM_slot_map_replication_delta(benchmark::State &state)
+  {
+    using map_type = tracked_slot_map<slot_map<payload<64>>>;
+    map_type map;
+    const unsigned count{ large_map_size / 8u };
+    std::vector<map_type::key_type> keys;
+    keys.reserve(count);
+    for (unsigned i{ 0u }; i < count; ++i)
+    {
+      keys.push_back(map.insert(payload<64>{ i }));
+    }
+    map.discard_changes();
+    std::vector<payload<64>> sent(map.map().begin(), map.map().end());
+    std::vector<unsigned> touched{ shuffled_indices(count) };
+    touched.resize(count / 100u);
+    for (auto _ : state)
+    {
+      for (const unsigned i : touched)
+      {
+        ++map[keys[i]].words[1];
+      }
+      uint64_t changed{ 0u };
+      if (state.range(0) == 0)
+      {
+        auto element{ map.map().begin() };
+        for (payload<64> &copy : sent)
+        {
+          if (std::memcmp(&copy, &*element, sizeof(copy)) != 0)
+          {
+            copy = *element;
+            ++changed;
+          }
+          ++element;
+        }
+        map.discard_changes();
+      }
+      else
+      {
+        map.consume_changes([&](const map_type::key_type &key, slot_map_change) { changed += map.map().at(key).words[1]; });
+      }
+      benchmark::DoNotOptimize(changed);
+    }
+    state.SetItemsProcessed(state.iterations() * touched.size());
+  }
+
+#pragma endregion
+
+#pragma region deferred_erase
+
+  // A pass over a map which kills 1 in 8 elements and respawns them: Arg 0 erases each element during the pass, which
+  // moves the last element into the hole to be tested next, Arg 1 queues them with defer_erase() and applies one
+  // flush_erases() after the pass.
+  void BM_slot_map_deferred_erase(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<64>, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::separate,
+                              slot_map_growth::automatic, slot_map_stats::none, slot_map_deferred_erase::queue>;
+    map_type map;
+    const unsigned count{ large_map_size / 8u };
+    map.reserve(count);
+    for (unsigned i{ 0u }; i < count; ++i)
+    {
+      map.insert(payload<64>{ i });
+    }
+    uint64_t tick{ 0u };
+    for (auto _ : state)
+    {
+      ++tick;
+      unsigned erased{ 0u };
+      if (state.range(0) == 0)
+      {
+        for (auto element{ map.begin() }; element != map.end(); )
+        {
+          if ((element->words[0] + tick) % 8u == 0u)
+          {
+            element = map.erase(element);
+            ++erased;
+          }
+          else
+          {
+            ++element;
+          }
+        }
+      }
+      else
+      {
+        for (auto element{ map.cbegin() }; element != map.cend(); ++element)
+        {
+          if ((element->words[0] + tick) % 8u == 0u)
+          {
+            map.defer_erase(element);
+          }
+        }
+        erased = map.flush_erases();
+      }
+      for (unsigned i{ 0u }; i < erased; ++i)
+      {
+        map.insert(payload<64>{ tick + i });
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+  }
+
+#pragma endregion
+
+#pragma region join
+
+  // A query over three component maps mirroring the same entities, where 2 in 3 entities have the second component
+  // and 1 in 2 the third: Arg 0 walks the smallest map and calls find() on the others for each key, Arg 1 uses a
+  // slot_map_join, which validates the keys of the other maps 64 at a time.
+  void BM_slot_map_join(benchmark::State &state)
+  {
+    slot_map<payload<16>> transforms;
+    slot_map<payload<16>> velocities;
+    slot_map<payload<16>> healths;
+    const unsigned count{ large_map_size / 8u };
+    std::vector<slot_map<payload<16>>::key_type> keys;
+    keys.reserve(count);
+    for (unsigned i{ 0u }; i < count; ++i)
+    {
+      keys.push_back(transforms.insert(payload<16>{ i }));
+      velocities.insert(payload<16>{ i });
+      healths.insert(payload<16>{ i });
+    }
+    std::mt19937 rng{ 1337u };
+    for (const auto &key : keys)
+    {
+      if (rng() % 3u == 0u) velocities.erase(key);
+      if (rng() % 2u == 0u) healths.erase(key);
+    }
+    for (auto _ : state)
+    {
+      uint64_t sum{ 0u };
+      if (state.range(0) == 0)
+      {
+        for (unsigned i{ 0u }; i < healths.size(); ++i)
+        {
+          const auto key{ healths.key_at(i) };
+          const auto transform{ transforms.find(key) };
+          const auto velocity{ velocities.find(key) };
+          if (transform != transforms.end() && velocity != velocities.end())
+          {
+            sum += transform->words[0] + velocity->words[1] + (healths.begin() + i)->words[0];
+          }
+        }
+      }
+      else
+      {
+        join_slot_maps(transforms, velocities, healths).for_each([&](const auto &, payload<16> &transform, payload<16> &velocity, payload<16> &health) {
+          sum += transform.words[0] + velocity.words[1] + health.words[0];
+        });
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * healths.size());
+  }
+
+#pragma endregion
+
+#pragma region snapshot
+
+  // A buffer aligned for snapshot images.
+  struct snapshot_image
+  {
+    explicit snapshot_image(size_t size) : bytes(static_cast<char *>(::operator new(size, std::align_val_t{ 64 }))), size(size) {}
+    ~snapshot_image() { ::operator delete(bytes, std::align_val_t{ 64 }); }
+    char *bytes;
+    size_t size;
+  };
+
+  // Restores a large map with churned slots, Arg 0 rebuilds it by insertion and Arg 1 loads a snapshot.
+  // Rebuilding by insertion hands out new keys, loading keeps the old ones valid.
+  void BM_slot_map_snapshot_load(benchmark::State &state)
+  {
+    using map_type = slot_map<payload<64>>;
+    map_type map;
+    std::vector<map_type::key_type> keys(large_map_size / 4u);
+    map.emplace_n(keys.size(), [](unsigned i) { return payload<64>{ i }; }, keys.begin());
+    for (size_t i{ 0u }; i < keys.size(); i += 3u)
+    {
+      map.erase(keys[i]);
+    }
+    snapshot_image image{ map.snapshot_size() };
+    map.write_snapshot(image.bytes);
+    for (auto _ : state)
+    {
+      map_type restored;
+      if (state.range(0) == 0)
+      {
+        restored.insert(map.begin(), map.end(), keys.begin());
+      }
+      else
+      {
+        restored.load_snapshot(image.bytes, image.size);
+      }
+      benchmark::DoNotOptimize(restored.size());
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+  }
+
+  // Restores a half full slot_array of 4M slots from a snapshot, Arg 0 copies the image and Arg 1 adopts it.
+  void BM_slot_array_snapshot_load(benchmark::State &state)
+  {
+    using array_type = ADL::slot_array<payload<64>, ( 1u << 22 ), true, ADL::slot_layout::in_place, ADL::slot_key_64>;
+    auto array{ std::make_unique<array_type>() };
+    std::vector<array_type::id_type> IDs(array->capacity());
+    array->alloc_n(array->capacity(), [](unsigned i) { return payload<64>{ i }; }, IDs.data());
+    for (size_t i{ 0u }; i < IDs.size(); i += 2u)
+    {
+      array->free(array->get(IDs[i]));
+    }
+    snapshot_image image{ array_type::snapshot_size() };
+    array->write_snapshot(image.bytes);
+    auto restored{ std::make_unique<array_type>() };
+    for (auto _ : state)
+    {
+      const bool loaded{ state.range(0) == 0 ? restored->load_snapshot(image.bytes, image.size)
+                                             : restored->adopt_snapshot(image.bytes, image.size) };
+      benchmark::DoNotOptimize(loaded);
+    }
+    state.SetItemsProcessed(state.iterations() * array->size());
+  }
+
+#pragma endregion
+
+  void occupancy_levels(benchmark::internal::Benchmark *benchmark)
+  {
+    benchmark->Arg(10)->Arg(50)->Arg(90);
+  }
+
+}
+
+#define ADL_BENCH_SIZES(name)                 \
+  BENCHMARK_TEMPLATE(name, payload<16>);      \
+  BENCHMARK_TEMPLATE(name, payload<64>);      \
+  BENCHMARK_TEMPLATE(name, payload<256>)
+
+#define ADL_BENCH_SIZES_OCCUPANCY(name)                                   \
+  BENCHMARK_TEMPLATE(name, payload<16>)->Apply(occupancy_levels);         \
+  BENCHMARK_TEMPLATE(name, payload<64>)->Apply(occupancy_levels);         \
+  BENCHMARK_TEMPLATE(name, payload<256>)->Apply(occupancy_levels)
+
+ADL_BENCH_SIZES(BM_slot_array_alloc_free);
+ADL_BENCH_SIZES(BM_slot_array_alloc_free_n);
+ADL_BENCH_SIZES(BM_vector_pool_alloc_free);
+ADL_BENCH_SIZES(BM_unordered_map_insert_erase);
+ADL_BENCH_SIZES(BM_slot_map_insert_erase);
+ADL_BENCH_SIZES(BM_slot_map_emplace_erase);
+ADL_BENCH_SIZES(BM_slot_map_emplace_n);
+BENCHMARK_TEMPLATE(BM_slot_map_erase_range, payload<64>)->Arg(1)->Arg(64)->Arg(1024);
+
+ADL_BENCH_SIZES_OCCUPANCY(BM_slot_array_get);
+ADL_BENCH_SIZES_OCCUPANCY(BM_slot_array_get_safely);
+ADL_BENCH_SIZES_OCCUPANCY(BM_vector_pool_get_safely);
+ADL_BENCH_SIZES_OCCUPANCY(BM_unordered_map_find);
+ADL_BENCH_SIZES_OCCUPANCY(BM_slot_map_find);
+ADL_BENCH_SIZES_OCCUPANCY(BM_slot_map_find_unchecked);
+
+ADL_BENCH_SIZES_OCCUPANCY(BM_slot_array_iterate);
+ADL_BENCH_SIZES_OCCUPANCY(BM_vector_pool_iterate);
+ADL_BENCH_SIZES_OCCUPANCY(BM_slot_map_iterate);
+ADL_BENCH_SIZES_OCCUPANCY(BM_unordered_map_iterate);
+
+BENCHMARK_TEMPLATE(BM_slot_map_large_find, slot_map_layout::separate)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_map_large_find, slot_map_layout::interleaved)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_map_large_erase_insert, slot_map_layout::separate)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_map_large_erase_insert, slot_map_layout::interleaved)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_map_large_lookup, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_map_large_lookup, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_array_large_lookup, false, ADL::slot_layout::in_place)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_array_large_lookup, true, ADL::slot_layout::in_place)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_array_large_lookup, false, ADL::slot_layout::dense)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_array_large_lookup, true, ADL::slot_layout::dense)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_pool_large_lookup, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_pool_large_lookup, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_map_validate, false);
+BENCHMARK_TEMPLATE(BM_slot_map_validate, true);
+BENCHMARK_TEMPLATE(BM_slot_array_validate, false);
+BENCHMARK_TEMPLATE(BM_slot_array_validate, true);
+
+BENCHMARK_TEMPLATE(BM_slot_map_growth, std::vector)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_slot_map_growth, paged_container)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_slot_map_parallel_for_each)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_slot_array_parallel_for_each)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_concurrent_slot_map_find)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_shared_mutex_slot_map_find)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK(BM_slot_map_sorted_traversal)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_slot_map_relocate_erase, false);
+BENCHMARK_TEMPLATE(BM_slot_map_relocate_erase, true);
+BENCHMARK_TEMPLATE(BM_slot_map_relocate_reorder, false);
+BENCHMARK_TEMPLATE(BM_slot_map_relocate_reorder, true);
+
+BENCHMARK_TEMPLATE(BM_slot_map_find_statistics, slot_map_stats::none);
+BENCHMARK_TEMPLATE(BM_slot_map_find_statistics, slot_map_stats::counters);
+
+BENCHMARK(BM_slot_map_replication_delta)->Arg(0)->Arg(1);
+
+BENCHMARK(BM_slot_map_deferred_erase)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_slot_map_join)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_slot_map_snapshot_load)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_slot_array_snapshot_load)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_slot_map_aos_integrate);
+BENCHMARK(BM_slot_map_soa_integrate);
+
+#ifdef ADL_BENCH_HAS_COLONY
+ADL_BENCH_SIZES(BM_colony_insert_erase);
+ADL_BENCH_SIZES_OCCUPANCY(BM_colony_iterate);
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,463 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+#pragma once
+#include <atomic> // atomic
+#include <utility> // forward
+#include <type_traits> // aligned_storage
+#include <cstdint> // uint64_t
+#include <memory> // unique_ptr
+#include "slot_array.hpp" // slot_key
+#include "../Debugging/Asserts.hpp"
+namespace ADL
+{
+  template<typename _Pool, unsigned _Magazine_Size>
+  class thread_cache;
+
+  /*
+  * @brief: concurrent_slot_array is a fixed-size container of linear memory which can be allocated from and freed to
+  * by any number of threads at once.
+  * concurrent_slot_array makes the following promises:
+  *   - Performance
+  *     -# contiguous memory
+  *     -# lock-free O(1) alloc and free operations
+  *     -# wait-free O(1) access via weak reference keys that can safely attempt to access an element.
+  *     -# dereferences have zero overhead when known to be valid\n
+  *        ( get() when passed a weak reference key, or via raw pointers)
+  *   - Convenience
+  *     -# stable indices (a raw pointer to an element will only be invalidated by releasing the container or that object)
+  *     -# IDs are interchangeable with the IDs a slot_array using the same _Key would produce.
+  *
+  * @param T The value type being stored in the container
+  * @param _Elements The max number of elements the container can hold. Defaults to 2048.
+  * @param _Use_Heap Whether element storage should be on the heap or in place. Defaults to on the heap.\n
+  *        Specify false when dynamically allocating the concurrent_slot_array object itself to prevent extra allocations.
+  * @param _Key The slot_key layout of IDs. Defaults to slot_key_32.
+  *
+  * @note: Each slot header is a single atomic word laid out exactly like an ID, so get_safely() is one load and compare.
+  * @note: The free list head is tagged with a 32 bit version which every successful push and pop increments, so a
+  *        head popped and pushed back while another thread is between reading the head and its compare-exchange is
+  *        detected (ABA safe) unless 2^32 exchanges complete in that window. Slot counters are not part of the tag,
+  *        slots can return to the free list without being constructed, e.g. from a thread_cache magazine.
+  * @note: Freeing an object while another thread still uses it is undefined behavior, as it is for slot_array.
+  * @note: There is no iteration. clear() and the destructor must not race with any other operation.
+  * @note: clear() puts every slot back on the free list, including slots held in thread_cache magazines. It bumps an
+  *        epoch the caches compare against, so a cache drops its magazine instead of pushing those slots twice.
+  * @note: See thread_cache for per-thread magazines which only touch the shared free list once per batch.
+  */
+  template<typename T, unsigned _Elements = 2048u, bool _Use_Heap = true, typename _Key = slot_key_32>
+  class concurrent_slot_array
+  {
+    static_assert(_Elements < _Key::max_elements, "Tried to declare a concurrent_slot_array with over the maximum capacity of its key (2^_Key::index_bits).");
+  public:
+    using value_type = T;
+    using id_type = typename _Key::id_type;
+    static const size_t storage_size = sizeof( typename std::aligned_storage<sizeof(T), alignof(T)>::type );
+
+    concurrent_slot_array(); // sets up the free list
+    ~concurrent_slot_array();
+    void clear(); // destructs any remaining objects and resets the free list. Not thread safe.
+
+    template<typename... Args>
+    T* alloc(Args&&... args); // creates an element and returns a pointer to it. nullptr if the container is saturated.
+
+    void free(T&);                    // releases the object and puts it on the free list.
+    id_type get_ID(T&)         const; // retreive the ID of the referenced element.
+    T& get(id_type ID)         const; // returns the item referenced by ID
+    T* get_safely(id_type ID)  const; // validates the ID before attempting to return the elemnt. nullptr if invalid.
+
+    inline unsigned capacity()    const noexcept { return _Elements; }
+    inline unsigned max_usage()   const noexcept { return m_max_used.load(std::memory_order_relaxed); }
+    inline unsigned size()        const noexcept { return m_size.load(std::memory_order_relaxed); }
+    inline bool empty()           const noexcept { return size() == 0u; }
+    inline float saturation()     const noexcept { return static_cast<float>(size()) / _Elements; }
+    inline float max_saturation() const noexcept { return static_cast<float>(max_usage()) / _Elements; }
+
+  private:
+    template<typename _Pool, unsigned _Magazine_Size>
+    friend class thread_cache;
+    using object_storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    static const id_type alive_bit = id_type{ 1 } << ( _Key::id_bits - 1u );
+    static id_type make_word(id_type alive, id_type counter, id_type index) noexcept;
+    static unsigned index_of(id_type word) noexcept;
+    static id_type counter_of(id_type word) noexcept;
+    static uint64_t make_head(uint64_t version, unsigned index) noexcept;
+    static unsigned head_index(uint64_t head) noexcept;
+    static uint64_t next_head(uint64_t head, unsigned index) noexcept;
+
+    value_type * as_value_type(unsigned index) const;
+    unsigned get_index(const T&) const;
+    void reset_free_list();
+
+    // Free list and object lifetime primitives. alloc() and free() are built on these, thread_cache batches them.
+    unsigned pop_free(unsigned *indices, unsigned count);        // pops up to count slots with one exchange
+    void push_free(const unsigned *indices, unsigned count);     // pushes count slots with one exchange
+    template<typename... Args>
+    T* construct(unsigned index, Args&&... args);                // constructs and publishes an object in a popped slot
+    unsigned destroy(T& object);                                 // invalidates and destructs an object, returns its slot
+
+    // Use the heap (dynamic allocation) if _Use_Heap is true, otherwise use an array in place.
+    template<typename U>
+    using storage = typename std::conditional<_Use_Heap, std::unique_ptr<U[]>, U[_Elements]>::type;
+
+    // Each header holds the liveness bit and counter of its slot, and either the slot's own index while it is alive
+    // or the next free slot while it is dead. A live header is equal to the ID of the object in the slot.
+    storage<std::atomic<id_type>> m_headers;
+    storage<object_storage> m_objects;
+
+    // The index of the slot on top of the free list in the low 32 bits, tagged with the version of the list in the
+    // high 32 bits. The index is _Elements when the list is empty.
+    std::atomic<uint64_t> m_free_head;
+    std::atomic<unsigned> m_size; // current active items
+    std::atomic<unsigned> m_max_used; // max ever active items
+    std::atomic<unsigned> m_clear_epoch; // incremented by clear(), thread_cache magazines filled before it are stale
+
+    void init_storage()
+    {
+      if constexpr (_Use_Heap)
+      {
+        m_headers = std::unique_ptr<std::atomic<id_type>[]>(new std::atomic<id_type>[_Elements]);
+        m_objects = std::unique_ptr<object_storage[]>(new object_storage[_Elements]);
+      }
+    }
+  };
+
+  /*
+  * @brief Packs the fields of a slot header, using the same layout as an ID.
+  * @param alive 1 if the slot is alive, 0 otherwise.
+  * @param counter The generation counter of the slot.
+  * @param index The index stored in the header.
+  * @return The packed header word.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  typename concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::id_type concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::make_word(id_type alive, id_type counter, id_type index) noexcept
+  {
+    return ( alive ? alive_bit : id_type{ 0 } ) | ( ( counter & _Key::generation_mask ) << _Key::index_bits ) | ( index & _Key::index_mask );
+  }
+
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  unsigned concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::index_of(id_type word) noexcept
+  {
+    return static_cast<unsigned>( word & _Key::index_mask );
+  }
+
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  typename concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::id_type concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::counter_of(id_type word) noexcept
+  {
+    return ( word >> _Key::index_bits ) & _Key::generation_mask;
+  }
+
+  /*
+  * @brief Packs the free list head word.
+  * @param version The version of the free list, truncated to 32 bits.
+  * @param index The index of the slot on top of the free list.
+  * @return The packed head word.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  uint64_t concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::make_head(uint64_t version, unsigned index) noexcept
+  {
+    return ( version << 32u ) | index;
+  }
+
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  unsigned concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::head_index(uint64_t head) noexcept
+  {
+    return static_cast<unsigned>( head & 0xFFFFFFFFu );
+  }
+
+  /*
+  * @brief Builds the head word replacing head, with the next version so the exchange is visible to every other thread.
+  * @param head The current head word.
+  * @param index The index of the slot which will be on top of the free list.
+  * @return The packed head word.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  uint64_t concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::next_head(uint64_t head, unsigned index) noexcept
+  {
+    return make_head( ( head >> 32u ) + 1u, index );
+  }
+
+  /*
+  * @brief Casts an element index to a pointer to an object of the value_type type stored at that index.
+  * @param index The index of the object to retrieve
+  * @return Pointer to the object stored at the index referenced by the 'index' param.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  T* concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::as_value_type(unsigned index) const
+  {
+    return reinterpret_cast<value_type *>( const_cast<object_storage *>(&m_objects[index]) );
+  }
+
+  /*
+  * @brief Retrieve the index corresponding to the referenced object.
+  * @param object The object for which an index is being acquired.
+  * @return the index corresponding to the 'object' param.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  unsigned concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::get_index(const T& object) const
+  {
+    const unsigned index{ static_cast<unsigned>( reinterpret_cast<const object_storage*>(&object) - &m_objects[0] ) };
+    ADL_ASSERT_MSG(index < _Elements, "Tried to access an element that was out of bounds.");
+    return index;
+  }
+
+  /*
+  * @brief Links every slot into the free list in index order, preserving each slot's counter.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  void concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::reset_free_list()
+  {
+    for (unsigned i{ 0 }; i < _Elements; ++i)
+    {
+      const id_type counter{ counter_of( m_headers[i].load(std::memory_order_relaxed) ) };
+      m_headers[i].store( make_word(0u, counter, i + 1), std::memory_order_relaxed );
+    }
+    m_free_head.store( next_head( m_free_head.load(std::memory_order_relaxed), 0u ), std::memory_order_release );
+  }
+
+  /*
+  * @brief Initializes all member variables and the free list.
+  * @detail If _Use_Heap is true it will allocate using the heap,
+  * otherwise the elements will be stored in place in the concurrent_slot_array.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::concurrent_slot_array()
+    : m_free_head(0)
+    , m_size(0)
+    , m_max_used(0)
+    , m_clear_epoch(0)
+  {
+    init_storage();
+    for (unsigned i{ 0 }; i < _Elements; ++i)
+    {
+      m_headers[i].store( 0u, std::memory_order_relaxed );
+    }
+    reset_free_list();
+  }
+
+  /*
+  * @brief destructs all live objects and releases any memory it allocated.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::~concurrent_slot_array()
+  {
+    clear();
+  }
+
+  /*
+  * @brief Releases all live elements and sets up the free list. Must not be called concurrently with other operations.
+  * @detail Slots cached by a thread_cache are relinked as well, the cache notices the new epoch and forgets them.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  void concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::clear()
+  {
+    for (unsigned i{ 0 }; i < _Elements; ++i)
+    {
+      const id_type header{ m_headers[i].load(std::memory_order_acquire) };
+      if (header & alive_bit)
+      {
+        as_value_type(i)->~T();
+        // bump the counter so IDs of the released objects are no longer valid
+        m_headers[i].store( make_word(0u, counter_of(header) + 1u, 0u), std::memory_order_relaxed );
+      }
+    }
+    reset_free_list();
+    m_size.store(0u, std::memory_order_relaxed);
+    m_clear_epoch.fetch_add(1u, std::memory_order_relaxed);
+  }
+
+  /*
+  * @brief Pops a chain of slots off the free list.
+  * @detail The chain is walked first, then detached with a single compare-exchange on the head.
+  *         Slots on the free list are never written, and every completed push or pop increments the version of the
+  *         head, so a successful exchange means the walked chain was intact. Safe to call from any number of threads.
+  * @param indices Receives the indices of the popped slots.
+  * @param count The max number of slots to pop.
+  * @return The number of slots popped. Less than count if the free list ran out.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  unsigned concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::pop_free(unsigned *indices, unsigned count)
+  {
+    uint64_t head{ m_free_head.load(std::memory_order_acquire) };
+    for (;;)
+    {
+      // If another thread takes these slots first, the values read here may be stale,
+      // but the version of the head will have changed and the exchange fails.
+      unsigned popped{ 0u };
+      unsigned next{ head_index(head) };
+      while (popped < count && next < _Elements)
+      {
+        indices[popped++] = next;
+        next = index_of( m_headers[next].load(std::memory_order_relaxed) );
+      }
+      if (popped == 0u)
+      {
+        return 0u;
+      }
+      if (m_free_head.compare_exchange_weak(head, next_head(head, next), std::memory_order_acquire, std::memory_order_acquire))
+      {
+        return popped;
+      }
+    }
+  }
+
+  /*
+  * @brief Pushes a chain of slots onto the free list with a single compare-exchange on the head.
+  * @detail The slots must be dead and owned by the caller. Safe to call from any number of threads.
+  * @param indices The indices of the slots to push. The first index ends up on top of the free list.
+  * @param count The number of slots to push.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  void concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::push_free(const unsigned *indices, unsigned count)
+  {
+    if (count == 0u)
+    {
+      return;
+    }
+    // Link the chain privately, only the last slot's link depends on the current head.
+    for (unsigned i{ 0u }; i + 1u < count; ++i)
+    {
+      const id_type counter{ counter_of( m_headers[indices[i]].load(std::memory_order_relaxed) ) };
+      m_headers[indices[i]].store( make_word(0u, counter, indices[i + 1u]), std::memory_order_relaxed );
+    }
+    const unsigned first{ indices[0] };
+    const unsigned last{ indices[count - 1u] };
+    const id_type last_counter{ counter_of( m_headers[last].load(std::memory_order_relaxed) ) };
+
+    uint64_t head{ m_free_head.load(std::memory_order_relaxed) };
+    do
+    {
+      m_headers[last].store( make_word(0u, last_counter, head_index(head)), std::memory_order_relaxed );
+    } while (!m_free_head.compare_exchange_weak(head, next_head(head, first), std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  /*
+  * @brief Constructs an object in a slot popped from the free list and makes it visible to other threads.
+  * @param index The index of a slot owned by the caller.
+  * @param args Any arguments passed to the function will be forwarded to the constructor of the value_type.
+  * @return A pointer to the constructed object.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  template<typename... Args>
+  T* concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::construct(unsigned index, Args&&... args)
+  {
+    T* data = new(as_value_type(index)) T( std::forward<Args>(args)... );
+
+    // Publishing the live header makes the constructed object visible to get_safely() in other threads.
+    const id_type counter{ counter_of( m_headers[index].load(std::memory_order_relaxed) ) };
+    m_headers[index].store( make_word(1u, counter, index), std::memory_order_release );
+
+    // set the max used if we have a new record;
+    const unsigned size{ m_size.fetch_add(1u, std::memory_order_relaxed) + 1u };
+    unsigned max_used{ m_max_used.load(std::memory_order_relaxed) };
+    while (max_used < size && !m_max_used.compare_exchange_weak(max_used, size, std::memory_order_relaxed))
+    {
+    }
+    return data;
+  }
+
+  /*
+  * @brief Invalidates the IDs of an object and destructs it. The slot is left for the caller to push on a free list.
+  * @param object The object to be destroyed.
+  * @return The index of the slot the object was stored in.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  unsigned concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::destroy(T& object)
+  {
+    const unsigned index{ get_index(object) };
+    const id_type header{ m_headers[index].load(std::memory_order_relaxed) };
+    ADL_ASSERT_MSG(header & alive_bit, "Tried to free an object that wasn't alive.");
+
+    // Invalidate outstanding IDs before the object is destroyed.
+    m_headers[index].store( make_word(0u, counter_of(header) + 1u, index), std::memory_order_relaxed );
+    object.~T();
+    m_size.fetch_sub(1u, std::memory_order_relaxed);
+    return index;
+  }
+
+  /*
+  * @brief Allocates an object in the concurrent_slot_array and returns a pointer to the object.
+  * @detail Pops the head of the free list with a compare-exchange. Safe to call from any number of threads.
+  *         If the constructor throws, the slot is pushed back on the free list before the exception propagates.
+  * @param args Any arguments passed to the function will be forwarded to the constructor of the value_type.
+  * @return A pointer to the allocated object, or nullptr if the container is saturated.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  template<typename... Args>
+  T* concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::alloc(Args&&... args)
+  {
+    unsigned index;
+    if (pop_free(&index, 1u) == 0u)
+    {
+      return nullptr;
+    }
+    try
+    {
+      return construct(index, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      push_free(&index, 1u);
+      throw;
+    }
+  }
+
+  /*
+  * @brief Safely destructs the referenced object and makes it's slot available for new objects.
+  * @detail Pushes the slot onto the free list with a compare-exchange. Safe to call from any number of threads.
+  * @param object The object to be freed.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  void concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::free(T& object)
+  {
+    // Add this element to the front of the free list
+    const unsigned index{ destroy(object) };
+    push_free(&index, 1u);
+  }
+
+  /*
+  * @brief Accesses an element of the concurrent_slot_array by key. Only use this if the key is known to be valid.
+  * @param ID An identifier known to be good that references an object in the concurrent_slot_array
+  * @return A reference to the object corresponding to the ID.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  T& concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::get(id_type ID) const
+  {
+    const unsigned index{ index_of(ID) };
+    ADL_ASSERT_MSG(index < _Elements, "Invalid ID: Index out of range.");
+    return *as_value_type(index);
+  }
+
+  /*
+  * @brief Accesses an element by key safely and can be used if the key isn't known to be valid.
+  * @detail Wait-free: a single acquire load of the slot header, which equals the ID while the object is alive.
+  * @param ID An identifier that references an object in the concurrent_slot_array
+  * @return A pointer to the object corresponding to the ID. If the ID is invalid, it will return nullptr.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  T* concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::get_safely(id_type ID) const
+  {
+    const unsigned index{ index_of(ID) };
+    ADL_ASSERT_MSG(index < _Elements, "Invalid ID: Index out of range.");
+    if ( ( ID & alive_bit ) && m_headers[index].load(std::memory_order_acquire) == ID )
+    {
+      return as_value_type(index);
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+
+  /*
+  * @brief Generates a unique identifier used to safely access the referenced object.
+  * @param object The object who's ID is being acquired.
+  * @return An ID that can be used to safely access the object.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Key>
+  typename concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::id_type concurrent_slot_array<T, _Elements, _Use_Heap, _Key>::get_ID(T& object) const
+  {
+    return m_headers[get_index(object)].load(std::memory_order_relaxed);
+  }
+
+}
@@ -0,0 +1,450 @@
+#pragma once
+#include <atomic> // atomic, atomic_thread_fence
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uint64_t
+#include <limits> // max cell and key indices
+#include <memory> // unique_ptr
+#include <new> // placement new, launder
+#include <stdexcept> // length_error
+#include <tuple> // get
+#include <type_traits> // aligned_storage, remove_reference
+#include <utility> // forward, move, pair
+#include <vector>
+
+// Pages of PageSize Us which never move once allocated, found through a directory readers can load concurrently with
+// a writer adding pages. A full directory is replaced by one twice as large, the old one is retired with the epoch it
+// was replaced in and freed by reclaim( ) once no reader can still be using it. See concurrent_slot_map.
+template<typename U, std::size_t PageSize>
+class concurrent_page_table {
+public:
+  concurrent_page_table( ) = default;
+  concurrent_page_table( const concurrent_page_table & ) = delete;
+  concurrent_page_table& operator=( const concurrent_page_table & ) = delete;
+
+  // Reader or writer: element i, which must be below capacity( ) as seen through an acquire operation.
+  U& operator[]( std::size_t i ) const {
+    return m_directory.load( std::memory_order_acquire )[ i / PageSize ][ i % PageSize ];
+  }
+  // Writer only
+  std::size_t capacity( ) const { return m_pages.size( ) * PageSize; }
+  void add_page( std::uint64_t epoch );
+  void reclaim( std::uint64_t bound ); // frees the directories retired before epoch bound
+
+private:
+  std::vector<std::unique_ptr<U[]>> m_pages;
+  std::unique_ptr<U*[]> m_current;
+  std::size_t m_directory_capacity{ 0 };
+  std::atomic<U**> m_directory{ nullptr };
+  std::vector<std::pair<std::uint64_t, std::unique_ptr<U*[]>>> m_retired;
+};
+
+template<typename U, std::size_t PageSize>
+void concurrent_page_table<U, PageSize>::add_page( std::uint64_t epoch ) {
+  std::unique_ptr<U[]> page( new U[ PageSize ] );
+  if( m_pages.size( ) == m_directory_capacity ) {
+    // Everything which can throw comes before the new directory is published, readers may use it at once.
+    const std::size_t directory_capacity{ m_directory_capacity ? m_directory_capacity * 2 : 8 };
+    std::unique_ptr<U*[]> directory( new U*[ directory_capacity ] );
+    m_pages.reserve( directory_capacity );
+    if( m_current ) m_retired.reserve( m_retired.size( ) + 1 );
+    m_pages.push_back( std::move( page ) );
+    for( std::size_t i{ 0 }; i < m_pages.size( ); ++i ) directory[ i ] = m_pages[ i ].get( );
+    m_directory.store( directory.get( ), std::memory_order_release );
+    if( m_current ) m_retired.emplace_back( epoch, std::move( m_current ) );
+    m_current = std::move( directory );
+    m_directory_capacity = directory_capacity;
+  }
+  else {
+    m_pages.push_back( std::move( page ) );
+    // Readers only index pages below the capacity they synchronized with, so the new entry can be written in place.
+    m_current[ m_pages.size( ) - 1 ] = m_pages.back( ).get( );
+  }
+}
+
+template<typename U, std::size_t PageSize>
+void concurrent_page_table<U, PageSize>::reclaim( std::uint64_t bound ) {
+  std::size_t kept{ 0 };
+  for( auto &retired : m_retired ) {
+    if( retired.first >= bound ) m_retired[ kept++ ] = std::move( retired );
+  }
+  m_retired.resize( kept );
+}
+
+// A slot_map for one writer thread and any number of reader threads which look keys up without locks.
+// Readers claim a reader (one per thread) and open a read_section, in which find( ) is a few atomic loads and returns
+// a pointer which stays valid until the section closes. Sections only write to a cache line owned by their reader, so
+// lookups scale with the number of reading threads.
+//
+// Elements never move: a slot points to a cell holding its element, and cells are pages which are never reallocated.
+// The writer never changes an element readers can reach. erase( ) and replace( ) unlink the old cell at once and
+// retire it, and retired cells are destroyed and reused by reclaim( ) once every section open when they were retired
+// has closed (epoch based reclamation). Growing the page directories follows the same scheme. Each reader section
+// pins the current epoch; reclaim( ) advances the epoch and frees whatever was retired before the oldest pinned
+// epoch. reclaim( ) runs every reclaim_batch retirements, and can also be called directly.
+// A reader which keeps its section open holds back reclamation, not the writer.
+//
+// The writer's bookkeeping vectors are sized when a slot or cell is added, so erase( ), reclaim( ) and the steps of
+// emplace( ) and replace( ) which publish an element can't throw. An emplace( ) or replace( ) which throws leaves the
+// map as it was.
+//
+// Everything but reader and read_section is writer only. Unlike slot_map, elements aren't dense and are updated by
+// replacing them, and keys must be two integers of at most 32 bits. MaxReaders bounds the readers alive at once.
+template<typename T, typename Token = std::pair<unsigned, unsigned>, std::size_t PageSize = 1024, std::size_t MaxReaders = 64>
+class concurrent_slot_map {
+public:
+  using key_size_type = std::remove_reference_t<decltype( std::get<0>( std::declval<Token>( ) ) )>;
+  using key_generation_type = std::remove_reference_t<decltype( std::get<1>( std::declval<Token>( ) ) )>;
+  using key_type = Token;
+  using value_type = T;
+  using size_type = key_size_type;
+
+  static_assert( sizeof( key_size_type ) <= 4 && sizeof( key_generation_type ) <= 4,
+                 "A concurrent_slot_map packs the cell index and generation of each slot into one 64 bit atomic." );
+  static_assert( PageSize > 0 && ( PageSize & ( PageSize - 1 ) ) == 0, "The page size of a concurrent_slot_map must be a power of 2." );
+  static_assert( MaxReaders > 0, "A concurrent_slot_map must allow at least 1 reader." );
+
+  // How many retirements trigger a reclaim( ).
+  static constexpr std::size_t reclaim_batch{ 64 };
+
+  class reader;
+  class read_section;
+
+  concurrent_slot_map( ) = default;
+  concurrent_slot_map( const concurrent_slot_map & ) = delete;
+  concurrent_slot_map& operator=( const concurrent_slot_map & ) = delete;
+  ~concurrent_slot_map( );                                       // no reader may be alive
+
+  // Writer modifiers
+  key_type insert( const value_type &value );                    // O(1), amortized when a page is added
+  key_type insert( value_type &&value );                         // O(1), amortized when a page is added
+  template<typename... Args>
+  key_type emplace( Args&&... args );                            // O(1), amortized when a page is added
+  size_type erase( const key_type &key );                        // O(1), returns how many elements were erased
+  void clear( );                                                 // O(N), every key becomes stale
+  // Publishes a new value for a valid key, constructed from args. Sections which already found the key keep the old one.
+  template<typename... Args>
+  bool replace( const key_type &key, Args&&... args );           // O(1), returns whether the key was valid
+  // replace( ) with a copy of the current value, modified by fn( value_type & ).
+  template<typename Function>
+  bool update( const key_type &key, Function fn );               // O(1), returns whether the key was valid
+  void reclaim( );                                               // O(readers + retired)
+
+  // Writer lookups
+  const value_type* find( const key_type &key ) const;           // O(1), nullptr for stale keys
+  template<typename Function>
+  void for_each( Function fn ) const;                            // O(N), calls fn( key, const value_type & )
+  size_type size( ) const { return static_cast<size_type>( m_dense.size( ) ); }
+  bool empty( ) const { return m_dense.empty( ); }
+  std::size_t retired_count( ) const { return m_retired.size( ); } // cells waiting for sections to close
+
+private:
+  using cell = std::aligned_storage_t<sizeof( T ), alignof( T )>;
+  struct retired_cell {
+    std::uint64_t epoch;
+    std::uint32_t index;
+  };
+  // The epoch pinned by an open section of a reader, 0 outside of sections. Each on its own cache line.
+  struct alignas( 64 ) reader_record {
+    std::atomic<std::uint64_t> epoch{ 0 };
+    std::atomic<bool> claimed{ false };
+  };
+
+  // Each slot word holds the generation of its slot in the high half and the index of its cell in the low half.
+  concurrent_page_table<std::atomic<std::uint64_t>, PageSize> m_slots;
+  concurrent_page_table<cell, PageSize> m_cells;
+  std::atomic<std::size_t> m_slot_count{ 0 };
+  std::atomic<std::uint64_t> m_epoch{ 1 };
+  mutable reader_record m_readers[ MaxReaders ];
+
+  // writer only
+  std::size_t m_cell_count{ 0 };
+  std::vector<std::uint32_t> m_free_cells;
+  std::vector<key_size_type> m_free_slots;
+  std::vector<retired_cell> m_retired;
+  // The slots of the live elements, and the position of each slot in it, for for_each( ) and clear( ).
+  std::vector<key_size_type> m_dense;
+  std::vector<key_size_type> m_dense_position;
+
+  static std::uint64_t make_word( key_generation_type generation, std::uint32_t cell_index ) {
+    return ( std::uint64_t{ static_cast<std::uint32_t>( generation ) } << 32 ) | cell_index;
+  }
+  static key_generation_type generation_of( std::uint64_t word ) { return static_cast<key_generation_type>( word >> 32 ); }
+  static std::uint32_t cell_of( std::uint64_t word ) { return static_cast<std::uint32_t>( word ); }
+  value_type* cell_value( std::uint32_t index ) const { return std::launder( reinterpret_cast<value_type *>( &m_cells[ index ] ) ); }
+
+  const value_type* lookup( const key_type &key ) const;
+  template<typename... Args>
+  std::uint32_t construct_cell( Args&&... args );
+  void retire( std::uint32_t cell_index );
+  void reserve_slot( );
+  key_size_type acquire_slot( );
+  template<typename Vector>
+  static void reserve_total( Vector &vector, std::size_t count );
+};
+
+// A reader thread's claim on one of the MaxReaders reader records of a concurrent_slot_map. Not shared between threads.
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+class concurrent_slot_map<T, Token, PageSize, MaxReaders>::reader {
+public:
+  // Throws std::length_error when MaxReaders readers are already alive.
+  explicit reader( const concurrent_slot_map &map );
+  reader( const reader & ) = delete;
+  reader& operator=( const reader & ) = delete;
+  ~reader( ) { m_record->claimed.store( false, std::memory_order_release ); }
+
+private:
+  friend class read_section;
+  const concurrent_slot_map *m_map;
+  reader_record *m_record;
+};
+
+// Pins the current epoch for its lifetime. Pointers returned by find( ) stay valid until the section closes.
+// Sections of one reader must not nest.
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+class concurrent_slot_map<T, Token, PageSize, MaxReaders>::read_section {
+public:
+  explicit read_section( reader &owner );
+  read_section( const read_section & ) = delete;
+  read_section& operator=( const read_section & ) = delete;
+  ~read_section( ) { m_reader.m_record->epoch.store( 0, std::memory_order_release ); }
+
+  const value_type* find( const key_type &key ) const { return m_reader.m_map->lookup( key ); } // O(1), nullptr for stale keys
+
+private:
+  reader &m_reader;
+};
+
+#pragma region readers_impl
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+concurrent_slot_map<T, Token, PageSize, MaxReaders>::reader::reader( const concurrent_slot_map &map )
+  : m_map( &map )
+  , m_record( nullptr )
+{
+  for( reader_record &record : map.m_readers ) {
+    if( !record.claimed.load( std::memory_order_relaxed ) && !record.claimed.exchange( true, std::memory_order_acquire ) ) {
+      m_record = &record;
+      return;
+    }
+  }
+  throw std::length_error( "concurrent_slot_map already has MaxReaders readers." );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+concurrent_slot_map<T, Token, PageSize, MaxReaders>::read_section::read_section( reader &owner )
+  : m_reader( owner )
+{
+  // Pairs with the fence in reclaim( ): either reclaim( ) sees this epoch, or this section sees every unlink made
+  // before reclaim( ) advanced the epoch.
+  m_reader.m_record->epoch.store( m_reader.m_map->m_epoch.load( std::memory_order_acquire ), std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+const typename concurrent_slot_map<T, Token, PageSize, MaxReaders>::value_type*
+concurrent_slot_map<T, Token, PageSize, MaxReaders>::lookup( const key_type &key ) const {
+  const std::size_t index{ static_cast<std::size_t>( std::get<0>( key ) ) };
+  if( index >= m_slot_count.load( std::memory_order_acquire ) ) return nullptr;
+  const std::uint64_t word{ m_slots[ index ].load( std::memory_order_acquire ) };
+  if( generation_of( word ) != std::get<1>( key ) ) return nullptr;
+  return this->cell_value( cell_of( word ) );
+}
+
+#pragma endregion
+
+#pragma region modifiers_impl
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+concurrent_slot_map<T, Token, PageSize, MaxReaders>::~concurrent_slot_map( ) {
+  for( const key_size_type slot : m_dense ) this->cell_value( cell_of( m_slots[ slot ].load( std::memory_order_relaxed ) ) )->~T( );
+  for( const retired_cell &retired : m_retired ) this->cell_value( retired.index )->~T( );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+typename concurrent_slot_map<T, Token, PageSize, MaxReaders>::key_type concurrent_slot_map<T, Token, PageSize, MaxReaders>::insert( const value_type &value ) {
+  return this->emplace( value );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+typename concurrent_slot_map<T, Token, PageSize, MaxReaders>::key_type concurrent_slot_map<T, Token, PageSize, MaxReaders>::insert( value_type &&value ) {
+  return this->emplace( std::move( value ) );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+template<typename... Args>
+typename concurrent_slot_map<T, Token, PageSize, MaxReaders>::key_type concurrent_slot_map<T, Token, PageSize, MaxReaders>::emplace( Args&&... args ) {
+  // Nothing after construct_cell( ) throws, so the cell can't be lost or published half way.
+  this->reserve_slot( );
+  const std::uint32_t cell_index{ this->construct_cell( std::forward<Args>( args )... ) };
+  const key_size_type slot{ this->acquire_slot( ) };
+  std::atomic<std::uint64_t> &word{ m_slots[ slot ] };
+  const key_generation_type generation{ generation_of( word.load( std::memory_order_relaxed ) ) };
+  // Publishes the element: a reader which sees this word also sees the constructed cell.
+  word.store( make_word( generation, cell_index ), std::memory_order_release );
+  m_dense_position[ slot ] = static_cast<key_size_type>( m_dense.size( ) );
+  m_dense.push_back( slot );
+  return key_type{ slot, generation };
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+typename concurrent_slot_map<T, Token, PageSize, MaxReaders>::size_type concurrent_slot_map<T, Token, PageSize, MaxReaders>::erase( const key_type &key ) {
+  if( !this->find( key ) ) return 0;
+  const key_size_type slot{ std::get<0>( key ) };
+  std::atomic<std::uint64_t> &word{ m_slots[ slot ] };
+  const std::uint64_t old_word{ word.load( std::memory_order_relaxed ) };
+  // The next generation makes every key to the slot stale, the slot itself can be reused at once.
+  word.store( make_word( static_cast<key_generation_type>( generation_of( old_word ) + 1 ), 0 ), std::memory_order_release );
+  const key_size_type position{ m_dense_position[ slot ] };
+  m_dense[ position ] = m_dense.back( );
+  m_dense_position[ m_dense[ position ] ] = position;
+  m_dense.pop_back( );
+  m_free_slots.push_back( slot );
+  this->retire( cell_of( old_word ) );
+  return 1;
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+void concurrent_slot_map<T, Token, PageSize, MaxReaders>::clear( ) {
+  while( !m_dense.empty( ) ) {
+    const key_size_type slot{ m_dense.back( ) };
+    this->erase( key_type{ slot, generation_of( m_slots[ slot ].load( std::memory_order_relaxed ) ) } );
+  }
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+template<typename... Args>
+bool concurrent_slot_map<T, Token, PageSize, MaxReaders>::replace( const key_type &key, Args&&... args ) {
+  if( !this->find( key ) ) return false;
+  const std::uint32_t cell_index{ this->construct_cell( std::forward<Args>( args )... ) };
+  std::atomic<std::uint64_t> &word{ m_slots[ std::get<0>( key ) ] };
+  const std::uint64_t old_word{ word.load( std::memory_order_relaxed ) };
+  word.store( make_word( generation_of( old_word ), cell_index ), std::memory_order_release );
+  this->retire( cell_of( old_word ) );
+  return true;
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+template<typename Function>
+bool concurrent_slot_map<T, Token, PageSize, MaxReaders>::update( const key_type &key, Function fn ) {
+  const value_type *current{ this->find( key ) };
+  if( !current ) return false;
+  value_type value( *current );
+  fn( value );
+  return this->replace( key, std::move( value ) );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+void concurrent_slot_map<T, Token, PageSize, MaxReaders>::reclaim( ) {
+  // Sections pinned before the new epoch may still use anything retired in an epoch at or after theirs.
+  const std::uint64_t epoch{ m_epoch.load( std::memory_order_relaxed ) + 1 };
+  m_epoch.store( epoch, std::memory_order_release );
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  std::uint64_t bound{ epoch };
+  for( const reader_record &record : m_readers ) {
+    // acquire: the reads of a section which closed happen before the cells it could see are destroyed
+    const std::uint64_t pinned{ record.epoch.load( std::memory_order_acquire ) };
+    if( pinned != 0 && pinned < bound ) bound = pinned;
+  }
+
+  std::size_t kept{ 0 };
+  for( const retired_cell &retired : m_retired ) {
+    if( retired.epoch < bound ) {
+      this->cell_value( retired.index )->~T( );
+      m_free_cells.push_back( retired.index );
+    }
+    else m_retired[ kept++ ] = retired;
+  }
+  m_retired.resize( kept );
+  m_slots.reclaim( bound );
+  m_cells.reclaim( bound );
+}
+
+#pragma endregion
+
+#pragma region lookup_impl
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+const typename concurrent_slot_map<T, Token, PageSize, MaxReaders>::value_type*
+concurrent_slot_map<T, Token, PageSize, MaxReaders>::find( const key_type &key ) const {
+  return this->lookup( key );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+template<typename Function>
+void concurrent_slot_map<T, Token, PageSize, MaxReaders>::for_each( Function fn ) const {
+  for( const key_size_type slot : m_dense ) {
+    const std::uint64_t word{ m_slots[ slot ].load( std::memory_order_relaxed ) };
+    fn( key_type{ slot, generation_of( word ) }, static_cast<const value_type &>( *this->cell_value( cell_of( word ) ) ) );
+  }
+}
+
+#pragma endregion
+
+#pragma region helpers_impl
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+template<typename... Args>
+std::uint32_t concurrent_slot_map<T, Token, PageSize, MaxReaders>::construct_cell( Args&&... args ) {
+  // Cells are only reused after reclaim( ), so no reader can see one while it is constructed.
+  std::uint32_t index;
+  if( !m_free_cells.empty( ) ) {
+    index = m_free_cells.back( );
+    ::new( static_cast<void *>( &m_cells[ index ] ) ) T( std::forward<Args>( args )... );
+    m_free_cells.pop_back( );
+    return index;
+  }
+  if( m_cell_count == std::numeric_limits<std::uint32_t>::max( ) ) throw std::length_error( "concurrent_slot_map has run out of cell indices." );
+  if( m_cell_count == m_cells.capacity( ) ) m_cells.add_page( m_epoch.load( std::memory_order_relaxed ) );
+  // Every cell can be retired and then freed, so retire( ) and reclaim( ) never allocate.
+  reserve_total( m_retired, m_cell_count + 1 );
+  reserve_total( m_free_cells, m_cell_count + 1 );
+  index = static_cast<std::uint32_t>( m_cell_count );
+  ::new( static_cast<void *>( &m_cells[ index ] ) ) T( std::forward<Args>( args )... );
+  ++m_cell_count;
+  return index;
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+void concurrent_slot_map<T, Token, PageSize, MaxReaders>::retire( std::uint32_t cell_index ) {
+  m_retired.push_back( retired_cell{ m_epoch.load( std::memory_order_relaxed ), cell_index } );
+  if( m_retired.size( ) >= reclaim_batch && m_retired.size( ) % reclaim_batch == 0 ) this->reclaim( );
+}
+
+// Makes room for the slot the next acquire_slot( ) takes. The only step of emplace( ) before the cell which can throw.
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+void concurrent_slot_map<T, Token, PageSize, MaxReaders>::reserve_slot( ) {
+  if( !m_free_slots.empty( ) ) return;
+  const std::size_t slot_count{ m_slot_count.load( std::memory_order_relaxed ) };
+  if( slot_count == static_cast<std::size_t>( std::numeric_limits<key_size_type>::max( ) ) ) {
+    throw std::length_error( "concurrent_slot_map has run out of key indices." );
+  }
+  if( slot_count == m_slots.capacity( ) ) m_slots.add_page( m_epoch.load( std::memory_order_relaxed ) );
+  // Every slot can be live or free, so emplace( ) and erase( ) never allocate for them.
+  reserve_total( m_dense, slot_count + 1 );
+  reserve_total( m_dense_position, slot_count + 1 );
+  reserve_total( m_free_slots, slot_count + 1 );
+}
+
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+typename concurrent_slot_map<T, Token, PageSize, MaxReaders>::key_size_type concurrent_slot_map<T, Token, PageSize, MaxReaders>::acquire_slot( ) {
+  if( !m_free_slots.empty( ) ) {
+    const key_size_type slot{ m_free_slots.back( ) };
+    m_free_slots.pop_back( );
+    return slot;
+  }
+  const std::size_t slot_count{ m_slot_count.load( std::memory_order_relaxed ) };
+  m_slots[ slot_count ].store( make_word( key_generation_type{ }, 0 ), std::memory_order_relaxed );
+  m_dense_position.push_back( 0 );
+  // Readers accept the new index once they see the count, by then the slot and its page are visible.
+  m_slot_count.store( slot_count + 1, std::memory_order_release );
+  return static_cast<key_size_type>( slot_count );
+}
+
+// Grows vector geometrically until count elements fit, so pushing up to count elements can't throw.
+template<typename T, typename Token, std::size_t PageSize, std::size_t MaxReaders>
+template<typename Vector>
+void concurrent_slot_map<T, Token, PageSize, MaxReaders>::reserve_total( Vector &vector, std::size_t count ) {
+  if( vector.capacity( ) < count ) vector.reserve( count > 2 * vector.capacity( ) ? count : 2 * vector.capacity( ) );
+}
+
+#pragma endregion
@@ -0,0 +1,302 @@
+#pragma once
+#include <cstddef> // size_t, ptrdiff_t
+#include <iterator> // random_access_iterator_tag, reverse_iterator
+#include <utility> // forward, move, swap
+#include <memory> // allocator, allocator_traits, addressof
+#include <memory_resource> // polymorphic_allocator
+#include <type_traits> // conditional, enable_if
+#include <algorithm> // move
+#include <limits> // numeric_limits
+#include <vector>
+
+// The default page size of a paged_vector: the largest power of two number of elements fitting in 64 KiB, at least 1.
+template<typename T>
+constexpr std::size_t paged_vector_page_size( ) {
+  std::size_t elements{ 1 };
+  while( elements * 2 * sizeof( T ) <= 65536 ) elements *= 2;
+  return elements;
+}
+
+// A sequence container storing its elements in fixed size pages, found through a table of page pointers.
+// Growing never moves an element: it appends a page, so push_back costs O(1) without the O(N) spike of a vector
+// reallocation, and references to elements stay valid until the element is erased.
+// Pages are kept until destruction and capacity() grows one page at a time, so reserve() never over allocates by more
+// than a page. Like a vector, iterators are invalidated when capacity() changes, references are not.
+// Provides the subset of the vector interface slot_map uses, see paged below for use as a slot_map Container.
+// Elements are not contiguous, so slot_map<soa<Ts...>>::column( ) is not available with paged columns.
+// Pages are allocated and elements constructed through Allocator, the page table uses Allocator rebound to T*.
+template<typename T, std::size_t PageSize = paged_vector_page_size<T>( ), typename Allocator = std::allocator<T>>
+class paged_vector {
+  static_assert( PageSize > 0 && ( PageSize & ( PageSize - 1 ) ) == 0, "The page size of a paged_vector must be a power of two." );
+  template<bool _Const>
+  class basic_iterator;
+  using allocator_traits = std::allocator_traits<Allocator>;
+  using page_table_allocator = typename allocator_traits::template rebind_alloc<T*>;
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  static constexpr size_type page_size{ PageSize };
+
+  paged_vector( ) = default;
+  explicit paged_vector( const Allocator &allocator ) : m_pages( page_table_allocator( allocator ) ) { }
+  paged_vector( const paged_vector &other );
+  paged_vector( paged_vector &&other ) noexcept;
+  ~paged_vector( );
+  paged_vector& operator=( const paged_vector &rhs );
+  paged_vector& operator=( paged_vector &&rhs ) noexcept( allocator_traits::propagate_on_container_move_assignment::value
+                                                          || allocator_traits::is_always_equal::value );
+  // The page table keeps the allocator, rebound to T*.
+  allocator_type get_allocator( ) const { return allocator_type( m_pages.get_allocator( ) ); }
+
+  // Iterators
+  constexpr iterator begin( ) { return iterator( m_pages.data( ), 0 ); }
+  constexpr iterator end( ) { return iterator( m_pages.data( ), static_cast<difference_type>( m_size ) ); }
+  constexpr const_iterator begin( ) const { return const_iterator( m_pages.data( ), 0 ); }
+  constexpr const_iterator end( ) const { return const_iterator( m_pages.data( ), static_cast<difference_type>( m_size ) ); }
+  constexpr const_iterator cbegin( ) const { return this->begin( ); }
+  constexpr const_iterator cend( ) const { return this->end( ); }
+  constexpr reverse_iterator rbegin( ) { return reverse_iterator( this->end( ) ); }
+  constexpr reverse_iterator rend( ) { return reverse_iterator( this->begin( ) ); }
+  constexpr const_reverse_iterator rbegin( ) const { return const_reverse_iterator( this->end( ) ); }
+  constexpr const_reverse_iterator rend( ) const { return const_reverse_iterator( this->begin( ) ); }
+  constexpr const_reverse_iterator crbegin( ) const { return this->rbegin( ); }
+  constexpr const_reverse_iterator crend( ) const { return this->rend( ); }
+
+  // Capacity
+  constexpr bool empty( ) const { return m_size == 0; }
+  constexpr size_type size( ) const { return m_size; }
+  constexpr size_type max_size( ) const { return std::numeric_limits<difference_type>::max( ) / sizeof( T ); }
+  constexpr size_type capacity( ) const { return m_pages.size( ) * PageSize; }
+  void reserve( size_type n );
+  constexpr size_type page_count( ) const { return m_pages.size( ); }
+  void shrink_to_fit( ); // frees the pages past the last element
+
+  // Element access
+  constexpr reference operator[]( size_type index ) { return m_pages[ index / PageSize ][ index % PageSize ]; }
+  constexpr const_reference operator[]( size_type index ) const { return m_pages[ index / PageSize ][ index % PageSize ]; }
+  constexpr reference back( ) { return ( *this )[ m_size - 1 ]; }
+  constexpr const_reference back( ) const { return ( *this )[ m_size - 1 ]; }
+
+  // Modifiers
+  void clear( );
+  void push_back( const_reference value ) { this->emplace_back( value ); }
+  void push_back( value_type &&value ) { this->emplace_back( std::move( value ) ); }
+  template<typename... Args>
+  void emplace_back( Args&&... args );
+  void pop_back( );
+  iterator erase( const_iterator first, const_iterator last );
+
+private:
+  std::vector<T*, page_table_allocator> m_pages;
+  size_type m_size{ 0 };
+
+  void allocate_page( );
+  void release( );
+  void steal( paged_vector &other );
+};
+
+template<typename T, std::size_t PageSize, typename Allocator>
+template<bool _Const>
+class paged_vector<T, PageSize, Allocator>::basic_iterator {
+  friend class paged_vector<T, PageSize, Allocator>;
+  friend class basic_iterator<!_Const>;
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = T;
+  using reference = std::conditional_t<_Const, const T&, T&>;
+  using pointer = std::conditional_t<_Const, const T*, T*>;
+  using difference_type = std::ptrdiff_t;
+
+  constexpr basic_iterator( ) = default;
+  constexpr basic_iterator( const basic_iterator & ) = default;
+  // iterator converts to const_iterator
+  template<bool _Other, typename = std::enable_if_t<_Const && !_Other>>
+  constexpr basic_iterator( const basic_iterator<_Other> &other ) : m_pages( other.m_pages ), m_index( other.m_index ) { }
+  constexpr basic_iterator& operator=( const basic_iterator & ) = default;
+
+  constexpr reference operator*( ) const { return m_pages[ m_index / PageSize ][ m_index % PageSize ]; }
+  constexpr pointer operator->( ) const { return std::addressof( **this ); }
+  constexpr reference operator[]( difference_type n ) const { return *( *this + n ); }
+
+  constexpr basic_iterator& operator++( ) { ++m_index; return *this; }
+  constexpr basic_iterator operator++( int ) { basic_iterator result{ *this }; ++m_index; return result; }
+  constexpr basic_iterator& operator--( ) { --m_index; return *this; }
+  constexpr basic_iterator operator--( int ) { basic_iterator result{ *this }; --m_index; return result; }
+  constexpr basic_iterator& operator+=( difference_type n ) { m_index += static_cast<size_type>( n ); return *this; }
+  constexpr basic_iterator& operator-=( difference_type n ) { m_index -= static_cast<size_type>( n ); return *this; }
+  friend constexpr basic_iterator operator+( basic_iterator it, difference_type n ) { return it += n; }
+  friend constexpr basic_iterator operator+( difference_type n, basic_iterator it ) { return it += n; }
+  friend constexpr basic_iterator operator-( basic_iterator it, difference_type n ) { return it -= n; }
+  friend constexpr difference_type operator-( const basic_iterator &lhs, const basic_iterator &rhs ) {
+    return static_cast<difference_type>( lhs.m_index ) - static_cast<difference_type>( rhs.m_index );
+  }
+
+  friend constexpr bool operator==( const basic_iterator &lhs, const basic_iterator &rhs ) { return lhs.m_index == rhs.m_index && lhs.m_pages == rhs.m_pages; }
+  friend constexpr bool operator!=( const basic_iterator &lhs, const basic_iterator &rhs ) { return !( lhs == rhs ); }
+  friend constexpr bool operator<( const basic_iterator &lhs, const basic_iterator &rhs ) { return lhs.m_index < rhs.m_index; }
+  friend constexpr bool operator>( const basic_iterator &lhs, const basic_iterator &rhs ) { return rhs < lhs; }
+  friend constexpr bool operator<=( const basic_iterator &lhs, const basic_iterator &rhs ) { return !( rhs < lhs ); }
+  friend constexpr bool operator>=( const basic_iterator &lhs, const basic_iterator &rhs ) { return !( lhs < rhs ); }
+
+private:
+  // The index is unsigned so the page and offset are a shift and a mask.
+  constexpr basic_iterator( T *const *pages, difference_type index ) : m_pages( pages ), m_index( static_cast<size_type>( index ) ) { }
+
+  T *const *m_pages{ nullptr };
+  size_type m_index{ 0 };
+};
+
+// Adapts a page size for the Container parameter of slot_map: slot_map<T, Token, paged<4096>::container>.
+template<std::size_t PageSize>
+struct paged {
+  template<typename T>
+  using container = paged_vector<T, PageSize>;
+};
+
+// A paged_vector with the default page size for its element type, usable directly as a slot_map Container.
+template<typename T>
+using paged_container = paged_vector<T>;
+// paged_container allocating from a std::pmr::memory_resource.
+template<typename T>
+using pmr_paged_container = paged_vector<T, paged_vector_page_size<T>( ), std::pmr::polymorphic_allocator<T>>;
+
+template<typename T, std::size_t PageSize, typename Allocator>
+paged_vector<T, PageSize, Allocator>::paged_vector( const paged_vector &other )
+  : m_pages( std::allocator_traits<page_table_allocator>::select_on_container_copy_construction( other.m_pages.get_allocator( ) ) ) {
+  this->reserve( other.m_size );
+  try {
+    for( const T &value : other ) this->push_back( value );
+  }
+  catch( ... ) {
+    this->release( );
+    throw;
+  }
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+paged_vector<T, PageSize, Allocator>::paged_vector( paged_vector &&other ) noexcept
+  : m_pages( std::move( other.m_pages ) )
+  , m_size( other.m_size ) {
+  other.m_pages.clear( );
+  other.m_size = 0;
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+paged_vector<T, PageSize, Allocator>::~paged_vector( ) {
+  this->release( );
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+paged_vector<T, PageSize, Allocator>& paged_vector<T, PageSize, Allocator>::operator=( const paged_vector &rhs ) {
+  if( this != &rhs ) {
+    paged_vector copy( rhs );
+    *this = std::move( copy );
+  }
+  return *this;
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+paged_vector<T, PageSize, Allocator>& paged_vector<T, PageSize, Allocator>::operator=( paged_vector &&rhs )
+  noexcept( allocator_traits::propagate_on_container_move_assignment::value || allocator_traits::is_always_equal::value ) {
+  if( this == &rhs ) return *this;
+  if constexpr( allocator_traits::propagate_on_container_move_assignment::value || allocator_traits::is_always_equal::value ) {
+    this->steal( rhs );
+  }
+  else if( this->get_allocator( ) == rhs.get_allocator( ) ) {
+    this->steal( rhs );
+  }
+  else { // the pages of rhs belong to another allocator, so the elements are moved one by one
+    this->clear( );
+    this->reserve( rhs.m_size );
+    for( T &value : rhs ) this->push_back( std::move( value ) );
+    rhs.clear( );
+  }
+  return *this;
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+void paged_vector<T, PageSize, Allocator>::reserve( size_type n ) {
+  while( this->capacity( ) < n ) this->allocate_page( );
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+void paged_vector<T, PageSize, Allocator>::shrink_to_fit( ) {
+  const size_type used_pages{ ( m_size + PageSize - 1 ) / PageSize };
+  Allocator allocator( m_pages.get_allocator( ) );
+  for( size_type i{ used_pages }; i < m_pages.size( ); ++i ) allocator_traits::deallocate( allocator, m_pages[ i ], PageSize );
+  m_pages.resize( used_pages );
+  m_pages.shrink_to_fit( );
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+void paged_vector<T, PageSize, Allocator>::clear( ) {
+  while( m_size ) this->pop_back( );
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+template<typename... Args>
+void paged_vector<T, PageSize, Allocator>::emplace_back( Args&&... args ) {
+  if( m_size == this->capacity( ) ) this->allocate_page( );
+  Allocator allocator( m_pages.get_allocator( ) );
+  allocator_traits::construct( allocator, m_pages[ m_size / PageSize ] + m_size % PageSize, std::forward<Args>( args )... );
+  ++m_size;
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+void paged_vector<T, PageSize, Allocator>::pop_back( ) {
+  Allocator allocator( m_pages.get_allocator( ) );
+  allocator_traits::destroy( allocator, std::addressof( ( *this )[ --m_size ] ) );
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+typename paged_vector<T, PageSize, Allocator>::iterator paged_vector<T, PageSize, Allocator>::erase( const_iterator first, const_iterator last ) {
+  const iterator position( m_pages.data( ), static_cast<difference_type>( first.m_index ) );
+  const size_type count{ last.m_index - first.m_index };
+  if( count ) {
+    std::move( position + static_cast<difference_type>( count ), this->end( ), position );
+    for( size_type i{ 0 }; i < count; ++i ) this->pop_back( );
+  }
+  return position;
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+void paged_vector<T, PageSize, Allocator>::allocate_page( ) {
+  // Only the page table can reallocate here, and it holds one pointer per page.
+  m_pages.push_back( nullptr );
+  try {
+    Allocator allocator( m_pages.get_allocator( ) );
+    m_pages.back( ) = allocator_traits::allocate( allocator, PageSize );
+  }
+  catch( ... ) {
+    m_pages.pop_back( );
+    throw;
+  }
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+void paged_vector<T, PageSize, Allocator>::release( ) {
+  this->clear( );
+  Allocator allocator( m_pages.get_allocator( ) );
+  for( T *page : m_pages ) allocator_traits::deallocate( allocator, page, PageSize );
+  m_pages.clear( );
+}
+
+template<typename T, std::size_t PageSize, typename Allocator>
+void paged_vector<T, PageSize, Allocator>::steal( paged_vector &other ) {
+  // Only called when the pages of other can be freed by this vector's allocator once the page table moves over.
+  this->release( );
+  m_pages = std::move( other.m_pages );
+  m_size = other.m_size;
+  other.m_pages.clear( );
+  other.m_size = 0;
+}
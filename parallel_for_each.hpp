@@ -0,0 +1,213 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+#pragma once
+#include <cstddef> // size_t
+#include <atomic> // atomic
+#include <thread> // thread, hardware_concurrency
+#include <vector> // vector
+#include <exception> // exception_ptr
+#include <algorithm> // for_each, min
+#include <numeric> // iota
+#include <type_traits> // decay_t
+#if defined(ADL_USE_EXECUTION_POLICIES) // opt in, libstdc++ needs -ltbb as soon as <execution> is included
+#include <execution> // execution policies
+#endif
+#include "slot_array.hpp"
+#include "slot_map.hpp"
+namespace ADL
+{
+  /*
+  * @brief: Schedulers run a batch of independent chunks for parallel_for_each.
+  * A scheduler provides parallel_for(chunk_count, task), which calls task(i) once for every i in [0, chunk_count),
+  * possibly concurrently, and returns when every call has finished. Any type with that member can be passed to
+  * parallel_for_each, so it can be backed by an existing job system.
+  * Standard execution policies are also accepted when ADL_USE_EXECUTION_POLICIES is defined.
+  */
+
+  /*
+  * @brief: Runs every chunk on the calling thread, in order.
+  */
+  struct serial_scheduler
+  {
+    template<typename Task>
+    void parallel_for(std::size_t chunk_count, Task task) const
+    {
+      for (std::size_t chunk{ 0 }; chunk < chunk_count; ++chunk)
+      {
+        task(chunk);
+      }
+    }
+  };
+
+  /*
+  * @brief: Runs the chunks on short lived std::threads, with the calling thread working as one of them.
+  * Workers claim chunks from a shared counter, so uneven chunks balance themselves.
+  * @note: The first exception thrown by a chunk is rethrown once every worker has joined, remaining chunks are skipped.
+  */
+  class thread_scheduler
+  {
+  public:
+    explicit thread_scheduler(unsigned workers = std::thread::hardware_concurrency())
+      : m_workers(workers == 0u ? 1u : workers)
+    {
+    }
+
+    inline unsigned workers() const noexcept { return m_workers; }
+
+    template<typename Task>
+    void parallel_for(std::size_t chunk_count, Task task) const;
+
+  private:
+    unsigned m_workers;
+  };
+
+  /*
+  * @brief Calls task for every chunk using up to workers() threads.
+  * @param chunk_count The number of chunks to run.
+  * @param task Called with the index of each chunk.
+  */
+  template<typename Task>
+  void thread_scheduler::parallel_for(std::size_t chunk_count, Task task) const
+  {
+    const std::size_t thread_count{ std::min<std::size_t>(m_workers, chunk_count) };
+    if (thread_count <= 1u)
+    {
+      serial_scheduler{}.parallel_for(chunk_count, task);
+      return;
+    }
+
+    std::atomic<std::size_t> next_chunk{ 0 };
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+    auto work = [&]()
+    {
+      for (std::size_t chunk{ next_chunk.fetch_add(1, std::memory_order_relaxed) }; chunk < chunk_count;
+           chunk = next_chunk.fetch_add(1, std::memory_order_relaxed))
+      {
+        try
+        {
+          task(chunk);
+        }
+        catch (...)
+        {
+          if (!failed.exchange(true))
+          {
+            error = std::current_exception();
+          }
+          next_chunk.store(chunk_count, std::memory_order_relaxed);
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1u);
+    for (std::size_t i{ 1 }; i < thread_count; ++i)
+    {
+      threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads)
+    {
+      thread.join();
+    }
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+
+#if defined(ADL_USE_EXECUTION_POLICIES)
+  /*
+  * @brief: Runs the chunks with a standard execution policy, such as std::execution::par.
+  * @note: With libstdc++ the parallel policies are implemented on TBB, link with -ltbb.
+  */
+  template<typename _Policy>
+  struct policy_scheduler
+  {
+    _Policy policy;
+
+    template<typename Task>
+    void parallel_for(std::size_t chunk_count, Task task) const
+    {
+      std::vector<std::size_t> chunks(chunk_count);
+      std::iota(chunks.begin(), chunks.end(), std::size_t{ 0 });
+      std::for_each(policy, chunks.begin(), chunks.end(), [&task](std::size_t chunk) { task(chunk); });
+    }
+  };
+#endif
+
+  namespace detail
+  {
+    template<typename _Scheduler>
+    decltype(auto) as_scheduler(_Scheduler &&scheduler)
+    {
+#if defined(ADL_USE_EXECUTION_POLICIES)
+      using policy_type = std::decay_t<_Scheduler>;
+      if constexpr (std::is_execution_policy_v<policy_type>)
+      {
+        return policy_scheduler<policy_type>{ scheduler };
+      }
+      else
+#endif
+      {
+        return std::forward<_Scheduler>(scheduler);
+      }
+    }
+
+    inline std::size_t chunk_count(std::size_t size, std::size_t grain) noexcept
+    {
+      return grain == 0u ? 0u : ( size + grain - 1u ) / grain;
+    }
+  }
+
+  /*
+  * @brief Calls fn on every live element of a slot_array, splitting the slots into chunks run by a scheduler.
+  * @detail Chunks are a whole number of occupancy words wide, so no two chunks read the same bitmap word.
+  *         Elements may be modified in place by fn. Allocating or freeing during the call is undefined.
+  * @param scheduler A scheduler, or a standard execution policy.
+  * @param pool The slot_array to visit.
+  * @param fn Called with a reference to each live element. Calls from different chunks may run concurrently.
+  * @param grain The minimum number of slots per chunk, rounded up to a multiple of 64. Defaults to 1024.
+  */
+  template<typename _Scheduler, typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats,
+           typename Function>
+  void parallel_for_each(_Scheduler &&scheduler, const slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats> &pool, Function fn,
+                         unsigned grain = 1024u)
+  {
+    const unsigned size{ pool.partition_size() };
+    const unsigned chunk{ grain < 64u ? 64u : ( grain + 63u ) & ~63u };
+    detail::as_scheduler(std::forward<_Scheduler>(scheduler)).parallel_for(detail::chunk_count(size, chunk), [&](std::size_t i)
+    {
+      const unsigned first{ static_cast<unsigned>(i) * chunk };
+      pool.for_each_in(first, std::min(first + chunk, size), fn);
+    });
+  }
+
+  /*
+  * @brief Calls fn on every element of a slot_map, splitting the dense element storage into chunks run by a scheduler.
+  * @detail Elements may be modified in place by fn, for SoA storage fn receives the proxy reference.
+  *         Inserting or erasing during the call is undefined.
+  * @param scheduler A scheduler, or a standard execution policy.
+  * @param map The slot_map to visit.
+  * @param fn Called with a reference to each element. Calls from different chunks may run concurrently.
+  * @param grain The number of elements per chunk. Defaults to 1024.
+  */
+  template<typename _Scheduler, typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth,
+           typename Stats, typename Deferred, typename Function>
+  void parallel_for_each(_Scheduler &&scheduler, slot_map<T, Token, Container, Layout, Growth, Stats, Deferred> &map, Function fn, std::size_t grain = 1024u)
+  {
+    const std::size_t size{ map.size() };
+    const std::size_t chunk{ grain == 0u ? 1u : grain };
+    const auto first_element{ map.begin() };
+    detail::as_scheduler(std::forward<_Scheduler>(scheduler)).parallel_for(detail::chunk_count(size, chunk), [&](std::size_t i)
+    {
+      const std::size_t last{ std::min(( i + 1u ) * chunk, size) };
+      auto it{ first_element + static_cast<std::ptrdiff_t>(i * chunk) };
+      for (std::size_t element{ i * chunk }; element < last; ++element, ++it)
+      {
+        fn(*it);
+      }
+    });
+  }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstring> // memcpy
+#include <new> // placement new
+#include <type_traits> // integral_constant, is_trivially_copyable
+#include <utility> // move, swap
+
+// Whether a T can be moved to a new address by copying its bytes, leaving nothing to destroy at the old address.
+// Trivially copyable types always can. Specialize this for other types which can, such as types holding owning
+// pointers with no self references: template<> struct trivially_relocatable<particle> : std::true_type { };
+// slot_array and slot_map then move their elements with memcpy instead of a move constructor or assignment plus a
+// destructor call.
+template<typename T>
+struct trivially_relocatable : std::is_trivially_copyable<T> { };
+
+template<typename T>
+inline constexpr bool trivially_relocatable_v = trivially_relocatable<T>::value;
+
+// Trades the bytes of two objects. For trivially relocatable types this is a valid swap.
+template<typename T>
+void swap_bytes( T &a, T &b ) noexcept {
+  alignas( T ) unsigned char buffer[ sizeof( T ) ];
+  std::memcpy( buffer, static_cast<void *>( &a ), sizeof( T ) );
+  std::memcpy( static_cast<void *>( &a ), static_cast<void *>( &b ), sizeof( T ) );
+  std::memcpy( static_cast<void *>( &b ), buffer, sizeof( T ) );
+}
+
+// Moves the live object from into hole, a live object which is about to be removed. from is left for its container
+// to destroy, as after a move assignment: trivially copyable values are assigned, and other trivially relocatable
+// values are swapped bytewise, so destroying from destroys the value which used to be in hole.
+template<typename T>
+constexpr void fill_hole( T &hole, T &from ) {
+  if constexpr( std::is_trivially_copyable_v<T> || !trivially_relocatable_v<T> ) hole = std::move( from );
+  else swap_bytes( hole, from );
+}
+
+// Swaps two live objects, bytewise for trivially relocatable types which aren't trivially copyable.
+template<typename T>
+constexpr void swap_values( T &a, T &b ) {
+  if constexpr( std::is_trivially_copyable_v<T> || !trivially_relocatable_v<T> ) {
+    using std::swap;
+    swap( a, b );
+  }
+  else swap_bytes( a, b );
+}
+
+// Moves the live object at from into the uninitialized storage at to, leaving from uninitialized.
+template<typename T>
+void relocate_at( T *to, T *from ) {
+  if constexpr( trivially_relocatable_v<T> ) std::memcpy( static_cast<void *>( to ), static_cast<void *>( from ), sizeof( T ) );
+  else {
+    ::new( static_cast<void *>( to ) ) T( std::move( *from ) );
+    from->~T( );
+  }
+}
@@ -6,9 +6,292 @@
 #include <cstdint> // int64_t, USHRT_MAX
 #include <iterator> // iterator
 #include <memory> // unique_ptr
+#include <memory_resource> // memory_resource
+#include <new> // bad_alloc
+#include <cstring> // memcpy
+#include <atomic> // atomic counters of slot_stats::counters
+#include <array> // array
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h> // gathers for validate()
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward64, _BitScanReverse64
+#include <xmmintrin.h> // _mm_prefetch
+#endif
 #include "../Debugging/Asserts.hpp"
+#include "relocate.hpp"
 namespace ADL
 {
+  namespace detail
+  {
+    /*
+    * @brief Finds the index of the lowest set bit of a word.
+    * @param word The word to scan. Must not be zero.
+    * @return The zero based index of the lowest set bit.
+    */
+    inline unsigned lowest_set_bit(uint64_t word) noexcept
+    {
+#if defined(_MSC_VER)
+      unsigned long index;
+      _BitScanForward64(&index, word);
+      return static_cast<unsigned>(index);
+#else
+      return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+    }
+
+    /*
+    * @brief Finds the index of the highest set bit of a word.
+    * @param word The word to scan. Must not be zero.
+    * @return The zero based index of the highest set bit.
+    */
+    inline unsigned highest_set_bit(uint64_t word) noexcept
+    {
+#if defined(_MSC_VER)
+      unsigned long index;
+      _BitScanReverse64(&index, word);
+      return static_cast<unsigned>(index);
+#else
+      return 63u - static_cast<unsigned>(__builtin_clzll(word));
+#endif
+    }
+
+    /*
+    * @brief Hints the CPU to start loading the cache line holding an address. Never faults.
+    * @param address Any address, it doesn't need to be valid.
+    */
+    inline void prefetch(const void *address) noexcept
+    {
+#if defined(_MSC_VER)
+      _mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#else
+      __builtin_prefetch(address, 0, 3);
+#endif
+    }
+
+    /*
+    * @brief Returns an array of trivial objects to the memory resource it was allocated from.
+    */
+    template<typename U>
+    struct resource_deleter
+    {
+      std::pmr::memory_resource *resource;
+      std::size_t count;
+      void operator()(U *array) const noexcept
+      {
+        resource->deallocate(array, count * sizeof(U), alignof(U));
+      }
+    };
+
+    /*
+    * @brief The memory resource of storage adopted from a snapshot image, see slot_array::adopt_snapshot().
+    * @detail The image is owned by the caller, so nothing is returned to the resource and it can't allocate.
+    */
+    class adopted_memory_resource : public std::pmr::memory_resource
+    {
+      void* do_allocate(std::size_t, std::size_t) override
+      {
+        throw std::bad_alloc();
+      }
+      void do_deallocate(void *, std::size_t, std::size_t) override
+      {
+      }
+      bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+      {
+        return this == &other;
+      }
+    };
+
+    inline std::pmr::memory_resource* adopted_resource() noexcept
+    {
+      static adopted_memory_resource resource;
+      return &resource;
+    }
+
+    /*
+    * @brief The first bytes of a slot_array snapshot image, describing the type that wrote it.
+    * @detail Snapshots are native: integers are in the byte order of the writer, and the image can only be
+    *         read back by a slot_array with the same parameters built for the same ABI.
+    */
+    struct slot_array_snapshot_header
+    {
+      static const uint32_t magic_value = 0x534C4441u; // "ADLS" read as little endian
+      static const uint32_t current_version = 1u;
+
+      uint32_t magic;
+      uint32_t version;
+      uint32_t value_size;
+      uint32_t value_alignment;
+      uint32_t slot_size;
+      uint32_t elements;
+      uint32_t layout; // 0 in place, 1 split, 2 dense
+      uint32_t id_bits;
+      uint32_t index_bits;
+      uint32_t size;
+      uint32_t max_used;
+      uint32_t free_head;
+      uint32_t high_water;
+      uint32_t reserved;
+      uint64_t total_size;
+    };
+  }
+
+  namespace slot_layout
+  {
+    /*
+    * @brief Default slot_array layout. Each object is stored in place in its slot, next to the slot's header.
+    */
+    struct in_place {};
+
+    /*
+    * @brief Stores the slot headers in their own array, apart from the objects.
+    * @detail Objects stay at the index of their slot, but consecutive objects are exactly sizeof(T) apart
+    *         and keep the alignment of T, so they can be read with aligned vector loads.
+    */
+    struct split {};
+
+    /*
+    * @brief Packs the live objects of a slot_array at the front of a separate array, in the style of slot_map.
+    * @detail Slots only hold headers and the dense position of their object. A dense->slot table is used to
+    *         find the slot of an object when it is freed, and the last object is moved into the hole.
+    *         Iteration walks the packed objects with no branches on liveness.
+    */
+    struct dense {};
+  }
+
+  /*
+  * @brief Describes how a slot_array packs the liveness bit, generation counter and slot index into an ID.
+  * @detail The top bit of an ID is the liveness bit, the lowest _Index_Bits hold the slot index,
+  *         and all the bits in between are used for the generation counter.
+  * @param _Id The unsigned integer type of the IDs. Also used for the bit fields of the element headers.
+  * @param _Index_Bits The number of bits used for the slot index. Limits the capacity to 2^_Index_Bits - 1 elements.
+  */
+  template<typename _Id, unsigned _Index_Bits>
+  struct slot_key
+  {
+    static_assert(std::is_unsigned<_Id>::value, "The ID type of a slot_key must be an unsigned integer.");
+    static_assert(_Index_Bits > 0u && _Index_Bits <= 32u, "A slot_key must use between 1 and 32 bits for its index.");
+    static_assert(_Index_Bits + 2u <= sizeof(_Id) * 8u, "A slot_key needs at least 1 bit for the generation counter.");
+
+    using id_type = _Id;
+    // smallest type able to hold an index, used for tables of indices.
+    using index_type = typename std::conditional<(_Index_Bits <= 16u), uint16_t, uint32_t>::type;
+    static const unsigned id_bits = sizeof(_Id) * 8u;
+    static const unsigned index_bits = _Index_Bits;
+    static const unsigned generation_bits = id_bits - 1u - _Index_Bits;
+    static const id_type index_mask = ( id_type{ 1 } << index_bits ) - 1u;
+    static const id_type generation_mask = ( id_type{ 1 } << generation_bits ) - 1u;
+    // The index field also has to store one past the last element to terminate the free list.
+    static const uint64_t max_elements = index_mask;
+  };
+
+  // 32 bit IDs supporting up to 64k elements with a 15 bit generation counter. The default for slot_array.
+  using slot_key_32 = slot_key<uint32_t, 16u>;
+  // 64 bit IDs supporting up to 4 billion elements with a 31 bit generation counter.
+  using slot_key_64 = slot_key<uint64_t, 32u>;
+
+  /*
+  * @brief A snapshot of the instrumentation of a slot_array, see slot_array::statistics().
+  * @detail The event counters are only counted by slot_stats::counters and stay 0 otherwise.
+  *         The gauges are always filled in.
+  */
+  struct slot_array_statistics
+  {
+    // events
+    uint64_t allocs;        // objects allocated
+    uint64_t frees;         // objects freed, including by clear()
+    uint64_t dense_moves;   // dense layout only: objects moved into the hole left by a freed object
+    uint64_t lookups;       // IDs checked by get_safely(), get_many() and validate()
+    uint64_t stale_lookups; // IDs among those which were stale or out of range
+    // gauges
+    unsigned size;
+    unsigned capacity;
+    unsigned max_used;
+    unsigned high_water;    // slots at or past this index have never been used
+    unsigned free_slots;    // length of the free list: used slots which are not live
+    // occupancy_histogram[i] counts the blocks of 64 consecutive slots below the high-water mark holding from 8i - 7
+    // to 8i live objects, occupancy_histogram[0] the blocks holding none. The last block can be shorter than 64 slots.
+    std::array<unsigned, 9> occupancy_histogram;
+  };
+
+  namespace slot_stats
+  {
+    /*
+    * @brief Default slot_array instrumentation. Nothing is counted, the hooks compile away and take no space.
+    */
+    struct none
+    {
+      static constexpr bool enabled = false;
+      void count_allocs(unsigned) const noexcept {}
+      void count_frees(unsigned, unsigned) const noexcept {}
+      void count_lookups(unsigned, unsigned) const noexcept {}
+      void fill_statistics(slot_array_statistics &) const noexcept {}
+      void reset_counters() noexcept {}
+    };
+
+    /*
+    * @brief Counts slot_array events with relaxed atomic counters.
+    * @detail Counts are exact while one thread uses the slot_array. Const lookups from several threads can count
+    *         concurrently without a data race, but then some increments can be lost, and there is no ordering
+    *         between counters. Copies copy the counters.
+    */
+    class counters
+    {
+    public:
+      static constexpr bool enabled = true;
+      counters() = default;
+      counters(const counters &rhs) noexcept { copy(rhs); }
+      counters& operator=(const counters &rhs) noexcept { copy(rhs); return *this; }
+
+      void count_allocs(unsigned count) const noexcept { add(m_allocs, count); }
+      void count_frees(unsigned count, unsigned moved) const noexcept
+      {
+        add(m_frees, count);
+        add(m_dense_moves, moved);
+      }
+      void count_lookups(unsigned count, unsigned stale) const noexcept
+      {
+        add(m_lookups, count);
+        add(m_stale_lookups, stale);
+      }
+      void fill_statistics(slot_array_statistics &statistics) const noexcept
+      {
+        statistics.allocs = m_allocs.load(std::memory_order_relaxed);
+        statistics.frees = m_frees.load(std::memory_order_relaxed);
+        statistics.dense_moves = m_dense_moves.load(std::memory_order_relaxed);
+        statistics.lookups = m_lookups.load(std::memory_order_relaxed);
+        statistics.stale_lookups = m_stale_lookups.load(std::memory_order_relaxed);
+      }
+      void reset_counters() noexcept { copy(counters{}); }
+
+    private:
+      using counter = std::atomic<uint64_t>;
+      // A relaxed load and store rather than a locked read-modify-write, so counting costs a plain add.
+      static void add(counter &c, unsigned n) noexcept { c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+      static void copy_counter(counter &to, const counter &from) noexcept
+      {
+        to.store(from.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+      void copy(const counters &rhs) noexcept
+      {
+        copy_counter(m_allocs, rhs.m_allocs);
+        copy_counter(m_frees, rhs.m_frees);
+        copy_counter(m_dense_moves, rhs.m_dense_moves);
+        copy_counter(m_lookups, rhs.m_lookups);
+        copy_counter(m_stale_lookups, rhs.m_stale_lookups);
+      }
+
+      mutable counter m_allocs{ 0 };
+      mutable counter m_frees{ 0 };
+      mutable counter m_dense_moves{ 0 };
+      mutable counter m_lookups{ 0 };
+      mutable counter m_stale_lookups{ 0 };
+    };
+  }
+
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  class slot_pool;
+
   /*
   * @brief: slot_array is a fixed-size container of linear memory.
   * slot_array makes the following promises:
@@ -27,35 +310,68 @@ namespace ADL
   * @param _Elements The max number of elements the container can hold. Defaults to 2048.
   * @param _Use_Heap Whether element storage should be on the heap or in place. Defaults to on the heap.\n
   *        Specify false when dynamically allocating the slot_array object itself to prevent extra allocations.
+  * @param _Layout How objects are laid out in memory. Defaults to slot_layout::in_place.\n
+  *        Specify slot_layout::split to store the element headers out of line so objects are laid out like a T[].\n
+  *        Specify slot_layout::dense to keep live objects packed for iteration. Keys remain stable, but raw pointers\n
+  *        and iterators are invalidated by free() because the last object is moved into the freed position.
+  * @param _Key The slot_key layout of IDs. Defaults to slot_key_32.\n
+  *        Specify slot_key_64 (or another slot_key) for containers with more than 64k elements.
+  * @param _Stats The instrumentation policy. Defaults to slot_stats::none, which has no overhead.\n
+  *        Specify slot_stats::counters to count allocations, frees and stale lookups, see statistics().
   *
-  * @note: the structure can not contain more than 64k elements.
-  * this is because of bit field usage and the max value of 2^16.
+  * @note: the structure can not contain more than _Key::max_elements elements, 64k with the default key.
+  * this is because the header bit fields and IDs reserve _Key::index_bits for the index.
   * 
   * @note: When copied, the elements in the copy will maintain ordering, but weak reference keys will not be valid on the new container.
   * @note: Due to the way some <algorithm> functions work, their usage may invalidate all references/keys/pointers.\n 
   *        Be aware of this when considering using <algorithm> functions with slot_array. 
+  * @note: Liveness is mirrored in an occupancy bitmap so iteration skips 64 dead slots per word read.\n
+  *        Iteration cost scales with the number of live elements rather than _Elements.
+  * @note: Objects are stored with the alignment of T, including over-aligned and SIMD types.
+  * @note: Storage is not initialized up front. Slots past the high-water mark are handed out in order once the\n
+  *        free list is empty, so memory for slots that were never used is never touched.
+  * @note: Heap storage is allocated from a std::pmr::memory_resource, the default resource unless one is passed to\n
+  *        the constructor. The resource must outlive the slot_array.
   */
-  template<typename T, unsigned _Elements = 2048u, bool _Use_Heap = true>
-  class slot_array
+  template<typename T, unsigned _Elements = 2048u, bool _Use_Heap = true, typename _Layout = slot_layout::in_place, typename _Key = slot_key_32,
+           typename _Stats = slot_stats::none>
+  class slot_array : private _Stats
   {
-    static_assert(_Elements < UINT16_MAX, "Tried to declare a slot_array with over the maximum capacity (2^16).");
+    static_assert(_Elements < _Key::max_elements, "Tried to declare a slot_array with over the maximum capacity of its key (2^_Key::index_bits).");
+    static_assert(std::is_same<_Layout, slot_layout::in_place>::value || std::is_same<_Layout, slot_layout::split>::value
+                  || std::is_same<_Layout, slot_layout::dense>::value,
+                  "The layout of a slot_array must be one of the slot_layout types.");
+  public:
+    using id_type = typename _Key::id_type;
   protected:
-    struct element
+    using index_type = typename _Key::index_type;
+    static constexpr bool is_dense = std::is_same<_Layout, slot_layout::dense>::value;
+    static constexpr bool is_in_place = std::is_same<_Layout, slot_layout::in_place>::value;
+    using object_storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    struct element_header
     {
-      element()
-        : is_alive(0)
-        , counter(0)
-        , index(0)
+      // Left trivial so untouched storage is never written, slots are initialized when first handed out.
+      element_header() = default;
+
+      id_type is_alive : 1;
+      id_type counter : _Key::generation_bits; // unique ID to differentiate current from previous objects allocated in the same slot.
+      id_type index : _Key::index_bits; // stores either the next freelist entry or the position of the allocated element's object.
+      id_type make_ID(unsigned index) const
       {
+        return ( ( id_type{ is_alive } << ( _Key::id_bits - 1u ) ) | ( id_type{ counter } << _Key::index_bits ) | index );
       }
+    };
 
-      typename std::aligned_storage<sizeof(T), 4>::type object;
-      unsigned is_alive : 1;
-      unsigned counter : 15; // unique ID to differentiate current from previous objects allocated in the same slot.
-      unsigned index : 16; // stores either the next freelist entry or the allocated element's index.
-      unsigned make_ID(unsigned index) const { return ( (is_alive << 31) | (counter << 16) | index ); }
-      
+    struct element
+    {
+      object_storage object;
+      element_header header;
     };
+
+    // The split and dense layouts keep their objects in a separate array, so their slots only need the header.
+    using slot_type = typename std::conditional<is_in_place, element, element_header>::type;
+    struct no_storage {};
   public:
     class iterator;
     using value_type = T;
@@ -65,14 +381,17 @@ namespace ADL
     using const_pointer = const pointer;
     using const_reference = const reference;
     using difference_type = ptrdiff_t;
-    static const size_t storage_size = sizeof( decltype(element::object) );
+    static const size_t storage_size = sizeof( object_storage );
 
-    slot_array(); // allocs all the items
+    slot_array(); // allocs all the items from std::pmr::get_default_resource()
+    explicit slot_array(std::pmr::memory_resource *resource); // allocs all the items from resource
     ~slot_array();
     void clear(); // resets data members, destructs any remaining objects
     
     template<typename... Args>
     T& alloc(Args&&... args); // creates an element and returns a reference to it.
+    template<typename Generator>
+    void alloc_n(unsigned count, Generator generator, id_type *IDs = nullptr); // creates count elements from generator(i).
     
     iterator erase(iterator position);
     iterator erase(iterator first, iterator last);
@@ -80,29 +399,61 @@ namespace ADL
 
     void free(T&);                    // releases the object and puts it on the free list.
     void free(iterator);              // releases the object and puts it on the free list.
-    unsigned get_ID(T&)        const; // retreive the ID of the referenced element.
-    T& get(unsigned ID)        const; // returns the item referenced by ID
-    T* get_safely(unsigned ID) const; // validates the ID before attempting to return the elemnt. nullptr if invalid.
+    void free_n(const id_type *IDs, unsigned count); // releases the objects referenced by count valid IDs.
+    void free_n(T * const *objects, unsigned count); // releases count objects.
+    id_type get_ID(T&)         const; // retreive the ID of the referenced element.
+    T& get(id_type ID)         const; // returns the item referenced by ID
+    T* get_safely(id_type ID)  const; // validates the ID before attempting to return the elemnt. nullptr if invalid.
+    void get_many(const id_type *IDs, unsigned count, T **objects) const; // get_safely for count IDs, prefetching ahead.
+    void validate(const id_type *IDs, unsigned count, uint64_t *valid) const; // sets bit i of valid if get_safely(IDs[i]) would succeed.
     bool next(T *&)            const; // retrieves the next live item.
     bool previous(T *&)        const; // retrieves the previous live item.
 
-    iterator begin() const;
-    const iterator end() const; // May be added in the future to support range-based for loops.
+    iterator begin() const noexcept;
+    const iterator end() const noexcept; // May be added in the future to support range-based for loops.
 
     inline unsigned capacity()    const noexcept { return m_capacity; }
+    std::pmr::memory_resource* get_memory_resource() const noexcept; // nullptr when _Use_Heap is false
     inline unsigned max_usage()   const noexcept { return m_max_used; }
     inline unsigned size()        const noexcept { return m_size; }
     inline bool empty()           const noexcept { return m_size == 0u; }
     inline float saturation()     const noexcept { return static_cast<float>(m_size) / m_capacity; }
     inline float max_saturation() const noexcept { return static_cast<float>(m_max_used) / m_capacity; }
+    slot_array_statistics statistics() const; // event counters of _Stats and the gauges, O(high-water mark)
+    void reset_statistics() noexcept { this->reset_counters(); } // zeroes the event counters
     
     template<typename Predicate>
-    void remove_if(Predicate p);
+    void remove_if(Predicate p); // frees every object p(object) is true for, in one pass over the live objects
+
+    // Deferred frees, to kill objects while iterating: defer_erase() only marks the slot, so objects stay where they are
+    // until flush_erases() frees every marked object in one batch. The dense layout frees them by descending packed
+    // position, so the objects moved into the holes are never marked ones. Marking a slot twice marks it once, and
+    // freeing a marked object directly unmarks it. The marks are a bitmap allocated (heap) or zeroed (in place) by the
+    // first defer_erase(), so slot_arrays which never defer a free don't pay for it.
+    void defer_erase(id_type ID);  // marks the object referenced by a valid ID
+    void defer_erase(T&);          // marks the object
+    void defer_erase(iterator);    // marks the object
+    inline unsigned pending_erases() const noexcept { return m_pending_count; } // marked objects
+    unsigned flush_erases();       // frees the marked objects, returns how many were freed
+
+    // Range visitation for splitting iteration across threads, see parallel_for_each.hpp.
+    // Ranges index slots, or packed positions for the dense layout, and every live object is in [0, partition_size()).
+    unsigned partition_size() const noexcept;
+    template<typename Function>
+    void for_each_in(unsigned first, unsigned last, Function f) const; // calls f(T&) for the live objects in [first, last)
+
+    // Snapshots: the slot_array as one image of contiguous arrays behind a versioned header, for trivially copyable T.
+    // IDs stay valid across a write_snapshot() and load_snapshot() or adopt_snapshot() round trip.
+    static constexpr size_t snapshot_alignment = alignof(T) > 64u ? alignof(T) : 64u; // alignment of image buffers
+    static constexpr size_t snapshot_size() noexcept; // size in bytes of the image of any slot_array of this type
+    void write_snapshot(void *image) const;           // writes snapshot_size() bytes to image
+    bool load_snapshot(const void *image, size_t size);  // copies the image in, false if it doesn't match this type
+    bool adopt_snapshot(void *image, size_t size);       // heap only: uses the image as storage without copying it
 
 
     class iterator : public std::iterator< std::bidirectional_iterator_tag, T>
     {
-      friend class slot_array<T, _Elements, _Use_Heap>;
+      friend class slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>;
     public:
       using value_type = T;
       using pointer = T *;
@@ -112,7 +463,7 @@ namespace ADL
       iterator(const iterator &rhs);
       iterator(const slot_array &container, T &obj);
       iterator(const slot_array &container, T *obj);
-      iterator(const slot_array &container, unsigned ID);
+      iterator(const slot_array &container, id_type ID);
       iterator& operator=(const iterator &rhs);
       iterator& operator++();
       iterator  operator++(int);
@@ -134,120 +485,203 @@ namespace ADL
     };
 
   private:
-    value_type * as_value_type(unsigned index) const;
-    
+    template<typename, unsigned, typename, typename>
+    friend class slot_pool; // finds the block of an object from the address range of the block's storage
 
-    unsigned get_index(T&) const;
+    value_type * as_value_type(unsigned position) const;
+    element_header& header_at(unsigned index);
+    const element_header& header_at(unsigned index) const;
+    unsigned position_of(const T *) const;
 
-    unsigned m_capacity : 16; // total allocated capacity
-    unsigned m_max_used : 16; // max ever active items
-    unsigned m_size : 16; // current active items
-    unsigned m_free_head : 16; // first free element
+    unsigned get_index(T&) const;
+    void release(unsigned index, unsigned live_count, unsigned free_head);
+    unsigned take_slot(unsigned &free_head, unsigned &high_water);
+    unsigned validate_simd(const id_type *IDs, unsigned count, uint64_t *valid) const noexcept;
+    void prefetch_slot(id_type ID) const noexcept;
+    void prefetch_object(id_type ID) const noexcept;
+    unsigned find_next_live(unsigned first) const noexcept;  // first live index >= first, m_capacity if none.
+    unsigned find_previous_live(unsigned last) const noexcept; // last live index < last, m_capacity if none.
+    void set_live(unsigned index) noexcept;
+    void set_dead(unsigned index) noexcept;
+    void prepare_pending();
+    void mark_pending(unsigned index);
+    void unmark_pending(unsigned index) noexcept;
+    void discard_pending() noexcept;
+
+    // Byte offsets of the arrays in a snapshot image, each aligned to snapshot_alignment.
+    struct snapshot_layout
+    {
+      size_t data;
+      size_t occupancy;
+      size_t objects;
+      size_t erase_helper;
+      size_t total;
+    };
+    static constexpr snapshot_layout snapshot_offsets() noexcept;
+    bool snapshot_matches(const void *image, size_t size, detail::slot_array_snapshot_header &header) const noexcept;
+    void restore_counters(const detail::slot_array_snapshot_header &header) noexcept;
+
+    unsigned m_capacity : _Key::index_bits; // total allocated capacity
+    unsigned m_max_used : _Key::index_bits; // max ever active items
+    unsigned m_size : _Key::index_bits; // current active items
+    unsigned m_free_head : _Key::index_bits; // first free element, m_capacity when only never-used slots remain
+    unsigned m_high_water : _Key::index_bits; // slots at or past this index have never been used
+    unsigned m_pending_count : _Key::index_bits; // slots marked by defer_erase()
+    unsigned m_pending_ready : 1; // in place only: m_pending was zeroed by the first defer_erase()
+
+    static const unsigned occupancy_word_bits = 64u;
+    // How many IDs ahead get_many() prefetches objects. Slot headers are prefetched twice as far ahead.
+    static const unsigned prefetch_distance = 8u;
+    // validate() gathers 32 bit header words with 32 bit byte offsets, so the headers must fit in 2GB.
+    static constexpr bool simd_validate = sizeof(id_type) == 4u && sizeof(element_header) == 4u
+                                       && uint64_t{ _Elements } * sizeof(slot_type) < ( uint64_t{ 1 } << 31 );
+    // The dense layout iterates its packed objects directly and doesn't maintain the bitmap.
+    static const unsigned occupancy_words = is_dense ? 1u : (_Elements + occupancy_word_bits - 1) / occupancy_word_bits;
+    static const unsigned pending_words = (_Elements + occupancy_word_bits - 1) / occupancy_word_bits;
 
     // Use the heap (dynamic allocation) if _Use_Heap is true, otherwise use an array on the stack.
-    typename std::conditional<_Use_Heap, std::unique_ptr<element[]>, element[_Elements]>::type m_data;
-    //element m_data[_Elements];
-
-    // These two template functions abstract the access of the container data so that it is accessed correctly.
-    template< bool dynamic = _Use_Heap >
-    void init_storage() { m_data = std::unique_ptr<element[]>(new element[m_capacity]); }
-    template<>
-    void init_storage<false>() {}
-    template< bool dynamic = _Use_Heap >
-    const element* data() const { return m_data.get(); }
-    template<>
-    const element* data<false>() const { return &m_data[0]; }
+    template<typename U, unsigned _Count = _Elements>
+    using storage = typename std::conditional<_Use_Heap, std::unique_ptr<U[], detail::resource_deleter<U>>, U[_Count]>::type;
+    storage<slot_type> m_data;
+
+    // One bit per element, set while the element is alive. Kept apart from m_data so scans don't touch elements.
+    storage<uint64_t, occupancy_words> m_occupancy;
+    // One bit per slot, set while the object is marked by defer_erase(). Indexed by slot for every layout.
+    // Only set up by the first defer_erase(): heap storage starts as a null array whose deleter holds the resource.
+    storage<uint64_t, pending_words> m_pending;
+
+    // Split and dense layouts only: the objects, indexed by slot for split and packed for dense.
+    typename std::conditional<is_in_place, no_storage, storage<object_storage>>::type m_objects;
+    // Dense layout only: the slot owning each packed object (see slot_map's m_erase_helper).
+    typename std::conditional<is_dense, storage<index_type>, no_storage>::type m_erase_helper;
+
+    // These two functions abstract the access of the container data so that it is accessed correctly.
+    void init_storage(std::pmr::memory_resource *resource)
+    {
+      if constexpr (_Use_Heap)
+      {
+        m_data = allocate_storage<slot_type>(resource, m_capacity);
+        m_occupancy = allocate_storage<uint64_t>(resource, occupancy_words);
+        std::memset(m_occupancy.get(), 0, occupancy_words * sizeof(uint64_t));
+        m_pending = storage<uint64_t>(nullptr, detail::resource_deleter<uint64_t>{ resource, pending_words });
+        if constexpr (!is_in_place)
+        {
+          m_objects = allocate_storage<object_storage>(resource, m_capacity);
+        }
+        if constexpr (is_dense)
+        {
+          m_erase_helper = allocate_storage<index_type>(resource, m_capacity);
+        }
+      }
+      else
+      {
+        (void)resource;
+      }
+    }
+    // The stored types are all trivial, so the storage is used as allocated.
+    template<typename U>
+    static storage<U> allocate_storage(std::pmr::memory_resource *resource, std::size_t count)
+    {
+      return storage<U>(static_cast<U *>(resource->allocate(count * sizeof(U), alignof(U))), detail::resource_deleter<U>{ resource, count });
+    }
+    const void* data() const
+    {
+      if constexpr (is_in_place)
+        return &m_data[0];
+      else
+        return &m_objects[0];
+    }
   };
 
   
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  slot_array<T, _Elements, _Use_Heap>::iterator::iterator(const iterator &rhs)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::iterator(const iterator &rhs)
     : m_data(rhs.m_data)
     , m_container(rhs.m_container)
   {}
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  slot_array<T, _Elements, _Use_Heap>::iterator::iterator(const slot_array &container, element &obj)
-    : m_data( reinterpret_cast<T*>(&element.object) )
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::iterator(const slot_array &container, element &obj)
+    : m_data( reinterpret_cast<T*>(&obj.object) )
     , m_container(&container)
   {}
   
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  slot_array<T, _Elements, _Use_Heap>::iterator::iterator(const slot_array &container, T &obj)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::iterator(const slot_array &container, T &obj)
     : m_data( reinterpret_cast<T*>(&obj) )
     , m_container(&container)
   {}
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  slot_array<T, _Elements, _Use_Heap>::iterator::iterator(const slot_array &container, T *obj)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::iterator(const slot_array &container, T *obj)
     : m_data(obj)
     , m_container(&container)
   {}
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  slot_array<T, _Elements, _Use_Heap>::iterator::iterator(const slot_array &container, unsigned ID)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::iterator(const slot_array &container, id_type ID)
     : m_data( container.get_safely(ID) )
     , m_container(&container)
   {}
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator& slot_array<T, _Elements, _Use_Heap>::iterator::operator=(const iterator &rhs)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator=(const iterator &rhs)
   {
     m_data = rhs.m_data;
     m_container = rhs.m_container;
     return *this;
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator& slot_array<T, _Elements, _Use_Heap>::iterator::operator++()
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator++()
   {
     m_container->next(m_data);
     return *this;
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator slot_array<T, _Elements, _Use_Heap>::iterator::operator++(int)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator++(int)
   {
     iterator it{ *this };
     m_container->next(m_data);
     return it;
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator& slot_array<T, _Elements, _Use_Heap>::iterator::operator--()
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator--()
   {
     m_container->previous(m_data);
     return *this;
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator slot_array<T, _Elements, _Use_Heap>::iterator::operator--(int)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator--(int)
   {
     iterator it{ *this };
     m_container->previous(m_data);
     return it;
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  bool slot_array<T, _Elements, _Use_Heap>::iterator::operator==(const iterator& rhs) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  bool slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator==(const iterator& rhs) const
   {
     return ( (m_data == rhs.m_data) && (m_container == rhs.m_container) );
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  bool slot_array<T, _Elements, _Use_Heap>::iterator::operator!=(const iterator& rhs) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  bool slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator!=(const iterator& rhs) const
   {
     return ((m_data != rhs.m_data) || (m_container != rhs.m_container));
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::value_type& slot_array<T, _Elements, _Use_Heap>::iterator::operator*() const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::value_type& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator*() const
   {
     return *m_data;
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::value_type* slot_array<T, _Elements, _Use_Heap>::iterator::operator->() const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::value_type* slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator::operator->() const
   {
     return m_data;
   }
@@ -257,83 +691,388 @@ namespace ADL
   * @param object The object for which an index is being acquired.
   * @return the index corresponding to the 'object' param.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  unsigned slot_array<T, _Elements, _Use_Heap>::get_index(T& object) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::get_index(T& object) const
+  {
+    const unsigned position{ position_of(&object) };
+    ADL_ASSERT_MSG( position < ( is_dense ? m_size : m_capacity ), "Tried to free an element that was out of bounds.");
+    // Packed objects don't live in their slot, the dense->slot table knows which slot owns them.
+    if constexpr (is_dense)
+      return m_erase_helper[position];
+    else
+      return position;
+  }
+
+  /*
+  * @brief Retrieve the storage position of an object from its address.
+  * @detail For the in place and split layouts this is the index of the element, for the dense layout it is the packed position.
+  * @param object The object for which a position is being acquired.
+  * @return the position of the object within the storage it is allocated in.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::position_of(const T *object) const
+  {
+    if constexpr (is_in_place)
+      return static_cast<unsigned>( reinterpret_cast<const element*>(object) - static_cast<const element*>(data()) );
+    else
+      return static_cast<unsigned>( reinterpret_cast<const object_storage*>(object) - static_cast<const object_storage*>(data()) );
+  }
+
+  /*
+  * @brief Access the header of a slot.
+  * @param index The index of the slot.
+  * @return The header holding the liveness, counter and free list/position index of the slot.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::element_header& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::header_at(unsigned index)
   {
-    unsigned index;
-    //int64_t index{ reinterpret_cast<element*>(&object) - reinterpret_cast<element*>(m_data) };
-    if( reinterpret_cast<element*>(&object)->is_alive )
-      index = reinterpret_cast<element*>(&object)->index;
+    if constexpr (is_in_place)
+      return m_data[index].header;
     else
+      return m_data[index];
+  }
+
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  const typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::element_header& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::header_at(unsigned index) const
+  {
+    if constexpr (is_in_place)
+      return m_data[index].header;
+    else
+      return m_data[index];
+  }
+
+  /*
+  * @brief Finds the first live element at or after an index using the occupancy bitmap.
+  * @param first The index to start searching from.
+  * @return The index of the first live element >= 'first', or m_capacity if there is none.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::find_next_live(unsigned first) const noexcept
+  {
+    if (first >= m_capacity)
     {
-      const element* left = reinterpret_cast<element*>(&object);
-      const element* right = data();
-      index = static_cast<unsigned>( left - right );
+      return m_capacity;
     }
-    ADL_ASSERT_MSG( ( index < m_capacity ) && ( index >= 0 ), "Tried to free an element that was out of bounds.");
-    //return static_cast<unsigned>(index);
-    return index;
+    unsigned word{ first / occupancy_word_bits };
+    // mask off the bits below 'first' in the starting word
+    uint64_t bits{ m_occupancy[word] & ( ~uint64_t{ 0 } << ( first % occupancy_word_bits ) ) };
+    while (bits == 0u)
+    {
+      if (++word == occupancy_words)
+      {
+        return m_capacity;
+      }
+      bits = m_occupancy[word];
+    }
+    return word * occupancy_word_bits + detail::lowest_set_bit(bits);
   }
 
   /*
-  * @brief Casts an element index to a pointer to an object of the value_type type stored at that index.
-  * @param index The index of the object to retrieve
-  * @return Pointer to the object stored at the index referenced by the 'index' param.
+  * @brief Finds the last live element before an index using the occupancy bitmap.
+  * @param last One past the index to start searching backwards from.
+  * @return The index of the last live element < 'last', or m_capacity if there is none.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  T* slot_array<T, _Elements, _Use_Heap>::as_value_type(unsigned index) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::find_previous_live(unsigned last) const noexcept
+  {
+    if (last == 0u)
+    {
+      return m_capacity;
+    }
+    const unsigned index{ last - 1 };
+    unsigned word{ index / occupancy_word_bits };
+    // mask off the bits above 'index' in the starting word
+    uint64_t bits{ m_occupancy[word] & ( ~uint64_t{ 0 } >> ( occupancy_word_bits - 1 - index % occupancy_word_bits ) ) };
+    while (bits == 0u)
+    {
+      if (word == 0u)
+      {
+        return m_capacity;
+      }
+      bits = m_occupancy[--word];
+    }
+    return word * occupancy_word_bits + detail::highest_set_bit(bits);
+  }
+
+  /*
+  * @brief Marks an element as alive in the occupancy bitmap.
+  * @param index The index of the element.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::set_live(unsigned index) noexcept
+  {
+    m_occupancy[index / occupancy_word_bits] |= uint64_t{ 1 } << ( index % occupancy_word_bits );
+  }
+
+  /*
+  * @brief Marks an element as dead in the occupancy bitmap.
+  * @param index The index of the element.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::set_dead(unsigned index) noexcept
+  {
+    m_occupancy[index / occupancy_word_bits] &= ~( uint64_t{ 1 } << ( index % occupancy_word_bits ) );
+  }
+
+  /*
+  * @brief Sets up the defer_erase() marks on first use, so slot_arrays which never defer a free don't pay for them.
+  * @detail Heap storage is allocated from the resource passed to the constructor, even after adopt_snapshot().
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::prepare_pending()
+  {
+    if constexpr (_Use_Heap)
+    {
+      if (!m_pending)
+      {
+        m_pending = allocate_storage<uint64_t>(m_pending.get_deleter().resource, pending_words);
+        std::memset(m_pending.get(), 0, pending_words * sizeof(uint64_t));
+      }
+    }
+    else if (!m_pending_ready)
+    {
+      std::memset(&m_pending[0], 0, pending_words * sizeof(uint64_t));
+      m_pending_ready = 1u;
+    }
+  }
+
+  /*
+  * @brief Sets the defer_erase() mark of a slot, if it doesn't have one.
+  * @param index The index of the slot.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::mark_pending(unsigned index)
+  {
+    prepare_pending();
+    uint64_t& word{ m_pending[index / occupancy_word_bits] };
+    const uint64_t bit{ uint64_t{ 1 } << ( index % occupancy_word_bits ) };
+    m_pending_count += ( word & bit ) == 0u ? 1u : 0u;
+    word |= bit;
+  }
+
+  /*
+  * @brief Clears the defer_erase() mark of a slot, if it has one.
+  * @param index The index of the slot.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::unmark_pending(unsigned index) noexcept
+  {
+    uint64_t& word{ m_pending[index / occupancy_word_bits] };
+    const uint64_t bit{ uint64_t{ 1 } << ( index % occupancy_word_bits ) };
+    m_pending_count -= ( word & bit ) != 0u ? 1u : 0u;
+    word &= ~bit;
+  }
+
+  /*
+  * @brief Clears every defer_erase() mark without freeing the marked objects.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::discard_pending() noexcept
+  {
+    if (m_pending_count != 0u)
+    {
+      std::memset(&m_pending[0], 0, pending_words * sizeof(uint64_t));
+      m_pending_count = 0u;
+    }
+  }
+
+  /*
+  * @brief Casts a storage position to a pointer to an object of the value_type type stored at that position.
+  * @param position The position of the object to retrieve. For the in place and split layouts this is the element index.
+  * @return Pointer to the object stored at the position referenced by the 'position' param.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  T* slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::as_value_type(unsigned position) const
   { 
-    return reinterpret_cast<value_type *>( const_cast<std::aligned_storage<sizeof(T), 4>::type *>(&m_data[index].object) );
+    if constexpr (is_in_place)
+      return reinterpret_cast<value_type *>( const_cast<object_storage *>(&m_data[position].object) );
+    else
+      return reinterpret_cast<value_type *>( const_cast<object_storage *>(&m_objects[position]) );
+  }
+
+  /*
+  * @brief Initializes all member variables and the free list, allocating from the default memory resource.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::slot_array()
+    : slot_array(std::pmr::get_default_resource())
+  {
   }
 
   /*
   * @brief Initializes all member variables and the free list.
-  * @detail If _Use_Heap is true it will allocate using the heap, 
-  * otherwise the elements will be stored in place in the slot_array.
+  * @detail If _Use_Heap is true it will allocate from resource, 
+  * otherwise the elements will be stored in place in the slot_array and resource is unused.
+  * The element storage is left untouched: the free list starts empty and slots are taken from the high-water mark.
+  * @param resource The memory resource heap storage is allocated from, such as a per-frame arena.\n
+  *        Memory is returned to it when the slot_array is destroyed.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  slot_array<T, _Elements, _Use_Heap>::slot_array()
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::slot_array(std::pmr::memory_resource *resource)
     : m_capacity(_Elements)
     , m_max_used(0)
     , m_size(0)
-    , m_free_head(0)
+    , m_free_head(_Elements)
+    , m_high_water(0)
+    , m_pending_count(0)
+    , m_pending_ready(0)
+    , m_occupancy()
   {
-    init_storage();
-    
-    // Setup the in place free list
-    for (unsigned i{ 0 }; i < m_capacity; ++i)
+    init_storage(resource);
+  }
+
+  /*
+  * @brief The memory resource the storage of the slot_array was allocated from.
+  * @return The resource passed to the constructor, or nullptr when the storage is in place.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  std::pmr::memory_resource* slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::get_memory_resource() const noexcept
+  {
+    if constexpr (_Use_Heap)
     {
-      m_data[i].index = i + 1;
+      return m_data.get_deleter().resource;
+    }
+    else
+    {
+      return nullptr;
     }
   }
 
+  /*
+  * @brief Reads the event counters of the _Stats policy, and measures the gauges.
+  * @detail The occupancy histogram is built from the occupancy bitmap, or from the slot headers for the dense layout,
+  *         so it costs O(high-water mark).
+  * @return The counters, which are 0 with slot_stats::none, and the current gauges.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array_statistics slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::statistics() const
+  {
+    slot_array_statistics statistics{};
+    this->fill_statistics(statistics);
+    statistics.size = m_size;
+    statistics.capacity = m_capacity;
+    statistics.max_used = m_max_used;
+    statistics.high_water = m_high_water;
+    statistics.free_slots = m_high_water - m_size;
+    for (unsigned block{ 0u }; block < m_high_water; block += occupancy_word_bits)
+    {
+      unsigned live{ 0u };
+      if constexpr (is_dense)
+      {
+        const unsigned block_end{ std::min<unsigned>(block + occupancy_word_bits, m_high_water) };
+        for (unsigned index{ block }; index < block_end; ++index)
+        {
+          live += header_at(index).is_alive;
+        }
+      }
+      else
+      {
+        for (uint64_t bits{ m_occupancy[block / occupancy_word_bits] }; bits != 0u; bits &= bits - 1u)
+        {
+          ++live;
+        }
+      }
+      ++statistics.occupancy_histogram[( live + 7u ) / 8u];
+    }
+    return statistics;
+  }
+
+  /*
+  * @brief Takes a slot for a new object, from the free list if possible and otherwise from the high-water mark.
+  * @detail Slots from the high-water mark are touched for the first time here, and get a fresh header.\n
+  *         Takes the free list head and high-water mark by reference so bulk operations can write them back once.
+  * @param free_head The first slot of the free list. Advanced past the taken slot.
+  * @param high_water The first never-used slot. Advanced past the taken slot.
+  * @return The index of the taken slot. The caller is responsible for marking it live.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::take_slot(unsigned &free_head, unsigned &high_water)
+  {
+    if (free_head != m_capacity)
+    {
+      const unsigned index{ free_head };
+      element_header& elem{ header_at(index) };
+      ADL_ASSERT_MSG(elem.is_alive == false, "Tried to allocate in an element that is already in use.");
+      // remove the element from the free list
+      free_head = static_cast<unsigned>( elem.index );
+      return index;
+    }
+    ADL_ASSERT_MSG(high_water < m_capacity, "Tried to allocate in a fully saturated container.");
+    const unsigned index{ high_water++ };
+    element_header& elem{ header_at(index) };
+    elem.is_alive = false;
+    elem.counter = 0u;
+    return index;
+  }
+
   /*
   * @brief destructs all live objects and releases any memory it allocated.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  slot_array<T, _Elements, _Use_Heap>::~slot_array()
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::~slot_array()
   {
     clear();
   }
 
   /*
-  * @brief Releases all live elements and sets up the free list.
+  * @brief Releases all live elements and adds their slots to the free list.
+  * @detail Only live slots are visited: the occupancy bitmap is walked for the in place and split layouts,
+  *         and the packed objects for the dense layout. Objects are not destructed one by one when T is trivially
+  *         destructible. Counters are still incremented, so the IDs of the released objects are no longer valid.\n
+  *         Slots are spliced onto the front of the free list lowest index first, then the list is written back once.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  void slot_array<T, _Elements, _Use_Heap>::clear()
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::clear()
   {
-    for (unsigned i{ 0 }; i < m_capacity; ++i)
+    if (m_size == 0u)
     {
-      if (m_data[i].is_alive)
+      return;
+    }
+    unsigned free_head{ m_free_head };
+    if constexpr (is_dense)
+    {
+      // Packed objects are all live, release them back to front so the object in position 0 heads the free list.
+      for (unsigned position{ m_size }; position-- > 0u; )
       {
-        free( *reinterpret_cast<T*>( &m_data[i] ) );
+        const unsigned index{ m_erase_helper[position] };
+        element_header& elem{ header_at(index) };
+        if constexpr (!std::is_trivially_destructible<T>::value)
+        {
+          as_value_type(position)->~T();
+        }
+        ++elem.counter;
+        elem.is_alive = false;
+        elem.index = free_head;
+        free_head = index;
       }
-      
-      m_data[i].index = i + 1;
     }
-
-    ADL_ASSERT(m_size == 0);
-    m_free_head = 0;
+    else
+    {
+      for (unsigned word{ occupancy_words }; word-- > 0u; )
+      {
+        uint64_t bits{ m_occupancy[word] };
+        while (bits != 0u)
+        {
+          const unsigned bit{ detail::highest_set_bit(bits) };
+          bits &= ~( uint64_t{ 1 } << bit );
+          const unsigned index{ word * occupancy_word_bits + bit };
+          element_header& elem{ header_at(index) };
+          if constexpr (!std::is_trivially_destructible<T>::value)
+          {
+            as_value_type(index)->~T();
+          }
+          ++elem.counter;
+          elem.is_alive = false;
+          elem.index = free_head;
+          free_head = index;
+        }
+        m_occupancy[word] = 0u;
+      }
+    }
+    this->count_frees(m_size, 0u);
+    discard_pending();
+    m_size = 0u;
+    m_free_head = free_head;
   }
 
   /*
@@ -341,46 +1080,108 @@ namespace ADL
   * @param args Any arguments passed to the function will be forwarded to the constructor of the value_type.
   * @return A reference to the allocated object.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap> 
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats> 
   template<typename... Args>
-  T& slot_array<T, _Elements, _Use_Heap>::alloc(Args&&... args)
+  T& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::alloc(Args&&... args)
   {
     ADL_ASSERT_MSG(m_size < m_capacity, "Tried to allocate in a fully saturated container.");
-    element& elem{ m_data[m_free_head] };
-    ADL_ASSERT_MSG(elem.is_alive == false, "Tried to allocate in an element that is already in use.");
-    
-    unsigned temp = elem.index;
-    // The element stores it's own index if it is live
-    elem.index = m_free_head; 
-    // remove the element from the free list
-    m_free_head = temp;
-
-    T* data = new(&elem.object) T( std::forward<Args>(args)... );
-    
+    unsigned free_head{ m_free_head };
+    unsigned high_water{ m_high_water };
+    const unsigned index{ take_slot(free_head, high_water) };
+    // The element stores it's own index if it is live, or the packed position of its object in the dense layout.
+    const unsigned position{ is_dense ? m_size : index };
+
+    // The slot is only taken off the free list once the object exists, so a throwing constructor leaks nothing.
+    T* data = new(as_value_type(position)) T( std::forward<Args>(args)... );
+    m_free_head = free_head;
+    m_high_water = high_water;
+    element_header& elem{ header_at(index) };
+    elem.index = position;
     elem.is_alive = true;
+    if constexpr (is_dense)
+      m_erase_helper[elem.index] = static_cast<index_type>(index);
+    else
+      set_live(index);
     ++m_size;
     // set the max used if we have a new record;
-    m_max_used = std::max(m_max_used, m_size);
-    return *as_value_type(elem.index);
+    m_max_used = std::max<unsigned>(m_max_used, m_size);
+    this->count_allocs(1u);
+    return *data;
 
   }
 
+  /*
+  * @brief Allocates a batch of objects in the slot_array.
+  * @detail The slots are taken off the free list in one pass, and the max usage and statistics are updated once.
+  *         Each object is committed before the next is generated, so if generator or the constructor throws, the
+  *         objects already created stay allocated and the slot being filled stays on the free list.
+  * @param count The number of objects to allocate.
+  * @param generator Called as generator(i) for i in [0, count), its result is used to construct the i-th object.
+  * @param IDs If not nullptr, receives the IDs of the count allocated objects in allocation order.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  template<typename Generator>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::alloc_n(unsigned count, Generator generator, id_type *IDs)
+  {
+    ADL_ASSERT_MSG(count <= static_cast<unsigned>( m_capacity - m_size ), "Tried to allocate more elements than the container has free.");
+    const unsigned first_size{ m_size };
+    unsigned free_head{ m_free_head };
+    unsigned high_water{ m_high_water };
+    try
+    {
+      for (unsigned i{ 0u }; i < count; ++i)
+      {
+        const unsigned index{ take_slot(free_head, high_water) };
+        // The element stores it's own index if it is live, or the packed position of its object in the dense layout.
+        const unsigned position{ is_dense ? m_size : index };
+        new(as_value_type(position)) T( generator(i) );
+        m_free_head = free_head;
+        m_high_water = high_water;
+        element_header& elem{ header_at(index) };
+        elem.index = position;
+        elem.is_alive = true;
+        if constexpr (is_dense)
+          m_erase_helper[position] = static_cast<index_type>(index);
+        else
+          set_live(index);
+        ++m_size;
+        if (IDs)
+        {
+          IDs[i] = elem.make_ID(index);
+        }
+      }
+    }
+    catch (...)
+    {
+      m_max_used = std::max<unsigned>(m_max_used, m_size);
+      this->count_allocs(m_size - first_size);
+      throw;
+    }
+    // set the max used if we have a new record;
+    m_max_used = std::max<unsigned>(m_max_used, m_size);
+    this->count_allocs(count);
+  }
+
   /*
   * @brief Accesses an element of the slot_array by key. Only use this if the key is known to be valid.
   * @param ID An identifier known to be good that references an object in the slot_array
   * @return A reference to the object corresponding to the ID.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  T& slot_array<T, _Elements, _Use_Heap>::get(unsigned ID) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  T& slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::get(id_type ID) const
   {
-    // Acquire the 16 higher bits of the ID
+    // Acquire the generation bits of the ID
     // This isn't done in this get implementation, because it is assumed to be a valid ID.
-    //unsigned key{ ((ID >> 16) && 0xFFFF) };
+    //unsigned key{ ( ID >> _Key::index_bits ) & _Key::generation_mask };
 
-    // Acquire the 16 lower bits of the ID
-    unsigned index{ ID & 0x0000FFFF };
+    // Acquire the index bits of the ID
+    unsigned index{ static_cast<unsigned>( ID & _Key::index_mask ) };
     ADL_ASSERT_MSG(index < _Elements, "Invalid ID: Index out of range.");
-    return *as_value_type(index);
+    // The dense layout needs the slot header to find where the object is packed.
+    if constexpr (is_dense)
+      return *as_value_type(header_at(index).index);
+    else
+      return *as_value_type(index);
 
   }
 
@@ -389,51 +1190,297 @@ namespace ADL
   * @param ID An identifier that references an object in the slot_array
   * @return A pointer to the object corresponding to the ID. If the ID is invalid, it will return nullptr.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  T* slot_array<T, _Elements, _Use_Heap>::get_safely(unsigned ID) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  T* slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::get_safely(id_type ID) const
   {
-    // Acquire bits 16-30 (zero indexed) of the ID
-    unsigned key{ ( ID >> 16 ) & 0x7FFF };
-    //                            ^ 0111 1111 1111 1111
+    // Acquire the generation bits of the ID, everything between the index and the liveness bit.
+    // With slot_key_32 these are bits 16-30 (zero indexed): 0111 1111 1111 1111
+    id_type key{ ( ID >> _Key::index_bits ) & _Key::generation_mask };
 
-    // Acquire the 16 lower bits of the ID
-    unsigned index{ ID & 0xFFFF };
+    // Acquire the index bits of the ID
+    unsigned index{ static_cast<unsigned>( ID & _Key::index_mask ) };
     ADL_ASSERT_MSG(index < _Elements, "Invalid ID: Index out of range.");
-    element& object = m_data[index];
+    // Headers of slots past the high-water mark were never initialized.
+    if (index >= m_high_water)
+    {
+      this->count_lookups(1u, 1u);
+      return nullptr;
+    }
+    const element_header& object = header_at(index);
 
-    if(object.counter == key )
+    if(object.is_alive && object.counter == key )
     {
+      this->count_lookups(1u, 0u);
       return  as_value_type(object.index);
     }
     else
     {
+      this->count_lookups(1u, 1u);
       return nullptr;
     }
   }
 
+  /*
+  * @brief Looks up a batch of IDs, with the same checks as get_safely.
+  * @detail Lookups of random IDs are dominated by cache misses which the CPU can't overlap, because each one
+  *         depends on the slot header loaded before it. The headers are prefetched 2 * prefetch_distance IDs ahead,
+  *         and the objects prefetch_distance IDs ahead, by which time their header is usually in cache.
+  * @param IDs The IDs to look up. They don't need to be valid.
+  * @param count The number of IDs.
+  * @param objects Receives count pointers: the object referenced by each ID, or nullptr if the ID is invalid.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::get_many(const id_type *IDs, unsigned count, T **objects) const
+  {
+    const unsigned warmup{ count < 2u * prefetch_distance ? count : 2u * prefetch_distance };
+    for (unsigned i{ 0u }; i < warmup; ++i)
+    {
+      prefetch_slot(IDs[i]);
+    }
+    for (unsigned i{ 0u }; i < count; ++i)
+    {
+      if (i + 2u * prefetch_distance < count)
+      {
+        prefetch_slot(IDs[i + 2u * prefetch_distance]);
+      }
+      if (i + prefetch_distance < count)
+      {
+        prefetch_object(IDs[i + prefetch_distance]);
+      }
+      objects[i] = get_safely(IDs[i]);
+    }
+  }
+
+  /*
+  * @brief The end of the ranges accepted by for_each_in(), every live object is before it.
+  * @return The high-water mark, or the number of packed objects for the dense layout.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::partition_size() const noexcept
+  {
+    return is_dense ? m_size : m_high_water;
+  }
+
+  /*
+  * @brief Visits the live objects in a range of slots, for the dense layout a range of packed positions.
+  * @detail Disjoint ranges can be visited concurrently as long as nothing is allocated or freed meanwhile.
+  *         Ranges which start and end on multiples of 64 slots touch disjoint words of the occupancy bitmap.
+  * @param first The first slot of the range.
+  * @param last One past the last slot of the range, at most partition_size().
+  * @param f Called with a reference to each live object in the range, in slot order.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  template<typename Function>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::for_each_in(unsigned first, unsigned last, Function f) const
+  {
+    ADL_ASSERT_MSG(last <= partition_size(), "Tried to visit a range past the end of the slot_array.");
+    if constexpr (is_dense)
+    {
+      for (unsigned position{ first }; position < last; ++position)
+      {
+        f(*as_value_type(position));
+      }
+    }
+    else
+    {
+      for (unsigned word{ first / occupancy_word_bits }; word * occupancy_word_bits < last; ++word)
+      {
+        uint64_t bits{ m_occupancy[word] };
+        if (word == first / occupancy_word_bits)
+        {
+          bits &= ~uint64_t{ 0 } << ( first % occupancy_word_bits );
+        }
+        if (last < ( word + 1u ) * occupancy_word_bits)
+        {
+          bits &= ( uint64_t{ 1 } << ( last % occupancy_word_bits ) ) - 1u;
+        }
+        while (bits != 0u)
+        {
+          const unsigned bit{ detail::lowest_set_bit(bits) };
+          bits &= bits - 1u;
+          f(*as_value_type(word * occupancy_word_bits + bit));
+        }
+      }
+    }
+  }
+
+  /*
+  * @brief Checks a batch of IDs at once, with the same checks as get_safely.
+  * @detail With AVX2 or AVX-512 enabled and 32 bit IDs the slot headers are gathered and compared 8 or 16 IDs at a time,
+  *         so the result has no data dependent branches. Other configurations use a scalar loop.
+  * @param IDs The IDs to check. They don't need to be valid.
+  * @param count The number of IDs.
+  * @param valid Receives (count + 63) / 64 words. Bit i % 64 of word i / 64 is set if IDs[i] references a live object.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::validate(const id_type *IDs, unsigned count, uint64_t *valid) const
+  {
+    for (unsigned word{ 0u }; word < ( count + 63u ) / 64u; ++word)
+    {
+      valid[word] = 0u;
+    }
+    unsigned i{ validate_simd(IDs, count, valid) };
+    if constexpr (_Stats::enabled)
+    {
+      // get_safely() counts the IDs of the scalar loop.
+      unsigned found{ 0u };
+      for (unsigned word{ 0u }; word < ( i + 63u ) / 64u; ++word)
+      {
+        for (uint64_t bits{ valid[word] }; bits != 0u; bits &= bits - 1u)
+        {
+          ++found;
+        }
+      }
+      this->count_lookups(i, i - found);
+    }
+    for (; i < count; ++i)
+    {
+      valid[i / 64u] |= uint64_t{ get_safely(IDs[i]) != nullptr } << ( i % 64u );
+    }
+  }
+
+  /*
+  * @brief The vectorized part of validate().
+  * @detail Relies on the header bit fields being allocated from the low bit, as MSVC, GCC and Clang all do:
+  *         bit 0 is is_alive and the following generation_bits bits are the counter.
+  * @return The number of IDs checked. The rest are left for the scalar loop.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::validate_simd(const id_type *IDs, unsigned count, uint64_t *valid) const noexcept
+  {
+#if defined(__AVX2__) || defined(__AVX512F__)
+    if constexpr (simd_validate)
+    {
+      if (m_high_water == 0u)
+      {
+        return 0u;
+      }
+#if !defined(NDEBUG)
+      element_header probe{};
+      probe.is_alive = 1u;
+      probe.counter = 1u;
+      probe.index = 0u;
+      uint32_t probe_word;
+      std::memcpy(&probe_word, &probe, sizeof(probe_word));
+      ADL_ASSERT_MSG(probe_word == 3u, "validate() requires bit fields allocated from the low bit.");
+#endif
+      const char *base{ reinterpret_cast<const char *>(&header_at(0u)) };
+      unsigned i{ 0u };
+#if defined(__AVX512F__)
+      // The maskz shifts avoid the unmasked forms, which read _mm512_undefined_epi32() and warn on some GCC versions.
+      const __m512i index_mask16{ _mm512_set1_epi32(static_cast<int>(_Key::index_mask)) };
+      const __m512i generation_mask16{ _mm512_set1_epi32(static_cast<int>(_Key::generation_mask)) };
+      const __m512i last_index16{ _mm512_set1_epi32(static_cast<int>(m_high_water - 1u)) };
+      const __m512i stride16{ _mm512_set1_epi32(static_cast<int>(sizeof(slot_type))) };
+      for (; i + 16u <= count; i += 16u)
+      {
+        const __m512i ID{ _mm512_loadu_si512(IDs + i) };
+        const __m512i index{ _mm512_and_si512(ID, index_mask16) };
+        const __m512i generation{ _mm512_and_si512(_mm512_maskz_srli_epi32(__mmask16(0xFFFF), ID, _Key::index_bits), generation_mask16) };
+        const __mmask16 in_range{ _mm512_cmple_epu32_mask(index, last_index16) };
+        const __m512i header{ _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), in_range, _mm512_mullo_epi32(index, stride16), base, 1) };
+        const __mmask16 alive{ _mm512_mask_test_epi32_mask(in_range, header, _mm512_set1_epi32(1)) };
+        const __mmask16 matches{ _mm512_mask_cmpeq_epi32_mask(alive, _mm512_and_si512(_mm512_maskz_srli_epi32(__mmask16(0xFFFF), header, 1), generation_mask16), generation) };
+        valid[i / 64u] |= uint64_t{ matches } << ( i % 64u );
+      }
+#endif
+      const __m256i index_mask{ _mm256_set1_epi32(static_cast<int>(_Key::index_mask)) };
+      const __m256i generation_mask{ _mm256_set1_epi32(static_cast<int>(_Key::generation_mask)) };
+      const __m256i last_index{ _mm256_set1_epi32(static_cast<int>(m_high_water - 1u)) };
+      const __m256i stride{ _mm256_set1_epi32(static_cast<int>(sizeof(slot_type))) };
+      const __m256i one{ _mm256_set1_epi32(1) };
+      for (; i + 8u <= count; i += 8u)
+      {
+        const __m256i ID{ _mm256_loadu_si256(reinterpret_cast<const __m256i *>(IDs + i)) };
+        const __m256i index{ _mm256_and_si256(ID, index_mask) };
+        const __m256i generation{ _mm256_and_si256(_mm256_srli_epi32(ID, _Key::index_bits), generation_mask) };
+        // unsigned index <= m_high_water - 1
+        const __m256i in_range{ _mm256_cmpeq_epi32(_mm256_min_epu32(index, last_index), index) };
+        const __m256i header{ _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int *>(base),
+                                                          _mm256_mullo_epi32(index, stride), in_range, 1) };
+        const __m256i alive{ _mm256_cmpeq_epi32(_mm256_and_si256(header, one), one) };
+        const __m256i same_generation{ _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srli_epi32(header, 1), generation_mask), generation) };
+        const __m256i matches{ _mm256_and_si256(in_range, _mm256_and_si256(alive, same_generation)) };
+        const unsigned bits{ static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(matches))) };
+        valid[i / 64u] |= uint64_t{ bits } << ( i % 64u );
+      }
+      return i;
+    }
+#endif
+    (void)IDs;
+    (void)count;
+    (void)valid;
+    return 0u;
+  }
+
+  /*
+  * @brief Prefetches the slot header referenced by an ID, and the object too when its address doesn't depend on the header.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::prefetch_slot(id_type ID) const noexcept
+  {
+    unsigned index{ static_cast<unsigned>( ID & _Key::index_mask ) };
+    if (index < m_high_water)
+    {
+      detail::prefetch(&header_at(index));
+      if constexpr (!is_dense)
+        detail::prefetch(as_value_type(index));
+    }
+  }
+
+  /*
+  * @brief Prefetches the object referenced by an ID for the dense layout, where its position is read from the slot header.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::prefetch_object(id_type ID) const noexcept
+  {
+    if constexpr (is_dense)
+    {
+      unsigned index{ static_cast<unsigned>( ID & _Key::index_mask ) };
+      if (index < m_high_water)
+      {
+        const element_header& header{ header_at(index) };
+        if (header.is_alive)
+          detail::prefetch(as_value_type(header.index));
+      }
+    }
+    else
+    {
+      (void)ID;
+    }
+  }
+
   /*
   * @brief Generates a unique identifier used to safely access the referenced object.
   * @param object The object who's ID is being acquired.
   * @return An ID that can be used to safely access the object.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  unsigned slot_array<T, _Elements, _Use_Heap>::get_ID(T& object) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::id_type slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::get_ID(T& object) const
   {
     unsigned index = get_index(object);
 
-    return m_data[index].make_ID(index);
+    return header_at(index).make_ID(index);
   }
 
   /*
   * @brief Releases an element from the slot_array and makes that slot available.
   * @param position The position of the element to erase.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator slot_array<T, _Elements, _Use_Heap>::erase(iterator position)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::erase(iterator position)
   {
     ADL_ASSERT_MSG(this == position.m_container, "Iterator/container mismatched.");
     free(*position);
-    return ++position;
+    if constexpr (is_dense)
+    {
+      // The last object was moved into the freed position, so it is the next one to visit.
+      return position_of(position.m_data) < m_size ? position : end();
+    }
+    else
+    {
+      return ++position;
+    }
   }
 
   /*
@@ -441,43 +1488,139 @@ namespace ADL
   * @param first The start of the range to erase.
   * @param last One past the end of the range to remove.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator slot_array<T, _Elements, _Use_Heap>::erase(iterator first, iterator last)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::erase(iterator first, iterator last)
   {
     ADL_ASSERT_MSG(this == first.m_container, "Iterator/container mismatched.");
     ADL_ASSERT_MSG(this == last.m_container, "Iterator/container mismatched.");
-    for (; first != last; ++first)
+    if constexpr (is_dense)
     {
-      free(*first);
+      // Free back to front so the objects moved into the holes always come from past the range.
+      const unsigned begin_position{ first == end() ? m_size : position_of(first.m_data) };
+      unsigned end_position{ last == end() ? m_size : position_of(last.m_data) };
+      while (end_position > begin_position)
+      {
+        free(*as_value_type(--end_position));
+      }
+      return begin_position < m_size ? iterator{ *this, as_value_type(begin_position) } : end();
+    }
+    else
+    {
+      for (; first != last; ++first)
+      {
+        free(*first);
+      }
+      return first;
     }
-    return first;
   }
 
   /*
   * @brief Safely destructs the referenced object and makes it's slot available for new objects.
   * @param object The object to be freed.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  void slot_array<T, _Elements, _Use_Heap>::free(T& object)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::free(T& object)
   {
     unsigned index{ get_index(object) };
-    element& elem{ m_data[ index ] };
+    release(index, m_size, m_free_head);
+    --m_size;
+    // The released element is now the front of the free list
+    m_free_head = index;
+  }
+
+  /*
+  * @brief Destructs the object in a slot and links the slot in front of a free list.
+  * @detail Does not update m_size or m_free_head so bulk operations can update them once.
+  * @param index The index of the live slot to release.
+  * @param live_count The number of live objects before this one is released.
+  * @param free_head The slot which becomes next in the free list after this one.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::release(unsigned index, unsigned live_count, unsigned free_head)
+  {
+    element_header& elem{ header_at( index ) };
     ADL_ASSERT_MSG(elem.is_alive, "Tried to free an object that wasn't alive.");
-    reinterpret_cast<T*>(&elem.object)->~T();
+    // An object freed while marked must not take the next object of its slot with it at flush_erases().
+    if (m_pending_count != 0u)
+    {
+      unmark_pending(index);
+    }
+    T& object{ *as_value_type(elem.index) };
+    object.~T();
+    if constexpr (is_dense)
+    {
+      // Keep the objects packed by moving the last object into the hole, the same way slot_map::erase() does.
+      // Trivially relocatable objects are moved with a memcpy, see relocate.hpp.
+      const unsigned last{ live_count - 1u };
+      if (elem.index != last)
+      {
+        relocate_at(&object, as_value_type(last));
+        m_erase_helper[elem.index] = m_erase_helper[last];
+        header_at(m_erase_helper[elem.index]).index = elem.index;
+      }
+      this->count_frees(1u, elem.index != last ? 1u : 0u);
+    }
+    else
+    {
+      set_dead(index);
+      this->count_frees(1u, 0u);
+    }
     ++elem.counter;
-    --m_size;
     elem.is_alive = false;
     // Add this element to the front of the free list
-    elem.index = m_free_head;
-    m_free_head = index;
+    elem.index = free_head;
+  }
+
+  /*
+  * @brief Releases the objects referenced by a batch of IDs.
+  * @detail The freed slots are spliced onto the free list, and the size is updated once for the whole batch.
+  * @param IDs Identifiers known to be good that reference objects in the slot_array. Each object may appear only once.
+  * @param count The number of IDs.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::free_n(const id_type *IDs, unsigned count)
+  {
+    unsigned live_count{ m_size };
+    unsigned free_head{ m_free_head };
+    for (unsigned i{ 0u }; i < count; ++i)
+    {
+      const unsigned index{ static_cast<unsigned>( IDs[i] & _Key::index_mask ) };
+      ADL_ASSERT_MSG(index < _Elements, "Invalid ID: Index out of range.");
+      release(index, live_count--, free_head);
+      free_head = index;
+    }
+    m_size = live_count;
+    m_free_head = free_head;
+  }
+
+  /*
+  * @brief Releases a batch of objects.
+  * @detail The freed slots are spliced onto the free list, and the size is updated once for the whole batch.
+  * @param objects Pointers to live objects in the slot_array. Each object may appear only once.\n
+  *        With the dense layout freeing moves objects, so only pass objects known to be at the back or use IDs instead.
+  * @param count The number of objects.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::free_n(T * const *objects, unsigned count)
+  {
+    unsigned live_count{ m_size };
+    unsigned free_head{ m_free_head };
+    for (unsigned i{ 0u }; i < count; ++i)
+    {
+      const unsigned index{ get_index(*objects[i]) };
+      release(index, live_count--, free_head);
+      free_head = index;
+    }
+    m_size = live_count;
+    m_free_head = free_head;
   }
 
   /*
   * @brief Safely destructs the referenced object and makes it's slot available for new objects.
   * @param object The object to be freed.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  void slot_array<T, _Elements, _Use_Heap>::free(iterator object)
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::free(iterator object)
   {
     free(*object.m_data);
   }
@@ -488,8 +1631,8 @@ namespace ADL
                   Will be nullptr if none remain. Pass in a nullptr to start with the first element.
   * @return Returns whether the pointer is valid or not. Convenient for use in a while loop.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  bool slot_array<T, _Elements, _Use_Heap>::next(T*& object) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  bool slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::next(T*& object) const
   {
     if (m_size == 0u)
     {
@@ -498,31 +1641,17 @@ namespace ADL
     }
 
     // General case: valid object pointer and we start from one past that object's index.
-    if (object)
-    {
-      unsigned index{ get_index(*object) };
-      for (unsigned i{ index + 1 }; i < m_capacity; ++i)
-      {
-        if (m_data[i].is_alive)
-        {
-          object = as_value_type(i);
-          return true;
-        }
-      }
-    }
-    else // Handle the case where a nullptr is passed in and we start from the first element
+    // Handle the case where a nullptr is passed in and we start from the first element.
+    // The index comes from the address so the element header is never read.
+    const unsigned first{ object ? position_of(object) + 1 : 0u };
+    // Packed objects are all live, so the dense layout only has to check the bounds.
+    const unsigned i{ is_dense ? ( first < m_size ? first : m_capacity ) : find_next_live(first) };
+    if (i < m_capacity)
     {
-      for (unsigned i{ 0 }; i < m_capacity; ++i)
-      {
-        if (m_data[i].is_alive)
-        {
-          object = as_value_type(i);
-          return true;
-        }
-      }
+      object = as_value_type(i);
+      return true;
     }
 
-
     object = nullptr;
     return false;
   }
@@ -534,8 +1663,8 @@ namespace ADL
   Will be nullptr if none remain. Pass in a nullptr to start with the first element.
   * @return Returns whether the pointer is valid or not. Convenient for use in a while loop.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  bool slot_array<T, _Elements, _Use_Heap>::previous(T*& object) const
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  bool slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::previous(T*& object) const
   {
     if (m_size == 0u)
     {
@@ -543,34 +1672,16 @@ namespace ADL
       return false;
     }
 
-    // General case: valid object pointer and we start from one past that object's index.
-    if (object)
-    {
-      unsigned index{ get_index(*object) };
-      //                     v subtracting 1 because the data starts at the 0 index
-      for (unsigned i{ index - 1 }; i != UINT32_MAX; --i) // UINT32_MAX is the result of decrementing 0.
-      {
-        if (m_data[i].is_alive)
-        {
-          object = as_value_type(i);
-          return true;
-        }
-      }
-    }
-    else // Handle the case where a nullptr is passed in and we start from the first element
+    // General case: valid object pointer and we start from one before that object's index.
+    // Handle the case where a nullptr is passed in and we start from the last element.
+    const unsigned last{ object ? position_of(object) : ( is_dense ? m_size : m_capacity ) };
+    const unsigned i{ is_dense ? ( last > 0u ? last - 1 : m_capacity ) : find_previous_live(last) };
+    if (i < m_capacity)
     {
-      //                         v subtracting 1 because the data starts at the 0 index
-      for (unsigned i{ _Elements - 1 }; i != UINT32_MAX; --i) // UINT32_MAX is the result of decrementing 0.
-      {
-        if (m_data[i].is_alive)
-        {
-          object = as_value_type(i);
-          return true;
-        }
-      }
+      object = as_value_type(i);
+      return true;
     }
 
-
     object = nullptr;
     return false;
   }
@@ -579,19 +1690,17 @@ namespace ADL
   * @brief Access the first element of the slot_array. Can be used in conjunction with next() to iterate over all elements.
   * @return An iterator with the first live element of the slot_array.
   */
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  typename slot_array<T, _Elements, _Use_Heap>::iterator slot_array<T, _Elements, _Use_Heap>::begin() const noexcept
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::begin() const noexcept
   {
     if (m_size == 0u)
     {
       return end();
     }
-    for (unsigned i{ 0u }; i < _Elements; ++i)
+    const unsigned i{ is_dense ? 0u : find_next_live(0u) };
+    if (i < m_capacity)
     {
-      if (m_data[i].is_alive)
-      {
-        return iterator( *this, as_value_type(i) );
-      }
+      return iterator( *this, as_value_type(i) );
     }
 
     // This can only occur when an element seems to exist, but could not be found within the bounds of the container.
@@ -599,23 +1708,329 @@ namespace ADL
     return iterator{ *this, nullptr };
   }
    
-  template<typename T, unsigned _Elements, bool _Use_Heap>
-  const typename slot_array<T, _Elements, _Use_Heap>::iterator slot_array<T, _Elements, _Use_Heap>::end() const noexcept
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  const typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::iterator slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::end() const noexcept
   {
     return iterator{ *this, nullptr };
   }
 
-  template<typename T, unsigned _Elements, bool _Use_Heap>
+  /*
+  * @brief Frees every object a predicate is true for.
+  * @detail Objects are visited by position, so their slots are known without get_index(), and the size and free list
+  *         are updated once for the whole pass, as in free_n().
+  * @param p Called once per live object, returns whether to free it. It must not modify the slot_array.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
   template<typename Predicate>
-  void slot_array<T, _Elements, _Use_Heap>::remove_if(Predicate p)
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::remove_if(Predicate p)
   {
-    for (auto & it : *this)
+    unsigned live_count{ m_size };
+    unsigned free_head{ m_free_head };
+    if constexpr (is_dense)
     {
-      if (p(it))
+      // Freeing moves the last object into the current position, which must be tested before moving on.
+      for (unsigned position{ 0u }; position < live_count; )
       {
-        free(it);
+        if (p(*as_value_type(position)))
+        {
+          const unsigned index{ m_erase_helper[position] };
+          release(index, live_count--, free_head);
+          free_head = index;
+        }
+        else
+        {
+          ++position;
+        }
       }
     }
+    else
+    {
+      for (unsigned word{ 0u }; word < occupancy_words; ++word)
+      {
+        for (uint64_t bits{ m_occupancy[word] }; bits != 0u; bits &= bits - 1u)
+        {
+          const unsigned index{ word * occupancy_word_bits + detail::lowest_set_bit(bits) };
+          if (p(*as_value_type(index)))
+          {
+            release(index, live_count--, free_head);
+            free_head = index;
+          }
+        }
+      }
+    }
+    m_size = live_count;
+    m_free_head = free_head;
+  }
+
+  /*
+  * @brief Marks an object to be freed by the next flush_erases().
+  * @param ID An identifier known to be good that references an object in the slot_array.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::defer_erase(id_type ID)
+  {
+    const unsigned index{ static_cast<unsigned>( ID & _Key::index_mask ) };
+    ADL_ASSERT_MSG(index < _Elements, "Invalid ID: Index out of range.");
+    ADL_ASSERT_MSG(header_at(index).is_alive, "Tried to defer freeing an object that wasn't alive.");
+    mark_pending(index);
+  }
+
+  /*
+  * @brief Marks an object to be freed by the next flush_erases().
+  * @param object A live object in the slot_array.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::defer_erase(T& object)
+  {
+    mark_pending(get_index(object));
+  }
+
+  /*
+  * @brief Marks an object to be freed by the next flush_erases().
+  * @param object An iterator to a live object in the slot_array.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::defer_erase(iterator object)
+  {
+    defer_erase(*object.m_data);
+  }
+
+  /*
+  * @brief Frees every object marked by defer_erase() since the last flush.
+  * @detail The freed slots are spliced onto the free list, and the size is updated once for the whole batch.\n
+  *         The dense layout scans the packed objects back to front, so each object moved into a hole comes from a
+  *         position already scanned and is never a marked one. The other layouts scan the marks by slot.
+  * @return The number of objects freed.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  unsigned slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::flush_erases()
+  {
+    const unsigned pending{ m_pending_count };
+    if (pending == 0u)
+    {
+      return 0u;
+    }
+    // Cleared first so release() skips unmarking, the marks are cleared here as they are consumed.
+    m_pending_count = 0u;
+    unsigned remaining{ pending };
+    unsigned live_count{ m_size };
+    unsigned free_head{ m_free_head };
+    if constexpr (is_dense)
+    {
+      for (unsigned position{ live_count }; remaining != 0u && position-- > 0u; )
+      {
+        const unsigned index{ m_erase_helper[position] };
+        uint64_t& word{ m_pending[index / occupancy_word_bits] };
+        const uint64_t bit{ uint64_t{ 1 } << ( index % occupancy_word_bits ) };
+        if (word & bit)
+        {
+          word &= ~bit;
+          release(index, live_count--, free_head);
+          free_head = index;
+          --remaining;
+        }
+      }
+    }
+    else
+    {
+      for (unsigned word{ pending_words }; remaining != 0u && word-- > 0u; )
+      {
+        uint64_t bits{ m_pending[word] };
+        m_pending[word] = 0u;
+        while (bits != 0u)
+        {
+          const unsigned bit{ detail::highest_set_bit(bits) };
+          bits &= ~( uint64_t{ 1 } << bit );
+          const unsigned index{ word * occupancy_word_bits + bit };
+          release(index, live_count--, free_head);
+          free_head = index;
+          --remaining;
+        }
+      }
+    }
+    m_size = live_count;
+    m_free_head = free_head;
+    return pending;
+  }
+
+  /*
+  * @brief Byte offsets of the arrays of a snapshot image: the header, the slots, the occupancy bitmap
+  *        (a single word for the dense layout), then the objects for the split and dense layouts and the dense->slot table for the dense layout.
+  * @detail Every array is stored at its full capacity so an adopted image can be used as storage as is.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  constexpr typename slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::snapshot_layout
+  slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::snapshot_offsets() noexcept
+  {
+    auto align = [](size_t offset) { return ( offset + snapshot_alignment - 1u ) / snapshot_alignment * snapshot_alignment; };
+    snapshot_layout layout{};
+    layout.data = align(sizeof(detail::slot_array_snapshot_header));
+    layout.occupancy = align(layout.data + size_t{ _Elements } * sizeof(slot_type));
+    layout.objects = align(layout.occupancy + occupancy_words * sizeof(uint64_t));
+    layout.erase_helper = align(layout.objects + ( is_in_place ? 0u : size_t{ _Elements } * sizeof(object_storage) ));
+    layout.total = align(layout.erase_helper + ( is_dense ? size_t{ _Elements } * sizeof(index_type) : 0u ));
+    return layout;
+  }
+
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  constexpr size_t slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::snapshot_size() noexcept
+  {
+    return snapshot_offsets().total;
+  }
+
+  /*
+  * @brief Writes an image of the slot_array that load_snapshot() or adopt_snapshot() can restore, keys included.
+  * @detail Each array is copied with a single memcpy up to the high-water mark, or the size for packed dense objects.\n
+  *         The rest of the image is zeroed, so never-used slots are written without being read.\n
+  *         Writing the image to a file gives a persistent copy that can be memory-mapped and adopted later.
+  * @param image A buffer of snapshot_size() bytes aligned to snapshot_alignment.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::write_snapshot(void *image) const
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only slot_arrays of trivially copyable objects can be snapshot.");
+    ADL_ASSERT_MSG(reinterpret_cast<uintptr_t>(image) % snapshot_alignment == 0u, "Snapshot images must be aligned to snapshot_alignment.");
+    constexpr snapshot_layout layout{ snapshot_offsets() };
+    char *bytes{ static_cast<char *>(image) };
+    std::memset(bytes, 0, layout.total);
+
+    detail::slot_array_snapshot_header header{};
+    header.magic = detail::slot_array_snapshot_header::magic_value;
+    header.version = detail::slot_array_snapshot_header::current_version;
+    header.value_size = sizeof(T);
+    header.value_alignment = alignof(T);
+    header.slot_size = sizeof(slot_type);
+    header.elements = _Elements;
+    header.layout = is_in_place ? 0u : ( is_dense ? 2u : 1u );
+    header.id_bits = _Key::id_bits;
+    header.index_bits = _Key::index_bits;
+    header.size = m_size;
+    header.max_used = m_max_used;
+    header.free_head = m_free_head;
+    header.high_water = m_high_water;
+    header.total_size = layout.total;
+    std::memcpy(bytes, &header, sizeof(header));
+
+    std::memcpy(bytes + layout.data, &m_data[0], size_t{ m_high_water } * sizeof(slot_type));
+    std::memcpy(bytes + layout.occupancy, &m_occupancy[0], occupancy_words * sizeof(uint64_t));
+    if constexpr (!is_in_place)
+    {
+      const size_t objects{ is_dense ? m_size : m_high_water };
+      std::memcpy(bytes + layout.objects, &m_objects[0], objects * sizeof(object_storage));
+    }
+    if constexpr (is_dense)
+    {
+      std::memcpy(bytes + layout.erase_helper, &m_erase_helper[0], size_t{ m_size } * sizeof(index_type));
+    }
+  }
+
+  /*
+  * @brief Checks that an image was written by a slot_array of this type, and reads its header.
+  * @return false if the image is too small, from another version, or from a slot_array with different parameters.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  bool slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::snapshot_matches(const void *image, size_t size,
+                                                                             detail::slot_array_snapshot_header &header) const noexcept
+  {
+    if (image == nullptr || size < sizeof(header))
+    {
+      return false;
+    }
+    std::memcpy(&header, image, sizeof(header));
+    return header.magic == detail::slot_array_snapshot_header::magic_value
+        && header.version == detail::slot_array_snapshot_header::current_version
+        && header.value_size == sizeof(T) && header.value_alignment == alignof(T) && header.slot_size == sizeof(slot_type)
+        && header.elements == _Elements && header.layout == ( is_in_place ? 0u : ( is_dense ? 2u : 1u ) )
+        && header.id_bits == _Key::id_bits && header.index_bits == _Key::index_bits
+        && header.total_size == snapshot_size() && size >= snapshot_size()
+        && header.size <= header.high_water && header.max_used <= header.high_water && header.high_water <= _Elements
+        && header.free_head <= _Elements;
+  }
+
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  void slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::restore_counters(const detail::slot_array_snapshot_header &header) noexcept
+  {
+    m_size = header.size;
+    m_max_used = header.max_used;
+    m_free_head = header.free_head;
+    m_high_water = header.high_water;
+  }
+
+  /*
+  * @brief Replaces the contents of the slot_array with a copy of a snapshot image. IDs from the image stay valid.
+  * @detail Each array is copied with a single memcpy up to the high-water mark of the image, no per-object work is done.\n
+  *         IDs of objects held before the call are invalidated.
+  * @param image An image written by write_snapshot(), such as a memory-mapped snapshot file.
+  * @param size The size of the image in bytes.
+  * @return false, leaving the slot_array untouched, if the image wasn't written by a slot_array of this type.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  bool slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::load_snapshot(const void *image, size_t size)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only slot_arrays of trivially copyable objects can be snapshot.");
+    detail::slot_array_snapshot_header header;
+    if (!snapshot_matches(image, size, header))
+    {
+      return false;
+    }
+    constexpr snapshot_layout layout{ snapshot_offsets() };
+    const char *bytes{ static_cast<const char *>(image) };
+    // Slots past the loaded high-water mark get fresh headers when first taken, so stale contents are harmless.
+    std::memcpy(&m_data[0], bytes + layout.data, size_t{ header.high_water } * sizeof(slot_type));
+    std::memcpy(&m_occupancy[0], bytes + layout.occupancy, occupancy_words * sizeof(uint64_t));
+    if constexpr (!is_in_place)
+    {
+      const size_t objects{ is_dense ? header.size : header.high_water };
+      std::memcpy(&m_objects[0], bytes + layout.objects, objects * sizeof(object_storage));
+    }
+    if constexpr (is_dense)
+    {
+      std::memcpy(&m_erase_helper[0], bytes + layout.erase_helper, size_t{ header.size } * sizeof(index_type));
+    }
+    restore_counters(header);
+    discard_pending();
+    return true;
+  }
+
+  /*
+  * @brief Uses a snapshot image as the storage of the slot_array, without copying it. IDs from the image stay valid.
+  * @detail Loading costs only the header check: pages of a memory-mapped image are faulted in as they are touched.\n
+  *         The slot_array modifies the image in place, map it copy-on-write (MAP_PRIVATE) to keep the file unchanged.\n
+  *         The previous storage is returned to its memory resource, and get_memory_resource() no longer returns it.
+  * @param image An image written by write_snapshot(), aligned to snapshot_alignment.\n
+  *        It must stay valid until the slot_array is destroyed or loads or adopts another image.
+  * @param size The size of the image in bytes.
+  * @return false, leaving the slot_array untouched, if the image is misaligned or wasn't written by a slot_array of this type.
+  */
+  template<typename T, unsigned _Elements, bool _Use_Heap, typename _Layout, typename _Key, typename _Stats>
+  bool slot_array<T, _Elements, _Use_Heap, _Layout, _Key, _Stats>::adopt_snapshot(void *image, size_t size)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only slot_arrays of trivially copyable objects can be snapshot.");
+    static_assert(_Use_Heap, "Only slot_arrays with heap storage can adopt a snapshot image, use load_snapshot() instead.");
+    detail::slot_array_snapshot_header header;
+    if (reinterpret_cast<uintptr_t>(image) % snapshot_alignment != 0u || !snapshot_matches(image, size, header))
+    {
+      return false;
+    }
+    constexpr snapshot_layout layout{ snapshot_offsets() };
+    char *bytes{ static_cast<char *>(image) };
+    std::pmr::memory_resource *resource{ detail::adopted_resource() };
+    m_data = storage<slot_type>(reinterpret_cast<slot_type *>(bytes + layout.data), detail::resource_deleter<slot_type>{ resource, _Elements });
+    m_occupancy = storage<uint64_t, occupancy_words>(reinterpret_cast<uint64_t *>(bytes + layout.occupancy),
+                                                     detail::resource_deleter<uint64_t>{ resource, occupancy_words });
+    if constexpr (!is_in_place)
+    {
+      m_objects = storage<object_storage>(reinterpret_cast<object_storage *>(bytes + layout.objects),
+                                          detail::resource_deleter<object_storage>{ resource, _Elements });
+    }
+    if constexpr (is_dense)
+    {
+      m_erase_helper = storage<index_type>(reinterpret_cast<index_type *>(bytes + layout.erase_helper),
+                                           detail::resource_deleter<index_type>{ resource, _Elements });
+    }
+    restore_counters(header);
+    discard_pending();
+    return true;
   }
 
 }
@@ -1,35 +1,412 @@
-
+#pragma once
 #include <vector>
+#include <memory_resource> // pmr::vector
 #include <tuple>
+#include <stdexcept> // range_error
+#include <cassert>
 #include <limits> // find max value of key_size_type
 #include <type_traits> // declval, remove_reference
+#include <algorithm> // move, copy, min, sort
+#include <numeric> // iota
+#include <iterator> // iterator_traits, distance
+#include <memory> // addressof
+#include <cstdint> // uint64_t
+#include <cstddef> // size_t
+#include <cstring> // memcpy, memset
+#include <atomic> // atomic counters of slot_map_stats::counters
+#include <array>
+#if defined(_MSC_VER)
+#include <xmmintrin.h> // _mm_prefetch
+#endif
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h> // gathers for validate()
+#endif
+#include "soa_vector.hpp"
+#include "paged_vector.hpp"
+#include "static_vector.hpp"
+#include "relocate.hpp"
+
+// Selects the container slot_map stores its values in, how a value is moved into the hole left by erase(), and how
+// two values trade places when the map is reordered. Both are bytewise for trivially relocatable values, see relocate.hpp.
+// slot_map<soa<Ts...>> is stored as a soa_vector with one dense Container<T> column per component.
+template<typename T, template<typename...>typename Container>
+struct slot_map_storage {
+  using type = Container<T>;
+  static constexpr void relocate( type &data, typename type::size_type to, typename type::size_type from ) {
+    fill_hole( *( std::begin( data ) + to ), *( std::begin( data ) + from ) );
+  }
+  static constexpr void swap( type &data, typename type::size_type a, typename type::size_type b ) {
+    swap_values( *( std::begin( data ) + a ), *( std::begin( data ) + b ) );
+  }
+};
+
+template<typename... Ts, template<typename...>typename Container>
+struct slot_map_storage<soa<Ts...>, Container> {
+  using type = soa_vector<Container, Ts...>;
+  static constexpr void relocate( type &data, typename type::size_type to, typename type::size_type from ) {
+    data.move_element( to, from );
+  }
+  static constexpr void swap( type &data, typename type::size_type a, typename type::size_type b ) {
+    data.swap_elements( a, b );
+  }
+};
+
+// How many elements slot_map adds to a container each time it grows it, 0 for geometric growth.
+// A paged_vector grows without moving its elements, so it grows one page at a time and no single insertion has to
+// create more than a page worth of slots.
+template<typename C>
+struct slot_map_growth_step : std::integral_constant<std::size_t, 0> { };
+
+template<typename T, std::size_t PageSize, typename Allocator>
+struct slot_map_growth_step<paged_vector<T, PageSize, Allocator>> : std::integral_constant<std::size_t, PageSize> { };
+
+template<template<typename...>typename Container, typename... Ts>
+struct slot_map_growth_step<soa_vector<Container, Ts...>> : std::integral_constant<std::size_t, std::max( { slot_map_growth_step<Container<Ts>>::value... } )> { };
+
+// Whether a container stores its elements contiguously, which validate() needs to gather from the slot table.
+template<typename C>
+struct slot_map_contiguous : std::false_type { };
+
+template<typename T, typename Allocator>
+struct slot_map_contiguous<std::vector<T, Allocator>> : std::true_type { };
+
+template<typename T, std::size_t N>
+struct slot_map_contiguous<static_vector<T, N>> : std::true_type { };
+
+// Whether a container has a capacity fixed at construction, such as static_vector. slot_map creates every slot of a
+// fixed capacity map on construction, so insertions never grow it and only check that it isn't full.
+template<typename C>
+struct slot_map_fixed_capacity : std::false_type { };
+
+template<typename T, std::size_t N>
+struct slot_map_fixed_capacity<static_vector<T, N>> : std::true_type { };
+
+template<template<typename...>typename Container, typename... Ts>
+struct slot_map_fixed_capacity<soa_vector<Container, Ts...>> : std::conjunction<slot_map_fixed_capacity<Container<Ts>>...> { };
+
+// The first bytes of a slot_map snapshot image, see slot_map::write_snapshot( ).
+// Snapshots are native: integers are in the byte order of the writer, and an image can only be loaded by a slot_map
+// with the same element, key and slot table types built for the same ABI.
+struct slot_map_snapshot_header {
+  static constexpr std::uint32_t magic_value{ 0x4D4C4441u }; // "ADLM" read as little endian
+  static constexpr std::uint32_t current_version{ 1u };
+
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t value_size;
+  std::uint32_t value_alignment;
+  std::uint32_t key_size;
+  std::uint32_t slot_record_size;
+  std::uint32_t reverse_record_size;
+  std::uint32_t reserved;
+  std::uint64_t element_count;
+  std::uint64_t slot_count;
+  std::uint64_t reverse_count;
+  std::uint64_t free_head;
+  std::uint64_t free_tail;
+  std::uint64_t generation_floor;
+  // byte offsets of the elements, slot records and erase helper records from the start of the image
+  std::uint64_t data_offset;
+  std::uint64_t slots_offset;
+  std::uint64_t reverse_offset;
+  std::uint64_t total_size;
+};
+
+// How many bytes a container moves per element when it reallocates, 0 for containers which never move their elements.
+template<typename C>
+struct slot_map_relocated_bytes : std::integral_constant<std::size_t, sizeof( typename C::value_type )> { };
+
+template<typename T, std::size_t PageSize, typename Allocator>
+struct slot_map_relocated_bytes<paged_vector<T, PageSize, Allocator>> : std::integral_constant<std::size_t, 0> { };
+
+template<typename T, std::size_t N>
+struct slot_map_relocated_bytes<static_vector<T, N>> : std::integral_constant<std::size_t, 0> { };
+
+template<template<typename...>typename Container, typename... Ts>
+struct slot_map_relocated_bytes<soa_vector<Container, Ts...>> : std::integral_constant<std::size_t, ( slot_map_relocated_bytes<Container<Ts>>::value + ... )> { };
+
+// Growth policies for slot_map, which decide the next capacity of each of its containers when it runs out of room.
+// A policy provides next_capacity<C>( current ) for a container of type C, and max_capacity.
+namespace slot_map_growth {
+  // Multiplies the capacity by Factor, the first allocation holds Initial elements.
+  template<std::size_t Factor = 2, std::size_t Initial = 20>
+  struct geometric {
+    static_assert( Factor >= 2 && Initial > 0, "A geometric growth policy must at least double the capacity, starting from at least 1." );
+    static constexpr std::size_t max_capacity{ std::numeric_limits<std::size_t>::max( ) };
+    template<typename C>
+    static constexpr std::size_t next_capacity( std::size_t current ) { return current ? current * Factor : Initial; }
+  };
+
+  // Adds Increment elements at a time. Memory stays within Increment elements of the size, but insertion is only
+  // amortized O(1) for containers which grow without moving their elements, such as paged_vector.
+  template<std::size_t Increment = 1024>
+  struct linear {
+    static_assert( Increment > 0, "A linear growth policy must add at least 1 element at a time." );
+    static constexpr std::size_t max_capacity{ std::numeric_limits<std::size_t>::max( ) };
+    template<typename C>
+    static constexpr std::size_t next_capacity( std::size_t current ) { return current + Increment; }
+  };
+
+  // The default: geometric<> for contiguous containers, and one step at a time for containers which have a growth
+  // step, see slot_map_growth_step.
+  struct automatic {
+    static constexpr std::size_t max_capacity{ std::numeric_limits<std::size_t>::max( ) };
+    template<typename C>
+    static constexpr std::size_t next_capacity( std::size_t current ) {
+      if constexpr( slot_map_growth_step<C>::value != 0 ) return current + slot_map_growth_step<C>::value;
+      else return geometric<>::next_capacity<C>( current );
+    }
+  };
+
+  // Grows like Inner up to Capacity elements, past which insertions throw std::length_error.
+  // reserve( Capacity ) up front gives a map which never allocates after construction.
+  template<std::size_t Capacity, typename Inner = automatic>
+  struct capped {
+    static_assert( Capacity > 0, "A capped growth policy must allow at least 1 element." );
+    static constexpr std::size_t max_capacity{ Capacity };
+    template<typename C>
+    static constexpr std::size_t next_capacity( std::size_t current ) {
+      const std::size_t next{ Inner::template next_capacity<C>( current ) };
+      return next < Capacity ? next : Capacity;
+    }
+  };
+}
+
+// Layout policies for the slot table and erase helper of a slot_map.
+// The slot table maps key indices to element indices, the erase helper maps element indices back to key indices.
+namespace slot_map_layout {
+  // The slot table and erase helper are two containers. The erase helper only holds entries for live elements.
+  struct separate {
+    template<typename Key, typename Index, template<typename...>typename Container>
+    class table {
+    public:
+      using size_type = typename Container<Key>::size_type;
+      constexpr table( ) = default;
+      template<typename Allocator>
+      constexpr explicit table( const Allocator &allocator ) : m_slots( allocator ), m_erase_helper( allocator ) { }
+      // distance in bytes between consecutive slots, when Container is contiguous
+      static constexpr std::size_t slot_stride{ sizeof( Key ) };
+      using slot_container = Container<Key>;
+      constexpr Key& slot( size_type i ) { return *( std::begin( m_slots ) + i ); }
+      constexpr const Key& slot( size_type i ) const { return *( std::cbegin( m_slots ) + i ); }
+      constexpr Index& reverse( size_type i ) { return *( std::begin( m_erase_helper ) + i ); }
+      constexpr const Index& reverse( size_type i ) const { return *( std::cbegin( m_erase_helper ) + i ); }
+      constexpr size_type slot_count( ) const { return static_cast<size_type>( m_slots.size( ) ); }
+      constexpr size_type slot_capacity( ) const { return static_cast<size_type>( m_slots.capacity( ) ); }
+      constexpr void reserve_slots( size_type n ) { m_slots.reserve( n ); }
+      constexpr void append_slot( const Key &key ) { m_slots.push_back( key ); }
+      constexpr void reserve_reverse( size_type n ) { m_erase_helper.reserve( n ); }
+      constexpr void push_reverse( size_type, Index slot_index ) { m_erase_helper.push_back( slot_index ); }
+      constexpr void truncate_reverse( size_type element_count ) { m_erase_helper.erase( std::begin( m_erase_helper ) + element_count, std::end( m_erase_helper ) ); }
+      constexpr void truncate_slots( size_type slot_count ) { m_slots.erase( std::begin( m_slots ) + slot_count, std::end( m_slots ) ); }
+      constexpr void clear( ) { m_slots.clear( ); m_erase_helper.clear( ); }
+      constexpr void shrink_slots( ) { m_slots.shrink_to_fit( ); }
+      constexpr void shrink_reverse( ) { m_erase_helper.shrink_to_fit( ); }
+      // Snapshots, for contiguous containers: the slot records and the erase helper records as arrays.
+      using slot_record = Key;
+      const slot_record* slot_records( ) const { return m_slots.data( ); }
+      const Index* reverse_records( ) const { return m_erase_helper.data( ); }
+      static constexpr std::size_t reverse_record_count( std::size_t element_count ) { return element_count; }
+      void assign_records( const slot_record *slots, std::size_t slot_count, const Index *reverse, std::size_t reverse_count ) {
+        m_slots.assign( slots, slots + slot_count );
+        m_erase_helper.assign( reverse, reverse + reverse_count );
+      }
+    private:
+      Container<Key> m_slots;
+      Container<Index> m_erase_helper;
+    };
+  };
+
+  // Slot i and erase helper entry i share one record in a single container.
+  // While key indices and element indices line up (bulk inserted maps, maps with little churn) the slot and
+  // erase helper entries touched by insert() and erase() for an element are in the same cache line.
+  struct interleaved {
+    template<typename Key, typename Index, template<typename...>typename Container>
+    class table {
+      struct record {
+        Key key;
+        Index reverse;
+      };
+    public:
+      using size_type = typename Container<record>::size_type;
+      constexpr table( ) = default;
+      template<typename Allocator>
+      constexpr explicit table( const Allocator &allocator ) : m_records( allocator ) { }
+      // distance in bytes between consecutive slots, when Container is contiguous
+      static constexpr std::size_t slot_stride{ sizeof( record ) };
+      using slot_container = Container<record>;
+      constexpr Key& slot( size_type i ) { return ( *( std::begin( m_records ) + i ) ).key; }
+      constexpr const Key& slot( size_type i ) const { return ( *( std::cbegin( m_records ) + i ) ).key; }
+      constexpr Index& reverse( size_type i ) { return ( *( std::begin( m_records ) + i ) ).reverse; }
+      constexpr const Index& reverse( size_type i ) const { return ( *( std::cbegin( m_records ) + i ) ).reverse; }
+      constexpr size_type slot_count( ) const { return static_cast<size_type>( m_records.size( ) ); }
+      constexpr size_type slot_capacity( ) const { return static_cast<size_type>( m_records.capacity( ) ); }
+      constexpr void reserve_slots( size_type n ) { m_records.reserve( n ); }
+      constexpr void append_slot( const Key &key ) { m_records.push_back( record{ key, Index{ } } ); }
+      // There is always a slot per element, so the records already have room for every erase helper entry.
+      constexpr void reserve_reverse( size_type ) { }
+      constexpr void push_reverse( size_type element_index, Index slot_index ) { this->reverse( element_index ) = slot_index; }
+      constexpr void truncate_reverse( size_type ) { }
+      constexpr void truncate_slots( size_type slot_count ) { m_records.erase( std::begin( m_records ) + slot_count, std::end( m_records ) ); }
+      constexpr void clear( ) { m_records.clear( ); }
+      constexpr void shrink_slots( ) { m_records.shrink_to_fit( ); }
+      constexpr void shrink_reverse( ) { }
+      // Snapshots, for contiguous containers: the erase helper is part of the slot records.
+      using slot_record = record;
+      const slot_record* slot_records( ) const { return m_records.data( ); }
+      const Index* reverse_records( ) const { return nullptr; }
+      static constexpr std::size_t reverse_record_count( std::size_t ) { return 0; }
+      void assign_records( const slot_record *slots, std::size_t slot_count, const Index *, std::size_t ) {
+        m_records.assign( slots, slots + slot_count );
+      }
+    private:
+      Container<record> m_records;
+    };
+  };
+}
+
+// A snapshot of the instrumentation of a slot_map, see slot_map::statistics( ).
+// The event counters are only counted by slot_map_stats::counters and stay 0 otherwise, the gauges are always filled in.
+struct slot_map_statistics {
+  // events
+  std::uint64_t grows;                 // reallocations of the element storage by insertions
+  std::uint64_t grow_bytes_moved;      // bytes of elements moved by those reallocations
+  std::uint64_t slot_grows;            // times insertions extended the slot table
+  std::uint64_t slot_grow_bytes_moved; // bytes of slots moved by those extensions
+  std::uint64_t lookups;               // keys checked by at( ), operator[], find( ), find_many( ), validate( ) and erase( key )
+  std::uint64_t stale_lookups;         // keys among those which were stale or out of range
+  std::uint64_t erases;                // elements erased
+  std::uint64_t erase_moves;           // elements moved into the hole left by an erased element
+  // gauges
+  std::size_t size;
+  std::size_t capacity;
+  std::size_t slot_count;
+  std::size_t free_slots;              // length of the free list, every slot without an element is on it
+  double slot_occupancy;               // size / slot_count, low values mean the slot table is fragmented
+  // occupancy_histogram[ i ] counts the blocks of 64 consecutive slots holding from 8i - 7 to 8i elements,
+  // occupancy_histogram[ 0 ] the blocks holding none. The last block can be shorter than 64 slots.
+  std::array<std::size_t, 9> occupancy_histogram;
+};
+
+// Instrumentation policies for slot_map. A policy receives the events below and copies its counters into
+// a slot_map_statistics with fill_statistics( ).
+namespace slot_map_stats {
+  // The default: nothing is counted, the hooks compile away and the policy takes no space in the map.
+  struct none {
+    static constexpr bool enabled{ false };
+    constexpr void count_grow( std::size_t ) const { }
+    constexpr void count_slot_grow( std::size_t ) const { }
+    constexpr void count_lookups( std::size_t, std::size_t ) const { }
+    constexpr void count_erases( std::size_t, std::size_t ) const { }
+    constexpr void fill_statistics( slot_map_statistics & ) const { }
+    constexpr void reset_counters( ) { }
+  };
+
+  // Relaxed atomic counters. Counts are exact while one thread uses the map. Const lookups from several threads can
+  // count concurrently without a data race, but then some increments can be lost, and there is no ordering between
+  // counters. Copies of a map copy its counters.
+  struct counters {
+    static constexpr bool enabled{ true };
+    constexpr counters( ) = default;
+    counters( const counters &rhs ) { this->copy( rhs ); }
+    counters& operator=( const counters &rhs ) { this->copy( rhs ); return *this; }
+    void count_grow( std::size_t bytes ) const { add( m_grows, 1 ); add( m_grow_bytes_moved, bytes ); }
+    void count_slot_grow( std::size_t bytes ) const { add( m_slot_grows, 1 ); add( m_slot_grow_bytes_moved, bytes ); }
+    void count_lookups( std::size_t keys, std::size_t stale ) const { add( m_lookups, keys ); add( m_stale_lookups, stale ); }
+    void count_erases( std::size_t erased, std::size_t moved ) const { add( m_erases, erased ); add( m_erase_moves, moved ); }
+    void fill_statistics( slot_map_statistics &statistics ) const {
+      statistics.grows = m_grows.load( std::memory_order_relaxed );
+      statistics.grow_bytes_moved = m_grow_bytes_moved.load( std::memory_order_relaxed );
+      statistics.slot_grows = m_slot_grows.load( std::memory_order_relaxed );
+      statistics.slot_grow_bytes_moved = m_slot_grow_bytes_moved.load( std::memory_order_relaxed );
+      statistics.lookups = m_lookups.load( std::memory_order_relaxed );
+      statistics.stale_lookups = m_stale_lookups.load( std::memory_order_relaxed );
+      statistics.erases = m_erases.load( std::memory_order_relaxed );
+      statistics.erase_moves = m_erase_moves.load( std::memory_order_relaxed );
+    }
+    void reset_counters( ) { counters zero; this->copy( zero ); }
+  private:
+    using counter = std::atomic<std::uint64_t>;
+    // A relaxed load and store rather than a locked read-modify-write, so counting costs a plain add.
+    static void add( counter &c, std::size_t n ) { c.store( c.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed ); }
+    void copy( const counters &rhs ) {
+      const auto copy_counter = []( counter &to, const counter &from ) { to.store( from.load( std::memory_order_relaxed ), std::memory_order_relaxed ); };
+      copy_counter( m_grows, rhs.m_grows );
+      copy_counter( m_grow_bytes_moved, rhs.m_grow_bytes_moved );
+      copy_counter( m_slot_grows, rhs.m_slot_grows );
+      copy_counter( m_slot_grow_bytes_moved, rhs.m_slot_grow_bytes_moved );
+      copy_counter( m_lookups, rhs.m_lookups );
+      copy_counter( m_stale_lookups, rhs.m_stale_lookups );
+      copy_counter( m_erases, rhs.m_erases );
+      copy_counter( m_erase_moves, rhs.m_erase_moves );
+    }
+    mutable counter m_grows{ 0 };
+    mutable counter m_grow_bytes_moved{ 0 };
+    mutable counter m_slot_grows{ 0 };
+    mutable counter m_slot_grow_bytes_moved{ 0 };
+    mutable counter m_lookups{ 0 };
+    mutable counter m_stale_lookups{ 0 };
+    mutable counter m_erases{ 0 };
+    mutable counter m_erase_moves{ 0 };
+  };
+}
 
+// Deferred erase policies for slot_map: whether the map has the queue of defer_erase( ). The policy is a private base
+// of the map, so a map without the queue pays nothing for it.
+namespace slot_map_deferred_erase {
+  // The default: defer_erase( ) and flush_erases( ) are unavailable.
+  struct none {
+    static constexpr bool enabled{ false };
+    template<typename Queue>
+    struct storage {
+      constexpr storage( ) = default;
+      template<typename Allocator>
+      constexpr explicit storage( const Allocator & ) { }
+    };
+  };
+
+  // Queues keys in a Container<key_type> of the map. Growable containers allocate on the first defer_erase( ), while
+  // fixed capacity containers hold the queue inline, which makes a static_slot_map capacity( ) keys larger.
+  struct queue {
+    static constexpr bool enabled{ true };
+    template<typename Queue>
+    struct storage {
+      constexpr storage( ) = default;
+      template<typename Allocator>
+      constexpr explicit storage( const Allocator &allocator ) : m_deferred_erases( allocator ) { }
+      Queue m_deferred_erases{ }; // keys queued by defer_erase( ) until flush_erases( )
+    };
+  };
+}
 
-template<typename T, typename Token = std::pair<unsigned, unsigned>, template<typename...>typename Container = std::vector>
-class slot_map {
+template<typename T, typename Token = std::pair<unsigned, unsigned>, template<typename...>typename Container = std::vector,
+         typename Layout = slot_map_layout::separate, typename Growth = slot_map_growth::automatic,
+         typename Stats = slot_map_stats::none, typename Deferred = slot_map_deferred_erase::none>
+class slot_map : private Stats, private Deferred::template storage<Container<Token>> {
 public:
   using key_size_type = std::remove_reference_t<decltype( std::get<0>( std::declval<Token>( ) ) )>;
   using key_generation_type = std::remove_reference_t<decltype( std::get<1>( std::declval<Token>( ) ) )>;
-  using mapped_type = typename Container<T>::value_type;
+  using container_type = typename slot_map_storage<T, Container>::type;
+  using mapped_type = typename container_type::value_type;
   using value_type = mapped_type;
   using key_type = Token;
   using size_type = std::remove_reference_t<decltype( std::get<0>( std::declval<Token>( ) ) )>;
-  using reference = typename Container<value_type>::reference;
-  using const_reference = typename Container<value_type>::const_reference;
-  using pointer = typename Container<value_type>::pointer;
-  using const_pointer = typename Container<value_type>::const_pointer;
-  using container_type = Container<value_type>;
+  using reference = typename container_type::reference;
+  using const_reference = typename container_type::const_reference;
+  using pointer = typename container_type::pointer;
+  using const_pointer = typename container_type::const_pointer;
 
   // Note: 
   // slot_map requires a container providing an iterator satisfying the constraints of RandomAccessIterator
-  using iterator = typename Container<value_type>::iterator;
-  using const_iterator = typename Container<value_type>::const_iterator;
-  using reverse_iterator = typename Container<value_type>::reverse_iterator;
-  using const_reverse_iterator = typename Container<value_type>::const_reverse_iterator;
+  // For slot_map<soa<Ts...>> the iterators dereference to proxy references, see soa_vector.hpp
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+  using reverse_iterator = typename container_type::reverse_iterator;
+  using const_reverse_iterator = typename container_type::const_reverse_iterator;
 
 
   // constraint enforcement
-  static_assert( sizeof( key_size_type ) <= sizeof( typename Container<T>::size_type )
+  static_assert( sizeof( key_size_type ) <= sizeof( typename container_type::size_type )
                  , "The size of the type of get<0>() for the Token type must be at most Container::size_type." );
   static_assert( std::tuple_size<Token>::value == 2, "The token type for a slot_map must be decomposable into 2 integer-like types." );
   static_assert( std::is_same_v<typename std::iterator_traits<iterator>::iterator_category, std::random_access_iterator_tag>, 
@@ -38,6 +415,10 @@ public:
 
   // Constructors
   constexpr slot_map( );
+  // Constructs every container from allocator, converted to the allocator type of each container. Containers using
+  // std::pmr::polymorphic_allocator, such as those of pmr_slot_map, accept a std::pmr::memory_resource*.
+  template<typename Allocator, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Allocator>, slot_map>>>
+  constexpr explicit slot_map( const Allocator &allocator );
   constexpr slot_map( const slot_map & ) = default;
   constexpr slot_map( slot_map && ) = default;
   // Destructors
@@ -47,22 +428,42 @@ public:
   constexpr slot_map& operator=( slot_map && ) = default;
   
   constexpr const container_type& data( ) const;
+  // Only for slot_map<soa<Ts...>>: a span over the I-th component of every element, in iteration order.
+  template<std::size_t I>
+  constexpr auto column( );
+  template<std::size_t I>
+  constexpr auto column( ) const;
 
   // Element access is O(1) in all cases.
   // at() variations have all the checks and throw if a check fails
   constexpr reference at( const key_type& key );                         // bounds+generation checked, O(1) in all cases
   constexpr const_reference at( const key_type& key ) const;             // bounds+generation checked, O(1) in all cases
   // operator[] checks generation counter and has undefined behavior for a key which fails the check.
-  constexpr reference operator[]( const key_type& key );                 // generation checked, O(1) in all cases
-  constexpr const_reference operator[]( const key_type& key ) const;     // generation checked, O(1) in all cases
+  constexpr reference operator[]( const key_type& key );                 // bounds+generation checked, O(1) in all cases
+  constexpr const_reference operator[]( const key_type& key ) const;     // bounds+generation checked, O(1) in all cases
   // returns an iterator to the element if it is found, returns an iterator to 1 past the last element otherwise.
-  constexpr iterator find( const key_type& key );                        // generation checked, O(1) in all cases
-  constexpr const_iterator find( const key_type& key ) const;            // generation checked, O(1) in all cases
+  constexpr iterator find( const key_type& key );                        // bounds+generation checked, O(1) in all cases
+  constexpr const_iterator find( const key_type& key ) const;            // bounds+generation checked, O(1) in all cases
 
   // These functions could be considered "unsafe" but they offer 
   // a lookup with no branching for users confident they have a valid key
   constexpr reference find_unchecked( const key_type& key );             // unsafe, no checks, O(1) in all cases
   constexpr const_reference find_unchecked( const key_type& key ) const; // unsafe, no checks, O(1) in all cases
+  // The key of the element at position in iteration order, from the erase helper. position must be below size().
+  constexpr key_type key_at( size_type position ) const;                 // O(1) in all cases
+  // The position in iteration order of the element of key, read from its slot. key_index( key ) must be in range.
+  // Only meaningful for keys that validate, and a key from another map can name a free slot: compare key_at( ) too.
+  constexpr size_type position_unchecked( const key_type& key ) const;   // unsafe, no checks, O(1) in all cases
+
+  // Batched lookups for arrays of keys. Writes a pointer to the element of each key to out, or nullptr if the key
+  // is stale or out of range. Prefetches slots and then elements several keys ahead, so the cache misses of
+  // consecutive lookups overlap. Not available for slot_map<soa<Ts...>>, which has no element pointers.
+  void find_many( const key_type *keys, size_type count, pointer *out );             // bounds+generation checked, O(N)
+  void find_many( const key_type *keys, size_type count, const_pointer *out ) const; // bounds+generation checked, O(N)
+  // Bulk key validation: sets bit i % 64 of valid[ i / 64 ] when keys[ i ] is in range and has the generation of its slot.
+  // valid receives ( count + 63 ) / 64 words. With AVX2 or AVX-512 enabled, std::vector storage and a pair of 32 bit
+  // integers as the key, generations are gathered and compared 8 or 16 keys at a time with no data dependent branches.
+  void validate( const key_type *keys, size_type count, std::uint64_t *valid ) const; // O(N)
 
   // Allow users
                                                                // Iterators
@@ -84,11 +485,43 @@ public:
   constexpr size_type size( ) const;     // O(1) in all cases
   constexpr size_type max_size( ) const; // O(1) in all cases
   constexpr size_type capacity( ) const; // O(1) in all cases
-  constexpr void reserve( size_type n );  // O(N), O(1) if(empty() && n<slot_capacity() ), or if(n < capacity())
+  constexpr void reserve( size_type n );  // O(N), O(1) if(empty() && n<slot_capacity() ), or if(n < capacity()). Throws std::length_error past Growth::max_capacity
+  constexpr void shrink_to_fit( );        // O(N), reduces the capacity of the elements and erase helper to size()
 
   // Capacity unique to slot_map
   constexpr void reserve_slots( size_type n ); // O(N), O(1) if(capacity_slots() > n)
   constexpr size_type capacity_slots( ) const; // O(1) in all cases
+  // Drops the free slots after the last slot in use and shrinks the slot table to fit. Every key to an element stays
+  // valid, and stale keys to dropped slots are rejected, even after their slots are created again.
+  constexpr void compact_slots( );             // O(N) in the number of slots
+
+  // Locality: erase() moves the last element into the hole, so churn leaves the elements in no particular order.
+  // These permute the elements in place. The slot table and erase helper follow each element, so every key stays valid.
+  // Iterators and references to elements keep their position, and see the element moved into it.
+  template<typename Compare>
+  constexpr void sort( Compare comp );                    // O(N log N) comparisons, at most N - 1 swaps. Not stable
+  constexpr void reorder( const size_type *order );       // O(N), moves the element at order[ i ] to position i, order is a permutation of [0,size())
+  // Budgeted variant, to restore locality a few swaps at a time: moves the elements of keys, in order, to consecutive
+  // positions from position. Stale keys, and keys to elements already before position, are skipped. Stops before
+  // swap number max_swaps + 1, advances position past the elements placed and returns how many keys were consumed,
+  // so the next call continues with keys + consumed. Erasing between calls can move an element into the placed range.
+  constexpr size_type reorder( const key_type *keys, size_type count, size_type &position, size_type max_swaps ); // O(count)
+  // Writes the key of every element in the order sort( comp ) would leave them, the target of a budgeted reorder.
+  template<typename Compare, typename OutputIt>
+  constexpr OutputIt sorted_keys( Compare comp, OutputIt out_keys ) const; // O(N log N)
+
+  // Snapshots: the elements, slot table, erase helper and free list as contiguous blobs behind a versioned header.
+  // Every key stays valid across a write_snapshot( ) and load_snapshot( ) round trip. Only for trivially copyable
+  // elements in std::vector storage (including pmr_slot_map), and integer keys.
+  static constexpr std::size_t snapshot_alignment{ alignof( T ) > 64 ? alignof( T ) : 64 }; // alignment of image buffers
+  std::size_t snapshot_size( ) const;                     // O(1), size in bytes of the image write_snapshot( ) writes
+  void write_snapshot( void *image ) const;               // O(N), one memcpy per blob
+  // Throws std::invalid_argument, leaving the map untouched, if the image is misaligned or wasn't written by a slot_map of this type.
+  void load_snapshot( const void *image, std::size_t size ); // O(N), one bulk copy per blob and no per-element work
+
+  // Instrumentation: the counters of the Stats policy and the current gauges, see slot_map_statistics.
+  slot_map_statistics statistics( ) const;      // O(N) in the number of slots, for the occupancy histogram
+  void reset_statistics( );                     // O(1), zeroes the event counters
 
   // Modifiers equivalent to map
   constexpr void clear( );                                                // O(N)
@@ -96,105 +529,181 @@ public:
   constexpr key_type insert( value_type&& value );                        // O(1), O(N) when allocation is required
   template<typename... Args>
   constexpr key_type emplace( Args&&... args );                           // O(1), O(N) when allocation is required
+  // Batch insertion: storage for every element is reserved once, then the keys are written to out_keys in order.
+  // Both return the output iterator one past the last key written.
+  template<typename InputIt, typename OutputIt>
+  constexpr OutputIt insert( InputIt first, InputIt last, OutputIt out_keys ); // O(N), one allocation at most when first,last are forward iterators
+  template<typename Factory, typename OutputIt>
+  constexpr OutputIt emplace_n( size_type n, Factory factory, OutputIt out_keys ); // O(N), one allocation at most. Inserts factory(i) for i in [0,n)
   constexpr iterator erase( iterator pos );                               // O(1) in all cases
-  constexpr iterator erase( iterator first, iterator last );              // O(1) per element being erased, worst case O(N)
+  constexpr iterator erase( iterator first, iterator last );              // O(N) in the size of the range, moves at most that many elements
   constexpr iterator erase( const_iterator pos );                         // O(1) in all cases
-  constexpr iterator erase( const_iterator first, const_iterator last );  // O(1) per element being erased, worst case O(N)
+  constexpr iterator erase( const_iterator first, const_iterator last );  // O(N) in the size of the range, moves at most that many elements
+  // Insertions throw std::length_error when Growth::max_capacity elements are already stored.
   constexpr size_type erase( const key_type& key );                       // O(1) in all cases. Will contain an iterator if an element was erased
+  // Deferred erasure, to kill elements while iterating: defer_erase() only queues the key, so the elements and
+  // iterators stay where they are until flush_erases() erases every queued element in one batch. The batch sorts the
+  // queue by element position and erases runs of adjacent positions, highest first, with erase( first, last ).
+  // Keys which are stale by then, or queued twice, are skipped. Maps in fixed capacity containers queue at most
+  // capacity( ) keys, past which defer_erase() throws std::length_error.
+  // Only available with the slot_map_deferred_erase::queue policy.
+  constexpr void defer_erase( const key_type& key );                      // O(1), O(N) when allocation is required
+  constexpr void defer_erase( const_iterator pos );                       // O(1), O(N) when allocation is required
+  constexpr size_type pending_erases( ) const;                            // O(1), keys queued since the last flush
+  constexpr size_type flush_erases( );                                    // O(K log K) for K queued keys, returns how many elements were erased
 
 private:
-  Container<key_type> m_slots;
-  Container<T> m_data;
-  // this uses memory to offer O(1) for erase()
-  Container<key_size_type> m_erase_helper;
+  // The slot table and the erase helper, which uses memory to offer O(1) for erase(). See slot_map_layout.
+  typename Layout::template table<key_type, key_size_type, Container> m_slots;
+  container_type m_data;
+  // The free list is threaded through the key_index of free slots, the tail slot points to itself.
+  // An empty free list is represented by m_free_head == m_slots.slot_count( ).
   key_size_type m_free_head;
   key_size_type m_free_tail;
-
+  // The generation new slots start at. compact_slots() and clear() raise it above the generation of every slot they drop.
+  key_generation_type m_generation_floor;
+
+  template<typename Pointer>
+  void find_many_impl( const key_type *keys, size_type count, Pointer *out ) const;
+  static void prefetch( const void *address );
+  size_type validate_simd( const key_type *keys, size_type count, std::uint64_t *valid ) const;
+  constexpr bool free_list_empty( ) const;
   constexpr size_type pop_head( );
   constexpr void push_tail( size_type );
   constexpr key_type finish_inserting_last_element( );
   constexpr bool key_valid( const key_type &key );
+  constexpr void swap_elements( size_type a, size_type b );
+  template<typename Compare>
+  std::vector<size_type> sorted_order( Compare comp ) const;
+  template<typename C>
+  static constexpr size_type next_capacity( size_type current );
   constexpr void grow( );
   constexpr void grow_slots( );
   constexpr void pre_insert( );
+  constexpr void pre_insert( size_type count );
   constexpr key_size_type& key_index( key_type &key );
   constexpr const key_size_type& key_index( const key_type &key ) const;
   constexpr key_generation_type& key_generation( key_type &key );
   constexpr const key_generation_type& key_generation( const key_type &key ) const;
   constexpr key_size_type& element_index( key_type &key );
   constexpr const key_size_type& element_index( const key_type &key ) const;
-
-  static constexpr size_type growth_rate{ 2 };
-  static constexpr size_type initial_alloc_size{ static_cast<size_type>(20) };
+  slot_map_snapshot_header snapshot_header( ) const;
+
+  // How many keys ahead find_many() prefetches elements. Slots are prefetched twice as far ahead.
+  static constexpr size_type prefetch_distance{ 8 };
+  // validate() needs contiguous slots and keys made of two 32 bit integers, so it can deinterleave and gather them.
+  static constexpr bool simd_validate{ slot_map_contiguous<Container<key_type>>::value
+                                       && sizeof( key_size_type ) == 4 && sizeof( key_generation_type ) == 4
+                                       && sizeof( key_type ) == 8 && std::is_standard_layout_v<key_type> };
+  using deferred_storage = typename Deferred::template storage<Container<Token>>;
+  // Maps stored in fixed capacity containers have all of their slots from construction, see slot_map_fixed_capacity.
+  static constexpr bool fixed_capacity{ slot_map_fixed_capacity<container_type>::value };
 };
 
+// A slot_map storing its elements, slots and erase helper in paged_vectors, so growing appends pages instead of
+// moving every element.
+template<typename T, typename Token = std::pair<unsigned, unsigned>, typename Layout = slot_map_layout::separate,
+         typename Growth = slot_map_growth::automatic, typename Stats = slot_map_stats::none,
+         typename Deferred = slot_map_deferred_erase::none>
+using paged_slot_map = slot_map<T, Token, paged_container, Layout, Growth, Stats, Deferred>;
+
+// A slot_map allocating from a std::pmr::memory_resource, such as an arena: pmr_slot_map<T> map( &resource ).
+template<typename T, typename Token = std::pair<unsigned, unsigned>, typename Layout = slot_map_layout::separate,
+         typename Growth = slot_map_growth::automatic, typename Stats = slot_map_stats::none,
+         typename Deferred = slot_map_deferred_erase::none>
+using pmr_slot_map = slot_map<T, Token, std::pmr::vector, Layout, Growth, Stats, Deferred>;
+
+// A slot_map holding up to N elements inline in static_vectors: it never allocates, and insertions throw
+// std::length_error once it is full. For trivial element types it is usable in constant expressions. Its keys are
+// std::array<unsigned, 2> rather than std::pair, which isn't trivially assignable and so can't be stored in the
+// constexpr storage of a static_vector before C++20.
+template<typename T, std::size_t N, typename Token = std::array<unsigned, 2>, typename Layout = slot_map_layout::separate,
+         typename Stats = slot_map_stats::none, typename Deferred = slot_map_deferred_erase::none>
+using static_slot_map = slot_map<T, Token, static_storage<N>::template container, Layout, slot_map_growth::capped<N>, Stats, Deferred>;
+
 #pragma region constructors_impl
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr slot_map<T, Token, Container>::slot_map( )
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::slot_map( )
   : m_free_head(0)
   , m_free_tail(0)
-{ }
+  , m_generation_floor()
+{
+  if constexpr( fixed_capacity ) this->grow_slots( );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename Allocator, typename>
+constexpr slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::slot_map( const Allocator &allocator )
+  : deferred_storage( allocator )
+  , m_slots( allocator )
+  , m_data( allocator )
+  , m_free_head(0)
+  , m_free_tail(0)
+  , m_generation_floor()
+{
+  if constexpr( fixed_capacity ) this->grow_slots( );
+}
 #pragma endregion
 
 #pragma region iterators_impl
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::iterator slot_map<T, Token, Container>::begin( ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::begin( ) {
   return std::begin( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::iterator slot_map<T, Token, Container>::end( ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::end( ) {
   return std::end( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_iterator slot_map<T, Token, Container>::begin( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::begin( ) const {
   return std::begin( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_iterator slot_map<T, Token, Container>::end( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::end( ) const {
   return std::end( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_iterator slot_map<T, Token, Container>::cbegin( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::cbegin( ) const {
   return std::cbegin( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_iterator slot_map<T, Token, Container>::cend( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::cend( ) const {
   return std::cend( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::reverse_iterator slot_map<T, Token, Container>::rbegin( ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reverse_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::rbegin( ) {
   return std::rbegin( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::reverse_iterator slot_map<T, Token, Container>::rend( ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reverse_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::rend( ) {
   return std::rend( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_reverse_iterator slot_map<T, Token, Container>::rbegin( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_reverse_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::rbegin( ) const {
   return std::rbegin( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_reverse_iterator slot_map<T, Token, Container>::rend( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_reverse_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::rend( ) const {
   return std::rend( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_reverse_iterator slot_map<T, Token, Container>::crbegin( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_reverse_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::crbegin( ) const {
   return std::rbegin( m_data );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_reverse_iterator slot_map<T, Token, Container>::crend( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_reverse_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::crend( ) const {
   return std::rend( m_data );
 }
 #pragma endregion
@@ -202,346 +711,925 @@ constexpr typename slot_map<T, Token, Container>::const_reverse_iterator slot_ma
 #pragma region accessors_impl
 
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr const typename slot_map<T, Token, Container>::container_type& slot_map<T, Token, Container>::data( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr const typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::container_type& slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::data( ) const {
   return m_data;
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::reference slot_map<T, Token, Container>::at( const key_type &key ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<std::size_t I>
+constexpr auto slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::column( ) {
+  return m_data.template column<I>( );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<std::size_t I>
+constexpr auto slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::column( ) const {
+  return m_data.template column<I>( );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reference slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::at( const key_type &key ) {
   const auto &index{ this->key_index( key ) };
   const auto &generation{ this->key_generation( key ) };
-  if( index >= m_slots.size( ) || generation != key_generation( *( m_slots.begin( ) + index ) ) )
+  const bool stale{ index >= m_slots.slot_count( ) || generation != this->key_generation( m_slots.slot( index ) ) };
+  this->count_lookups( 1, stale );
+  if( stale )
     throw std::range_error( "Invalid key used with slot_map::at." );
   else
     return find_unchecked( key );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_reference slot_map<T, Token, Container>::at( const key_type &key ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_reference slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::at( const key_type &key ) const {
   const auto &index{ key_index( key ) };
   const auto &generation{ key_generation( key ) };
-  if( index >= m_slots.size( ) || generation != this->key_generation( *( std::begin( m_slots ) + index ) ) )
+  const bool stale{ index >= m_slots.slot_count( ) || generation != this->key_generation( m_slots.slot( index ) ) };
+  this->count_lookups( 1, stale );
+  if( stale )
     throw std::range_error("Invalid key used with slot_map::at." );
   else
     return this->find_unchecked( key );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_reference slot_map<T, Token, Container>::operator[]( const key_type &key ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_reference slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::operator[]( const key_type &key ) const {
   const auto &index{ this->key_index( key ) };
   const auto &generation{ this->key_generation( key ) };
-  if( index >= m_slots.size( ) || generation != this->key_generation( *( std::begin( m_slots ) + index ) ) )
+  const bool stale{ index >= m_slots.slot_count( ) || generation != this->key_generation( m_slots.slot( index ) ) };
+  this->count_lookups( 1, stale );
+  if( stale )
     throw std::range_error( "Invalid key used with slot_map::operator[]." );
   return *( std::cbegin( m_data ) + this->element_index( key ) );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::reference slot_map<T, Token, Container>::operator[]( const key_type &key ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reference slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::operator[]( const key_type &key ) {
   const auto &index{ this->key_index( key ) };
   const auto &generation{ this->key_generation( key ) };
-  if( generation != key_generation( *( m_slots.begin( ) + index ) ) )
+  const bool stale{ index >= m_slots.slot_count( ) || generation != this->key_generation( m_slots.slot( index ) ) };
+  this->count_lookups( 1, stale );
+  if( stale )
     throw std::range_error("Invalid key used with slot_map::operator[].");
   else
     return this->find_unchecked( key );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::iterator slot_map<T, Token, Container>::find( const key_type &key ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::find( const key_type &key ) {
   const auto &index{ this->key_index( key ) };
   const auto &generation{ this->key_generation( key ) };
-  if( generation != *( m_slots.begin( ) + index ) )
+  const bool stale{ index >= m_slots.slot_count( ) || generation != this->key_generation( m_slots.slot( index ) ) };
+  this->count_lookups( 1, stale );
+  if( stale )
     return this->end();
   return std::begin( m_data ) + element_index( key );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_iterator slot_map<T, Token, Container>::find( const key_type& key ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::find( const key_type& key ) const {
   const auto &index{ this->key_index( key ) };
   const auto &generation{ this->key_generation( key ) };
-  if( generation != *( m_slots.begin( ) + index ) )
+  const bool stale{ index >= m_slots.slot_count( ) || generation != this->key_generation( m_slots.slot( index ) ) };
+  this->count_lookups( 1, stale );
+  if( stale )
     return this->end( );
   return this->cbegin( ) + this->element_index( key );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::reference slot_map<T, Token, Container>::find_unchecked( const key_type& key ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reference slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::find_unchecked( const key_type& key ) {
   return *( std::begin( m_data ) + this->element_index( key ) );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::const_reference slot_map<T, Token, Container>::find_unchecked( const key_type& key ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::const_reference slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::find_unchecked( const key_type& key ) const {
   return *(std::cbegin( m_data ) + this->element_index( key ));
 }
 
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_at( size_type position ) const {
+  const key_size_type slot_index{ m_slots.reverse( position ) };
+  return key_type{ slot_index, this->key_generation( m_slots.slot( slot_index ) ) };
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::position_unchecked( const key_type& key ) const {
+  return static_cast<size_type>( this->element_index( key ) );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::find_many( const key_type *keys, size_type count, pointer *out ) {
+  this->find_many_impl( keys, count, out );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::find_many( const key_type *keys, size_type count, const_pointer *out ) const {
+  this->find_many_impl( keys, count, out );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename Pointer>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::find_many_impl( const key_type *keys, size_type count, Pointer *out ) const {
+  static_assert( !std::is_void_v<pointer>, "find_many() needs a container with element pointers." );
+  const size_type slot_count{ static_cast<size_type>( m_slots.slot_count( ) ) };
+  const size_type element_count{ this->size( ) };
+  // Two stages run ahead of the lookups: slots 2 * prefetch_distance keys ahead, and elements prefetch_distance
+  // keys ahead, by which time the slot telling where the element is has usually arrived.
+  const auto prefetch_slot = [&]( const key_type &key ) {
+    if( this->key_index( key ) < slot_count ) prefetch( &m_slots.slot( this->key_index( key ) ) );
+  };
+  const auto prefetch_element = [&]( const key_type &key ) {
+    if( this->key_index( key ) < slot_count ) {
+      const key_size_type element{ this->key_index( m_slots.slot( this->key_index( key ) ) ) };
+      if( element < element_count ) prefetch( std::addressof( *( std::cbegin( m_data ) + element ) ) );
+    }
+  };
+  for( size_type i{ 0 }; i < count && i < 2 * prefetch_distance; ++i ) {
+    prefetch_slot( keys[ i ] );
+  }
+  size_type stale{ 0 };
+  for( size_type i{ 0 }; i < count; ++i ) {
+    if( i + 2 * prefetch_distance < count ) prefetch_slot( keys[ i + 2 * prefetch_distance ] );
+    if( i + prefetch_distance < count ) prefetch_element( keys[ i + prefetch_distance ] );
+    const key_type &key{ keys[ i ] };
+    const size_type index{ this->key_index( key ) };
+    const key_type *slot{ index < slot_count ? &m_slots.slot( index ) : nullptr };
+    if( slot && this->key_generation( key ) == this->key_generation( *slot ) && this->key_index( *slot ) < element_count ) {
+      out[ i ] = const_cast<Pointer>( std::addressof( *( std::cbegin( m_data ) + this->key_index( *slot ) ) ) );
+    }
+    else {
+      out[ i ] = nullptr;
+      ++stale;
+    }
+  }
+  this->count_lookups( count, stale );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::validate( const key_type *keys, size_type count, std::uint64_t *valid ) const {
+  for( size_type word{ 0 }; word < ( count + 63 ) / 64; ++word ) {
+    valid[ word ] = 0;
+  }
+  const size_type slot_count{ static_cast<size_type>( m_slots.slot_count( ) ) };
+  for( size_type i{ this->validate_simd( keys, count, valid ) }; i < count; ++i ) {
+    const size_type index{ this->key_index( keys[ i ] ) };
+    const bool is_valid{ index < slot_count && this->key_generation( keys[ i ] ) == this->key_generation( m_slots.slot( index ) ) };
+    valid[ i / 64 ] |= std::uint64_t{ is_valid } << ( i % 64 );
+  }
+  if constexpr( Stats::enabled ) {
+    std::size_t found{ 0 };
+    for( size_type word{ 0 }; word < ( count + 63 ) / 64; ++word ) {
+      for( std::uint64_t bits{ valid[ word ] }; bits; bits &= bits - 1 ) ++found;
+    }
+    this->count_lookups( count, count - found );
+  }
+}
+
 #pragma endregion
 
 #pragma region size_impl
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr bool slot_map<T, Token, Container>::empty( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr bool slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::empty( ) const {
   return m_data.empty( );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::size_type slot_map<T, Token, Container>::size( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size( ) const {
   return static_cast<size_type>(m_data.size( ));
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::size_type slot_map<T, Token, Container>::max_size( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::max_size( ) const {
   return static_cast<size_type>( m_data.max_size( ) );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::size_type slot_map<T, Token, Container>::capacity( ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::capacity( ) const {
   return static_cast<size_type>( m_data.capacity( ) );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr void slot_map<T, Token, Container>::reserve( size_type n ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reserve( size_type n ) {
+  if( n > Growth::max_capacity ) throw std::length_error( "slot_map::reserve exceeds the max capacity of its growth policy." );
   if( n > this->capacity( ) ) {
     m_data.reserve( n );
-    m_slots.reserve( n );
-    this->grow_slots( );
-    m_erase_helper.reserve( n );
+    m_slots.reserve_slots( n );
+    if( m_slots.slot_capacity( ) > m_slots.slot_count( ) ) this->grow_slots( );
+    m_slots.reserve_reverse( n );
   }
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr void slot_map<T, Token, Container>::reserve_slots( size_type n ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::shrink_to_fit( ) {
+  m_data.shrink_to_fit( );
+  m_slots.shrink_reverse( );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reserve_slots( size_type n ) {
+  if( n > Growth::max_capacity ) throw std::length_error( "slot_map::reserve_slots exceeds the max capacity of its growth policy." );
   if( n > this->capacity_slots( ) ) {
-    m_slots.reserve( n );
+    m_slots.reserve_slots( n );
     this->grow_slots( );
   }
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::size_type slot_map<T, Token, Container>::capacity_slots( ) const {
-  return m_slots.capacity( );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::capacity_slots( ) const {
+  return m_slots.slot_capacity( );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::compact_slots( ) {
+  // Keeps the slots up to the last one in use. Keys to dropped slots fall out of range, and slots created again later
+  // start at a generation above every dropped one, so those keys never match them.
+  const size_type slot_count{ static_cast<size_type>( m_slots.slot_count( ) ) };
+  std::vector<bool> in_use( slot_count );
+  size_type kept{ 0 };
+  for( size_type i{ 0 }; i < this->size( ); ++i ) {
+    const size_type slot_index{ static_cast<size_type>( m_slots.reverse( i ) ) };
+    in_use[ slot_index ] = true;
+    if( slot_index >= kept ) kept = static_cast<size_type>( slot_index + 1 );
+  }
+  for( size_type i{ kept }; i < slot_count; ++i ) {
+    const key_generation_type generation{ this->key_generation( m_slots.slot( i ) ) };
+    if( !( generation < m_generation_floor ) ) m_generation_floor = static_cast<key_generation_type>( generation + 1 );
+  }
+  m_slots.truncate_slots( kept );
+  m_slots.shrink_slots( );
+
+  // Relinks the remaining free slots in index order.
+  m_free_head = static_cast<key_size_type>( kept );
+  m_free_tail = m_free_head;
+  for( size_type i{ kept }; i-- > 0; ) {
+    if( in_use[ i ] ) continue;
+    this->key_index( m_slots.slot( i ) ) = static_cast<key_size_type>( this->free_list_empty( ) ? i : m_free_head );
+    if( this->free_list_empty( ) ) m_free_tail = static_cast<key_size_type>( i );
+    m_free_head = static_cast<key_size_type>( i );
+  }
+  // The dropped slots only return to fixed capacity maps, with their generations raised.
+  if constexpr( fixed_capacity ) this->grow_slots( );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename Compare>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::sort( Compare comp ) {
+  const std::vector<size_type> order{ this->sorted_order( comp ) };
+  this->reorder( order.data( ) );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reorder( const size_type *order ) {
+  // Follows the cycles of the permutation, each swap leaves one element in its final position.
+  const size_type element_count{ this->size( ) };
+  std::vector<size_type> destination( element_count );
+  for( size_type i{ 0 }; i < element_count; ++i ) {
+    destination[ order[ i ] ] = i;
+  }
+  for( size_type i{ 0 }; i < element_count; ++i ) {
+    while( destination[ i ] != i ) {
+      const size_type target{ destination[ i ] };
+      this->swap_elements( i, target );
+      std::swap( destination[ i ], destination[ target ] );
+    }
+  }
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type
+slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reorder( const key_type *keys, size_type count, size_type &position, size_type max_swaps ) {
+  size_type swaps{ 0 };
+  size_type consumed{ 0 };
+  for( ; consumed < count && position < this->size( ); ++consumed ) {
+    const key_type &key{ keys[ consumed ] };
+    if( !this->key_valid( key ) ) continue;
+    const size_type current{ static_cast<size_type>( this->element_index( key ) ) };
+    if( current < position ) continue;
+    if( current != position ) {
+      if( swaps == max_swaps ) break;
+      this->swap_elements( position, current );
+      ++swaps;
+    }
+    ++position;
+  }
+  return consumed;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename Compare, typename OutputIt>
+constexpr OutputIt slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::sorted_keys( Compare comp, OutputIt out_keys ) const {
+  for( const size_type element : this->sorted_order( comp ) ) {
+    *out_keys = this->key_at( element );
+    ++out_keys;
+  }
+  return out_keys;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+slot_map_statistics slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::statistics( ) const {
+  slot_map_statistics statistics{ };
+  this->fill_statistics( statistics );
+  const size_type slot_count{ static_cast<size_type>( m_slots.slot_count( ) ) };
+  statistics.size = this->size( );
+  statistics.capacity = this->capacity( );
+  statistics.slot_count = slot_count;
+  statistics.free_slots = slot_count - this->size( );
+  statistics.slot_occupancy = slot_count ? static_cast<double>( this->size( ) ) / slot_count : 0.0;
+  // A slot holds an element when the erase helper entry of the element it points to points back at it.
+  for( size_type block{ 0 }; block < slot_count; block += 64 ) {
+    const size_type block_end{ slot_count - block < 64 ? slot_count : static_cast<size_type>( block + 64 ) };
+    std::size_t live{ 0 };
+    for( size_type i{ block }; i < block_end; ++i ) {
+      const size_type element{ static_cast<size_type>( this->key_index( m_slots.slot( i ) ) ) };
+      live += element < this->size( ) && static_cast<size_type>( m_slots.reverse( element ) ) == i;
+    }
+    ++statistics.occupancy_histogram[ ( live + 7 ) / 8 ];
+  }
+  return statistics;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::reset_statistics( ) {
+  this->reset_counters( );
+}
+
+#pragma endregion
+
+#pragma region snapshot_impl
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+slot_map_snapshot_header slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::snapshot_header( ) const {
+  static_assert( slot_map_contiguous<container_type>::value && slot_map_contiguous<typename decltype( m_slots )::slot_container>::value,
+                 "Only slot_maps using std::vector storage can be snapshot." );
+  static_assert( std::is_trivially_copyable_v<T>, "Only slot_maps of trivially copyable elements can be snapshot." );
+  static_assert( std::is_integral_v<key_size_type> && std::is_integral_v<key_generation_type>,
+                 "Only slot_maps with integer keys can be snapshot." );
+  using slot_record = typename decltype( m_slots )::slot_record;
+  auto align = []( std::uint64_t offset ) { return ( offset + snapshot_alignment - 1 ) / snapshot_alignment * snapshot_alignment; };
+  slot_map_snapshot_header header{ };
+  header.magic = slot_map_snapshot_header::magic_value;
+  header.version = slot_map_snapshot_header::current_version;
+  header.value_size = sizeof( T );
+  header.value_alignment = alignof( T );
+  header.key_size = sizeof( key_type );
+  header.slot_record_size = sizeof( slot_record );
+  header.reverse_record_size = sizeof( key_size_type );
+  header.element_count = m_data.size( );
+  header.slot_count = m_slots.slot_count( );
+  header.reverse_count = m_slots.reverse_record_count( m_data.size( ) );
+  header.free_head = static_cast<std::uint64_t>( m_free_head );
+  header.free_tail = static_cast<std::uint64_t>( m_free_tail );
+  header.generation_floor = static_cast<std::uint64_t>( m_generation_floor );
+  header.data_offset = align( sizeof( header ) );
+  header.slots_offset = align( header.data_offset + header.element_count * sizeof( T ) );
+  header.reverse_offset = align( header.slots_offset + header.slot_count * sizeof( slot_record ) );
+  header.total_size = align( header.reverse_offset + header.reverse_count * sizeof( key_size_type ) );
+  return header;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+std::size_t slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::snapshot_size( ) const {
+  return static_cast<std::size_t>( this->snapshot_header( ).total_size );
+}
+
+// image must hold snapshot_size( ) bytes and be aligned to snapshot_alignment. The padding between blobs is zeroed.
+// Writing the image to a file gives a persistent copy of the map which can be memory-mapped and loaded later.
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::write_snapshot( void *image ) const {
+  const slot_map_snapshot_header header{ this->snapshot_header( ) };
+  assert( reinterpret_cast<std::uintptr_t>( image ) % snapshot_alignment == 0 );
+  char *bytes{ static_cast<char *>( image ) };
+  std::memset( bytes, 0, static_cast<std::size_t>( header.total_size ) );
+  std::memcpy( bytes, &header, sizeof( header ) );
+  if( header.element_count ) std::memcpy( bytes + header.data_offset, m_data.data( ), header.element_count * sizeof( T ) );
+  if( header.slot_count ) std::memcpy( bytes + header.slots_offset, m_slots.slot_records( ), header.slot_count * header.slot_record_size );
+  if( header.reverse_count ) std::memcpy( bytes + header.reverse_offset, m_slots.reverse_records( ), header.reverse_count * header.reverse_record_size );
+}
+
+// Replaces the contents of the map with the image, which can be a memory-mapped snapshot file. Each container is
+// assigned its blob in one call, which copies trivially copyable elements as a block, so loading is bounded by
+// memory bandwidth and faulting in the pages of the image. Keys from before the call are invalidated.
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::load_snapshot( const void *image, std::size_t size ) {
+  slot_map_snapshot_header header;
+  const slot_map_snapshot_header expected{ this->snapshot_header( ) };
+  if( image == nullptr || size < sizeof( header ) ) throw std::invalid_argument( "slot_map::load_snapshot image is too small." );
+  if( reinterpret_cast<std::uintptr_t>( image ) % snapshot_alignment != 0 ) {
+    throw std::invalid_argument( "slot_map::load_snapshot image is not aligned to snapshot_alignment." );
+  }
+  std::memcpy( &header, image, sizeof( header ) );
+  if( header.magic != expected.magic || header.version != expected.version ) {
+    throw std::invalid_argument( "slot_map::load_snapshot image is not a slot_map snapshot of this version." );
+  }
+  if( header.value_size != expected.value_size || header.value_alignment != expected.value_alignment
+      || header.key_size != expected.key_size || header.slot_record_size != expected.slot_record_size
+      || header.reverse_record_size != expected.reverse_record_size ) {
+    throw std::invalid_argument( "slot_map::load_snapshot image was written by a different slot_map type." );
+  }
+  if( header.total_size > size || header.element_count > header.slot_count
+      || header.slot_count > static_cast<std::uint64_t>( std::numeric_limits<size_type>::max( ) )
+      || header.reverse_count != m_slots.reverse_record_count( static_cast<std::size_t>( header.element_count ) )
+      || header.free_head > header.slot_count || header.free_tail > header.slot_count
+      || header.data_offset + header.element_count * sizeof( T ) > header.total_size
+      || header.slots_offset + header.slot_count * header.slot_record_size > header.total_size
+      || header.reverse_offset + header.reverse_count * header.reverse_record_size > header.total_size ) {
+    throw std::invalid_argument( "slot_map::load_snapshot image is truncated or corrupt." );
+  }
+  using slot_record = typename decltype( m_slots )::slot_record;
+  const char *bytes{ static_cast<const char *>( image ) };
+  const T *data{ reinterpret_cast<const T *>( bytes + header.data_offset ) };
+  m_data.assign( data, data + header.element_count );
+  m_slots.assign_records( reinterpret_cast<const slot_record *>( bytes + header.slots_offset ), static_cast<std::size_t>( header.slot_count ),
+                          reinterpret_cast<const key_size_type *>( bytes + header.reverse_offset ), static_cast<std::size_t>( header.reverse_count ) );
+  m_free_head = static_cast<key_size_type>( header.free_head );
+  m_free_tail = static_cast<key_size_type>( header.free_tail );
+  m_generation_floor = static_cast<key_generation_type>( header.generation_floor );
+  if constexpr( Deferred::enabled ) this->m_deferred_erases.clear( );
 }
 
 #pragma endregion
 
 #pragma region modifiers_impl
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr void slot_map<T, Token, Container>::clear( ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::clear( ) {
+  // The slots are rebuilt above every dropped generation, so keys from before the clear never match a new element.
+  const size_type slot_count{ static_cast<size_type>( m_slots.slot_count( ) ) };
+  for( size_type i{ 0 }; i < slot_count; ++i ) {
+    const key_generation_type generation{ this->key_generation( m_slots.slot( i ) ) };
+    if( !( generation < m_generation_floor ) ) m_generation_floor = static_cast<key_generation_type>( generation + 1 );
+  }
   m_data.clear( );
   m_slots.clear( );
-  m_erase_helper.clear( );
+  if constexpr( Deferred::enabled ) this->m_deferred_erases.clear( );
+  m_free_head = 0;
+  m_free_tail = 0;
   this->grow_slots( );
 
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::key_type slot_map<T, Token, Container>::finish_inserting_last_element( ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::finish_inserting_last_element( ) {
   size_type slot_index{ pop_head( ) };
-  key_type& key{ *( std::begin( m_slots ) + slot_index ) };
+  key_type& key{ m_slots.slot( slot_index ) };
   key_size_type &index = this->key_index( key );
   const key_generation_type& generation = this->key_generation( key );
   index = static_cast< size_type >( m_data.size( ) - 1 );
-  m_erase_helper.push_back( slot_index );
+  m_slots.push_reverse( static_cast<size_type>( m_data.size( ) - 1 ), static_cast<key_size_type>( slot_index ) );
   return { static_cast<key_size_type>( slot_index ), generation };
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::key_type slot_map<T, Token, Container>::insert( const_reference value ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::insert( const_reference value ) {
   this->pre_insert( );
   m_data.push_back( value );
   return this->finish_inserting_last_element( );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::key_type slot_map<T, Token, Container>::insert( value_type&& value ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::insert( value_type&& value ) {
   this->pre_insert( );
   m_data.push_back( std::move( value ) );
   return this->finish_inserting_last_element( );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
 template<typename... Args>
-constexpr typename slot_map<T, Token, Container>::key_type slot_map<T, Token, Container>::emplace( Args&&... args ) {
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::emplace( Args&&... args ) {
   this->pre_insert( );
   m_data.emplace_back( std::forward<Args>( args )... );
   return this->finish_inserting_last_element( );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::iterator slot_map<T, Token, Container>::erase( iterator pos ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename InputIt, typename OutputIt>
+constexpr OutputIt slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::insert( InputIt first, InputIt last, OutputIt out_keys ) {
+  using category = typename std::iterator_traits<InputIt>::iterator_category;
+  if constexpr( std::is_base_of_v<std::forward_iterator_tag, category> ) {
+    this->pre_insert( static_cast<size_type>( std::distance( first, last ) ) );
+    for( ; first != last; ++first ) {
+      m_data.push_back( *first );
+      *out_keys = this->finish_inserting_last_element( );
+      ++out_keys;
+    }
+  }
+  else { // single pass ranges can't be measured up front
+    for( ; first != last; ++first ) {
+      *out_keys = this->insert( *first );
+      ++out_keys;
+    }
+  }
+  return out_keys;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename Factory, typename OutputIt>
+constexpr OutputIt slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::emplace_n( size_type n, Factory factory, OutputIt out_keys ) {
+  this->pre_insert( n );
+  for( size_type i{ 0 }; i < n; ++i ) {
+    m_data.emplace_back( factory( i ) );
+    *out_keys = this->finish_inserting_last_element( );
+    ++out_keys;
+  }
+  return out_keys;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::erase( iterator pos ) {
   if( pos == this->end( ) ) return pos;
   else if( pos == ( std::end( m_data ) - 1 ) ) {
     m_data.pop_back( );
-    this->push_tail( m_erase_helper.back( ) );
-    m_erase_helper.pop_back( );
+    this->push_tail( m_slots.reverse( this->size( ) ) );
+    m_slots.truncate_reverse( this->size( ) );
+    this->count_erases( 1, 0 );
     return this->end( );
   }
   else { // erase valid element that isn't the last element
     const auto dist{ std::distance( this->begin( ), pos ) };
-    const key_size_type slot_index{ *( m_erase_helper.begin( ) + dist ) };
+    const key_size_type slot_index{ m_slots.reverse( static_cast<size_type>( dist ) ) };
     this->push_tail( slot_index );
-    *pos = std::move( m_data.back( ) );
+    slot_map_storage<T, Container>::relocate( m_data, static_cast<typename container_type::size_type>( dist ), m_data.size( ) - 1 );
     m_data.pop_back( );
-    const key_size_type update_slot{ m_erase_helper.back( ) };
-    *( m_erase_helper.begin( ) + dist ) = m_erase_helper.back( );
-    m_erase_helper.pop_back( );
-    this->key_index( *( std::begin( m_slots ) + update_slot ) ) = dist;
+    const key_size_type update_slot{ m_slots.reverse( this->size( ) ) };
+    m_slots.reverse( static_cast<size_type>( dist ) ) = update_slot;
+    m_slots.truncate_reverse( this->size( ) );
+    this->key_index( m_slots.slot( update_slot ) ) = dist;
+    this->count_erases( 1, 1 );
     return pos;
   }
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::iterator slot_map<T, Token, Container>::erase( iterator first, iterator last ) {
-  static_assert( false, "erase() needs to be implemented." );
-  const auto range_size{ std::distance( first, last ) };
-  const auto dist_from_end{ std::distance( last, this->end( ) ) };
-  if( last == this->end( ) ) {
-    for( auto it{ last - 1 }; it >= first; --it ) {
-      this->erase( it );
-    }
-    return first;
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::erase( iterator first, iterator last ) {
+  // Erases the range in one pass:
+  // 1. the slots of every erased element are linked into a chain and spliced onto the tail of the free list,
+  // 2. only the elements past the range which are needed to fill the gap are moved into it, from the back,
+  // 3. the tail of the data and erase helper is dropped at once.
+  const auto first_index{ std::distance( this->begin( ), first ) };
+  const auto last_index{ std::distance( this->begin( ), last ) };
+  const auto range_size{ last_index - first_index };
+  if( range_size <= 0 ) return first;
+
+  const size_type range_first{ static_cast<size_type>( first_index ) };
+  const size_type range_last{ static_cast<size_type>( last_index ) };
+  for( size_type i{ range_first }; i != range_last; ++i ) {
+    key_type &slot{ m_slots.slot( m_slots.reverse( i ) ) };
+    ++this->key_generation( slot );
+    this->key_index( slot ) = m_slots.reverse( i + 1 != range_last ? i + 1 : i );
   }
-  else if( range_size < dist_from_end ) { // @@TODO: optimize this
-    iterator separator{ first + dist_from_end };
-    for( auto it{ first }; it != separator; ++it ) {
-      this->erase( it );
-    }
-    assert( last == end( ) );
-    for( auto it{ last - 1 }; it >= first; --it ) {
-      this->erase( it );
-    }
-    // erase the first dist_from_end - range_size elements, 
-    // then everything remaining to be erased reaches the end and they can be erased in reverse order
-    return first;
+  if( this->free_list_empty( ) ) {
+    m_free_head = m_slots.reverse( range_first );
   }
-  else { // length of range does not reach the end
-    for( auto it{ first }; it != last; ++it ) {
-      this->erase( it );
-    }
-    return first;
+  else {
+    this->key_index( m_slots.slot( m_free_tail ) ) = m_slots.reverse( range_first );
+  }
+  m_free_tail = m_slots.reverse( range_last - 1 );
+
+  const auto old_size{ std::distance( this->begin( ), this->end( ) ) };
+  const auto moved{ std::min( range_size, old_size - last_index ) };
+  const auto source{ old_size - moved };
+  for( std::remove_const_t<decltype( moved )> i{ 0 }; i != moved; ++i ) {
+    slot_map_storage<T, Container>::relocate( m_data, static_cast<typename container_type::size_type>( first_index + i ),
+                                              static_cast<typename container_type::size_type>( source + i ) );
   }
+  for( std::remove_const_t<decltype( moved )> i{ 0 }; i != moved; ++i ) {
+    const key_size_type moved_slot{ m_slots.reverse( static_cast<size_type>( source + i ) ) };
+    m_slots.reverse( static_cast<size_type>( first_index + i ) ) = moved_slot;
+    this->key_index( m_slots.slot( moved_slot ) ) = static_cast<key_size_type>( first_index + i );
+  }
+  m_data.erase( std::end( m_data ) - range_size, std::end( m_data ) );
+  m_slots.truncate_reverse( this->size( ) );
+  this->count_erases( static_cast<std::size_t>( range_size ), static_cast<std::size_t>( moved ) );
+  return this->begin( ) + first_index;
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::iterator slot_map<T, Token, Container>::erase( const_iterator pos ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::erase( const_iterator pos ) {
   const auto dist{ std::distance( this->cbegin( ), pos ) };
   return this->erase( this->begin( ) + dist );
 }
 
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::iterator slot_map<T, Token, Container>::erase( const_iterator first, const_iterator last ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::iterator slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::erase( const_iterator first, const_iterator last ) {
   const auto fdist{ std::distance( this->cbegin( ), first ) };
   const auto ldist{ std::distance( this->cbegin( ), last ) };
   return this->erase( this->begin( ) + fdist, this->begin( ) + ldist );
 }
 
-template<typename T, typename Token, template<typename...> typename Container>
-constexpr typename slot_map<T, Token, Container>::size_type slot_map<T, Token, Container>::erase( const key_type &key ) {
-  if( this->key_valid( key ) ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::erase( const key_type &key ) {
+  const bool valid{ this->key_valid( key ) };
+  this->count_lookups( 1, !valid );
+  if( valid ) {
     this->erase( this->begin( ) + this->element_index( key ) );
     return 1;
   }
   return 0;
 }
 
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::defer_erase( const key_type &key ) {
+  static_assert( Deferred::enabled, "defer_erase() needs the slot_map_deferred_erase::queue policy." );
+  if constexpr( fixed_capacity ) {
+    if( this->m_deferred_erases.size( ) == this->m_deferred_erases.capacity( ) ) throw std::length_error( "slot_map has reached the fixed capacity of its deferred erase queue." );
+  }
+  this->m_deferred_erases.push_back( key );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::defer_erase( const_iterator pos ) {
+  this->defer_erase( this->key_at( static_cast<size_type>( std::distance( this->cbegin( ), pos ) ) ) );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::pending_erases( ) const {
+  static_assert( Deferred::enabled, "pending_erases() needs the slot_map_deferred_erase::queue policy." );
+  return static_cast<size_type>( this->m_deferred_erases.size( ) );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::flush_erases( ) {
+  static_assert( Deferred::enabled, "flush_erases() needs the slot_map_deferred_erase::queue policy." );
+  if( this->m_deferred_erases.empty( ) ) return 0;
+  // The queued keys are rewritten in place to hold the position of their element, or size() for stale keys.
+  const key_size_type stale{ static_cast<key_size_type>( this->size( ) ) };
+  std::size_t misses{ 0 };
+  for( key_type &key : this->m_deferred_erases ) {
+    const bool valid{ this->key_valid( key ) };
+    const key_size_type position{ valid ? this->element_index( key ) : stale };
+    this->key_index( key ) = position;
+    misses += !valid;
+  }
+  this->count_lookups( this->m_deferred_erases.size( ), misses );
+  // Keys queued during a forward pass are already in position order, which skips the sort.
+  const auto by_position{ [this]( const key_type &a, const key_type &b ) { return this->key_index( a ) < this->key_index( b ); } };
+  if( !std::is_sorted( std::begin( this->m_deferred_erases ), std::end( this->m_deferred_erases ), by_position ) ) {
+    std::sort( std::begin( this->m_deferred_erases ), std::end( this->m_deferred_erases ), by_position );
+  }
+
+  // Erasing the highest run first only moves elements from past every queued position into the gap, so the
+  // positions of the runs still to erase don't change.
+  size_type erased{ 0 };
+  const auto queue_begin{ std::begin( this->m_deferred_erases ) };
+  auto run{ std::end( this->m_deferred_erases ) };
+  while( run != queue_begin && this->key_index( *( run - 1 ) ) == stale ) --run;
+  while( run != queue_begin ) {
+    --run;
+    const size_type last{ static_cast<size_type>( this->key_index( *run ) + 1 ) };
+    size_type first{ static_cast<size_type>( last - 1 ) };
+    // Extends the run over adjacent positions, and over keys queued twice.
+    for( ; run != queue_begin && this->key_index( *( run - 1 ) ) + size_type{ 1 } >= first; --run ) {
+      first = static_cast<size_type>( this->key_index( *( run - 1 ) ) );
+    }
+    this->erase( this->begin( ) + first, this->begin( ) + last );
+    erased += last - first;
+  }
+  this->m_deferred_erases.clear( );
+  return erased;
+}
+
 #pragma endregion
 
 #pragma region helpers_impl
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr typename slot_map<T, Token, Container>::size_type slot_map<T, Token, Container>::pop_head( ) {
-  if( this->size( ) == this->capacity( ) )this->grow( );
-  key_size_type next_free_head{ this->key_index( *( std::begin( m_slots ) + m_free_head ) ) };
-  if( next_free_head == m_free_head ) { // last free slot 
-    assert( m_data.size( ) == m_data.capacity( ) );
-    return static_cast< size_type >( m_free_head );
+// The vectorized part of validate(). Returns how many keys it checked, the rest are left for the scalar loop.
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::validate_simd( const key_type *keys, size_type count, std::uint64_t *valid ) const {
+#if defined(__AVX2__) || defined(__AVX512F__)
+  if constexpr( simd_validate ) {
+    constexpr std::size_t stride{ decltype( m_slots )::slot_stride };
+    const size_type slot_count{ static_cast<size_type>( m_slots.slot_count( ) ) };
+    // slot offsets are computed as 32 bit byte offsets
+    if( slot_count == 0 || slot_count > ( std::uint64_t{ 1 } << 31 ) / stride ) return 0;
+    const char *generations{ reinterpret_cast<const char *>( &this->key_generation( m_slots.slot( 0 ) ) ) };
+    const int *key_words{ reinterpret_cast<const int *>( keys ) };
+    size_type i{ 0 };
+#if defined(__AVX512F__)
+    const __m512i even16{ _mm512_setr_epi32( 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 ) };
+    const __m512i odd16{ _mm512_setr_epi32( 1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31 ) };
+    const __m512i last_slot16{ _mm512_set1_epi32( static_cast<int>( slot_count - 1 ) ) };
+    const __m512i stride16{ _mm512_set1_epi32( static_cast<int>( stride ) ) };
+    for( ; i + 16 <= count; i += 16 ) {
+      const __m512i low{ _mm512_loadu_si512( key_words + 2 * i ) };
+      const __m512i high{ _mm512_loadu_si512( key_words + 2 * i + 16 ) };
+      const __m512i index{ _mm512_permutex2var_epi32( low, even16, high ) };
+      const __m512i generation{ _mm512_permutex2var_epi32( low, odd16, high ) };
+      const __mmask16 in_range{ _mm512_cmple_epu32_mask( index, last_slot16 ) };
+      const __m512i current{ _mm512_mask_i32gather_epi32( _mm512_setzero_si512( ), in_range, _mm512_mullo_epi32( index, stride16 ), generations, 1 ) };
+      const __mmask16 matches{ _mm512_mask_cmpeq_epi32_mask( in_range, current, generation ) };
+      valid[ i / 64 ] |= std::uint64_t{ matches } << ( i % 64 );
+    }
+#endif
+    const __m256i last_slot{ _mm256_set1_epi32( static_cast<int>( slot_count - 1 ) ) };
+    const __m256i stride8{ _mm256_set1_epi32( static_cast<int>( stride ) ) };
+    for( ; i + 8 <= count; i += 8 ) {
+      const __m256 low{ _mm256_castsi256_ps( _mm256_loadu_si256( reinterpret_cast<const __m256i *>( key_words + 2 * i ) ) ) };
+      const __m256 high{ _mm256_castsi256_ps( _mm256_loadu_si256( reinterpret_cast<const __m256i *>( key_words + 2 * i + 8 ) ) ) };
+      // deinterleave the { index, generation } pairs, shuffle_ps works within 128 bit lanes so the halves are reordered after
+      const __m256i index{ _mm256_permute4x64_epi64( _mm256_castps_si256( _mm256_shuffle_ps( low, high, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) };
+      const __m256i generation{ _mm256_permute4x64_epi64( _mm256_castps_si256( _mm256_shuffle_ps( low, high, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) };
+      // unsigned index <= slot_count - 1
+      const __m256i in_range{ _mm256_cmpeq_epi32( _mm256_min_epu32( index, last_slot ), index ) };
+      const __m256i current{ _mm256_mask_i32gather_epi32( _mm256_setzero_si256( ), reinterpret_cast<const int *>( generations ),
+                                                          _mm256_mullo_epi32( index, stride8 ), in_range, 1 ) };
+      const __m256i matches{ _mm256_and_si256( in_range, _mm256_cmpeq_epi32( current, generation ) ) };
+      valid[ i / 64 ] |= std::uint64_t{ static_cast<unsigned>( _mm256_movemask_ps( _mm256_castsi256_ps( matches ) ) ) } << ( i % 64 );
+    }
+    return i;
+  }
+#endif
+  ( void )keys;
+  ( void )count;
+  ( void )valid;
+  return 0;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::prefetch( const void *address ) {
+#if defined(_MSC_VER)
+  _mm_prefetch( static_cast<const char *>( address ), _MM_HINT_T0 );
+#else
+  __builtin_prefetch( address, 0, 3 );
+#endif
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr bool slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::free_list_empty( ) const {
+  return static_cast<size_type>( m_free_head ) == static_cast<size_type>( m_slots.slot_count( ) );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::pop_head( ) {
+  if constexpr( !fixed_capacity ) {
+    if( this->free_list_empty( ) ) this->grow_slots( );
+  }
+  key_size_type result{ m_free_head };
+  if( m_free_head == m_free_tail ) { // last free slot 
+    m_free_head = static_cast<key_size_type>( m_slots.slot_count( ) );
+    m_free_tail = m_free_head;
   }
   else {
-    key_size_type result{ m_free_head };
-    m_free_head = next_free_head;
-    return static_cast<size_type>( result );
+    m_free_head = this->key_index( m_slots.slot( m_free_head ) );
   }
+  return static_cast<size_type>( result );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr void slot_map<T, Token, Container>::push_tail( size_type tail_index ) {
-  this->key_index( *( std::begin( m_slots ) + m_free_tail ) ) = tail_index;
-  this->key_index( *( std::begin( m_slots ) + tail_index ) ) = tail_index;
-  m_free_tail = tail_index;
-  ++this->key_generation( *( std::begin( m_slots ) + tail_index ) );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::push_tail( size_type tail_index ) {
+  if( this->free_list_empty( ) ) {
+    m_free_head = static_cast<key_size_type>( tail_index );
+  }
+  else {
+    this->key_index( m_slots.slot( m_free_tail ) ) = static_cast<key_size_type>( tail_index );
+  }
+  this->key_index( m_slots.slot( tail_index ) ) = static_cast<key_size_type>( tail_index );
+  m_free_tail = static_cast<key_size_type>( tail_index );
+  ++this->key_generation( m_slots.slot( tail_index ) );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr bool slot_map<T, Token, Container>::key_valid( const key_type &key ) {
-  return this->key_generation( key ) == this->key_generation( *( std::begin( m_slots ) + key_index( key ) ) );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr bool slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_valid( const key_type &key ) {
+  return this->key_index( key ) < m_slots.slot_count( ) && this->key_generation( key ) == this->key_generation( m_slots.slot( key_index( key ) ) );
  
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr void slot_map<T, Token, Container>::grow( ) {
-  auto new_capacity{ capacity( ) * growth_rate };
-  if( capacity( ) == 0 ) new_capacity = initial_alloc_size;
-  if( new_capacity < capacity( ) ) { // overflow case
-    new_capacity = std::numeric_limits<size_type>::max( );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::swap_elements( size_type a, size_type b ) {
+  // Swaps two elements and their erase helper entries, then points their slots at their new positions.
+  if( a == b ) return;
+  slot_map_storage<T, Container>::swap( m_data, a, b );
+  const key_size_type slot_a{ m_slots.reverse( a ) };
+  const key_size_type slot_b{ m_slots.reverse( b ) };
+  m_slots.reverse( a ) = slot_b;
+  m_slots.reverse( b ) = slot_a;
+  this->key_index( m_slots.slot( slot_b ) ) = static_cast<key_size_type>( a );
+  this->key_index( m_slots.slot( slot_a ) ) = static_cast<key_size_type>( b );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename Compare>
+std::vector<typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type>
+slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::sorted_order( Compare comp ) const {
+  // The positions of the elements, ordered by comp applied to the elements.
+  std::vector<size_type> order( this->size( ) );
+  std::iota( order.begin( ), order.end( ), size_type{ 0 } );
+  std::sort( order.begin( ), order.end( ), [&]( size_type a, size_type b ) {
+    return comp( *( std::cbegin( m_data ) + a ), *( std::cbegin( m_data ) + b ) );
+  } );
+  return order;
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+template<typename C>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::size_type slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::next_capacity( size_type current ) {
+  // The capacity Growth picks for a container of type C, limited to what key_size_type can index.
+  // Returns current when the container can't grow any further.
+  std::size_t new_capacity{ Growth::template next_capacity<C>( static_cast<std::size_t>( current ) ) };
+  if( new_capacity > Growth::max_capacity ) new_capacity = Growth::max_capacity;
+  if( new_capacity > static_cast<std::size_t>( std::numeric_limits<size_type>::max( ) ) ) { // overflow case
+    new_capacity = static_cast<std::size_t>( std::numeric_limits<size_type>::max( ) );
   }
+  return new_capacity < current ? current : static_cast<size_type>( new_capacity );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::grow( ) {
+  const size_type new_capacity{ next_capacity<container_type>( capacity( ) ) };
+  if( new_capacity == capacity( ) ) throw std::length_error( "slot_map has reached the max capacity of its growth policy." );
   grow_slots( );
+  const size_type old_capacity{ capacity( ) };
   m_data.reserve( new_capacity );
-  m_erase_helper.reserve( new_capacity );
+  m_slots.reserve_reverse( new_capacity );
+  if( capacity( ) != old_capacity ) this->count_grow( this->size( ) * slot_map_relocated_bytes<container_type>::value );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr void slot_map<T, Token, Container>::grow_slots( ) {
-  // @@TODO: make this function correctly interact with free list // possibly done - now adds the tail correctly
-  // @@TODO: insert new slots at the front of the free list
-  size_type initial_size{ static_cast<size_type>(m_slots.capacity()) };
-  if( initial_size ) {
-    m_slots.reserve( initial_size * growth_rate );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::grow_slots( ) {
+  // Creates slots up to the reserved capacity of the slot table, growing it first if it is already full.
+  // The new slots are appended to the end of the free list.
+  size_type initial_size{ static_cast<size_type>( m_slots.slot_count( ) ) };
+  const bool was_empty{ this->free_list_empty( ) };
+  if( m_slots.slot_capacity( ) == initial_size ) {
+    const size_type new_capacity{ next_capacity<typename decltype( m_slots )::slot_container>( initial_size ) };
+    if( new_capacity == initial_size ) {
+      if( !was_empty ) return; // the slot table is as large as Growth allows, but free slots remain
+      throw std::length_error( "slot_map has reached the max capacity of its growth policy." );
+    }
+    m_slots.reserve_slots( new_capacity );
+    this->count_slot_grow( initial_size * slot_map_relocated_bytes<typename decltype( m_slots )::slot_container>::value );
+  }
+  size_type capacity{ static_cast< size_type >( m_slots.slot_capacity( ) ) };
+  for( size_type i{ initial_size }; i < capacity; ++i ) {
+    m_slots.append_slot( key_type{ static_cast<key_size_type>( i + 1 ), m_generation_floor } );
+  }
+  this->key_index( m_slots.slot( m_slots.slot_count( ) - 1 ) ) = static_cast< key_size_type >( m_slots.slot_count( ) - 1 );
+  if( was_empty ) {
+    m_free_head = static_cast<key_size_type>( initial_size );
   }
   else {
-    m_slots.reserve( initial_alloc_size );
+    this->key_index( m_slots.slot( m_free_tail ) ) = static_cast<key_size_type>( initial_size );
   }
-  size_type capacity{ static_cast< size_type >( m_slots.capacity( ) ) };
-  for( size_type i{ initial_size }; i < capacity; ++i ) {
-    m_slots.emplace( std::end( m_slots ), i + 1, 0 );
+  m_free_tail = this->key_index( m_slots.slot( m_slots.slot_count( ) - 1 ) );
+}
+
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::pre_insert( ) {
+  if constexpr( fixed_capacity ) {
+    if( this->size( ) == this->capacity( ) ) throw std::length_error( "slot_map has reached the fixed capacity of its containers." );
   }
-  this->key_index( m_slots.back( ) ) = static_cast< key_size_type >( m_slots.size( ) - 1 );
-  m_free_head = initial_size;
-  m_free_tail = this->key_index( m_slots.back( ) );
+  else if( this->size( ) == this->capacity( ) ) this->grow( );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr void slot_map<T, Token, Container>::pre_insert( ) {
-  if( this->size( ) == this->capacity( ) ) this->grow( );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr void slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::pre_insert( size_type count ) {
+  // Makes room for count more elements in all three containers, so the insertions which follow never reallocate.
+  if( count > Growth::max_capacity - this->size( ) || count > std::numeric_limits<size_type>::max( ) - this->size( ) ) {
+    throw std::length_error( "slot_map has reached the max capacity of its growth policy." );
+  }
+  const size_type required{ static_cast<size_type>( this->size( ) + count ) };
+  if( required > this->capacity( ) ) {
+    size_type new_capacity{ next_capacity<container_type>( this->capacity( ) ) };
+    if( new_capacity < required ) new_capacity = required;
+    m_data.reserve( new_capacity );
+    m_slots.reserve_reverse( new_capacity );
+  }
+  const size_type free_slots{ static_cast<size_type>( m_slots.slot_count( ) - this->size( ) ) };
+  if( free_slots < count ) {
+    m_slots.reserve_slots( m_slots.slot_count( ) + ( count - free_slots ) );
+    this->grow_slots( );
+  }
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr typename slot_map<T, Token, Container>::key_size_type& slot_map<T, Token, Container>::key_index( key_type &key ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_size_type& slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_index( key_type &key ) {
   return std::get<0>( key );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr const typename slot_map<T, Token, Container>::key_size_type & slot_map<T, Token, Container>::key_index( const key_type &key ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr const typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_size_type & slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_index( const key_type &key ) const {
   return std::get<0>( key );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr typename slot_map<T, Token, Container>::key_generation_type & slot_map<T, Token, Container>::key_generation( key_type &key ) {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_generation_type & slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_generation( key_type &key ) {
   return std::get<1>( key );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr const typename slot_map<T, Token, Container>::key_generation_type & slot_map<T, Token, Container>::key_generation( const key_type &key ) const {
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr const typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_generation_type & slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_generation( const key_type &key ) const {
   return std::get<1>( key );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr typename slot_map<T, Token, Container>::key_size_type & slot_map<T, Token, Container>::element_index( key_type &key ) {
-  return this->key_index( std::begin( m_slot ) + this->key_index( key ) );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_size_type & slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::element_index( key_type &key ) {
+  return this->key_index( m_slots.slot( this->key_index( key ) ) );
 }
 
-template<typename T, typename Token, template<typename...>typename Container>
-constexpr const typename slot_map<T, Token, Container>::key_size_type & slot_map<T, Token, Container>::element_index( const key_type &key ) const {
-  return this->key_index( *(std::begin( m_slots ) + this->key_index( key ) ) );
+template<typename T, typename Token, template<typename...> typename Container, typename Layout, typename Growth, typename Stats, typename Deferred>
+constexpr const typename slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::key_size_type & slot_map<T, Token, Container, Layout, Growth, Stats, Deferred>::element_index( const key_type &key ) const {
+  return this->key_index( m_slots.slot( this->key_index( key ) ) );
 }
 
 
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <array>
+#include <iterator> // begin
+#include <tuple> // tuple, get
+#include <type_traits> // conjunction, is_same, remove_const
+#include <utility> // index_sequence
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward64
+#endif
+#include "slot_map.hpp"
+
+// Joined iteration over slot_maps sharing a key space, for queries such as "every entity with a transform and a
+// velocity": for_each( fn ) calls fn( key, elements... ) for every key valid in all of the maps, with the element of
+// each map in the order the maps were given.
+// Keys are compared as they are, so a key must name the same thing in every map it is valid in, as for maps mirrored
+// by inserting and erasing the same entities in the same order.
+// The smallest map drives the loop: its keys are rebuilt from the erase helper with key_at( ), 64 positions at a
+// time, and the generations of a batch are checked against every other map with one validate( ) per map. A key the
+// other map never issued can still match the generation of one of its free slots, so each key which validates is
+// also checked to own its slot: the slot must point at an element whose key_at( ) is the key. Matching keys are then
+// visited with find_unchecked( ), so the loop calling fn has no per key branch on the other maps.
+// The maps must not be modified by fn. Elements of const maps are passed as const references.
+template<typename... Maps>
+class slot_map_join {
+  static_assert( sizeof...( Maps ) > 0, "A slot_map_join needs at least one map." );
+  using first_map = std::remove_const_t<std::tuple_element_t<0, std::tuple<Maps...>>>;
+  static_assert( std::conjunction_v<std::is_same<typename first_map::key_type, typename std::remove_const_t<Maps>::key_type>...>,
+                 "The maps of a slot_map_join must share a key type." );
+public:
+  using key_type = typename first_map::key_type;
+
+  explicit slot_map_join( Maps&... maps ) : m_maps( maps... ) { }
+
+  template<typename Function>
+  void for_each( Function fn ) const;           // O(N) in the size of the smallest map
+  std::size_t count( ) const;                   // O(N) in the size of the smallest map, keys valid in every map
+
+private:
+  static constexpr std::size_t batch_size{ 64 };
+
+  template<std::size_t Driver, typename Function, std::size_t... I>
+  void drive( Function &fn, std::index_sequence<I...> ) const;
+  template<typename Function, std::size_t... I>
+  void dispatch( Function &fn, std::index_sequence<I...> ) const;
+  static unsigned lowest_set_bit( std::uint64_t word );
+
+  std::tuple<Maps&...> m_maps;
+};
+
+// Makes a slot_map_join of maps: join_slot_maps( transforms, velocities ).for_each( fn ).
+template<typename... Maps>
+slot_map_join<Maps...> join_slot_maps( Maps&... maps ) {
+  return slot_map_join<Maps...>( maps... );
+}
+
+#pragma region join_impl
+
+template<typename... Maps>
+template<typename Function>
+void slot_map_join<Maps...>::for_each( Function fn ) const {
+  this->dispatch( fn, std::index_sequence_for<Maps...>{ } );
+}
+
+template<typename... Maps>
+std::size_t slot_map_join<Maps...>::count( ) const {
+  std::size_t matches{ 0 };
+  this->for_each( [&matches]( const key_type &, auto&&... ) { ++matches; } );
+  return matches;
+}
+
+template<typename... Maps>
+template<typename Function, std::size_t... I>
+void slot_map_join<Maps...>::dispatch( Function &fn, std::index_sequence<I...> sequence ) const {
+  // Picks the smallest map at run time, then runs the loop instantiated for it.
+  const std::array<std::size_t, sizeof...( Maps )> sizes{ { static_cast<std::size_t>( std::get<I>( m_maps ).size( ) )... } };
+  std::size_t driver{ 0 };
+  for( std::size_t i{ 1 }; i < sizes.size( ); ++i ) {
+    if( sizes[ i ] < sizes[ driver ] ) driver = i;
+  }
+  ( ( driver == I ? this->template drive<I>( fn, sequence ) : void( ) ), ... );
+}
+
+template<typename... Maps>
+template<std::size_t Driver, typename Function, std::size_t... I>
+void slot_map_join<Maps...>::drive( Function &fn, std::index_sequence<I...> ) const {
+  auto &driver{ std::get<Driver>( m_maps ) };
+  using size_type = typename first_map::size_type;
+  const std::size_t element_count{ static_cast<std::size_t>( driver.size( ) ) };
+  std::array<key_type, batch_size> keys;
+  for( std::size_t base{ 0 }; base < element_count; base += batch_size ) {
+    const std::size_t count{ element_count - base < batch_size ? element_count - base : batch_size };
+    for( std::size_t i{ 0 }; i < count; ++i ) {
+      keys[ i ] = driver.key_at( static_cast<size_type>( base + i ) );
+    }
+    std::uint64_t matches{ count == batch_size ? ~std::uint64_t{ 0 } : ( std::uint64_t{ 1 } << count ) - 1 };
+    const auto check = [&]( auto &map ) {
+      std::uint64_t valid;
+      map.validate( keys.data( ), static_cast<size_type>( count ), &valid );
+      for( std::uint64_t candidates{ valid & matches }; candidates; candidates &= candidates - 1 ) {
+        const unsigned i{ lowest_set_bit( candidates ) };
+        const size_type position{ map.position_unchecked( keys[ i ] ) };
+        if( position >= map.size( ) || !( map.key_at( position ) == keys[ i ] ) ) valid &= ~( std::uint64_t{ 1 } << i );
+      }
+      matches &= valid;
+    };
+    ( ( I != Driver ? check( std::get<I>( m_maps ) ) : void( ) ), ... );
+    for( ; matches; matches &= matches - 1 ) {
+      const unsigned i{ lowest_set_bit( matches ) };
+      const auto element = [&]( auto index, auto &map ) -> decltype( auto ) {
+        if constexpr( decltype( index )::value == Driver ) return *( std::begin( map ) + ( base + i ) );
+        else return map.find_unchecked( keys[ i ] );
+      };
+      fn( keys[ i ], element( std::integral_constant<std::size_t, I>{ }, std::get<I>( m_maps ) )... );
+    }
+  }
+}
+
+template<typename... Maps>
+unsigned slot_map_join<Maps...>::lowest_set_bit( std::uint64_t word ) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64( &index, word );
+  return static_cast<unsigned>( index );
+#else
+  return static_cast<unsigned>( __builtin_ctzll( word ) );
+#endif
+}
+
+#pragma endregion
@@ -0,0 +1,461 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+#pragma once
+#include <cstdint> // uint16_t, uint64_t
+#include <memory> // unique_ptr
+#include <memory_resource> // memory_resource
+#include <new> // bad_alloc
+#include <vector> // vector
+#include <algorithm> // upper_bound, lower_bound
+#include <functional> // less
+#include <utility> // forward, pair
+#include "slot_array.hpp"
+#include "../Debugging/Asserts.hpp"
+namespace ADL
+{
+  /*
+  * @brief: slot_pool is a growable pool of objects built from slot_array blocks of _Block_Elements objects each.
+  * Blocks are added when every block is full and returned to the memory resource once they empty out, so memory
+  * tracks the number of live objects instead of a worst case capacity per type.
+  * slot_pool makes the following promises:
+  *   - Performance
+  *     -# O(1) alloc and free, plus one block allocation when every block is full
+  *     -# O(1) access via 64 bit weak reference IDs: one lookup in the block table, then the slot_array lookup
+  *     -# contiguous memory within each block
+  *   - Convenience
+  *     -# stable indices for the in place and split layouts, as for slot_array
+  *     -# IDs stay valid until their object is freed, and are rejected once their block is released, even after the
+  *        block is replaced by a new one
+  *
+  * @param T The value type being stored in the pool.
+  * @param _Block_Elements The number of objects each block holds. Defaults to 1024, at most 64k - 2.
+  * @param _Layout The slot_layout of the blocks. Defaults to slot_layout::in_place.
+  * @param _Stats The instrumentation policy of the blocks. Defaults to slot_stats::none.
+  *
+  * @note: An ID holds the generation of its block's table entry in its top 16 bits, the index of the block in the next\n
+  *        16 bits and the slot_key_32 ID of the object within its block in the low 32 bits. The pool holds at most\n
+  *        64k blocks, and a block table entry reused 64k times accepts IDs from its first block again.
+  * @note: Allocations fill the most recently opened block which has room, so recently freed slots are reused first.
+  * @note: High-water policy: up to retained_blocks() empty blocks are kept, 1 by default, so an object count
+  *        hovering around a block boundary doesn't release and allocate a block on every alloc and free.\n
+  *        Emptying any further block releases it. Call trim() to release every empty block.
+  * @note: get_ID(T&) and free(T&) find the block of an object with a binary search of the block addresses, which is\n
+  *        O(log(blocks)). Prefer IDs on hot paths.
+  * @note: The blocks allocate from a std::pmr::memory_resource, the default resource unless one is passed to the\n
+  *        constructor. The resource must outlive the slot_pool.
+  */
+  template<typename T, unsigned _Block_Elements = 1024u, typename _Layout = slot_layout::in_place, typename _Stats = slot_stats::none>
+  class slot_pool
+  {
+  public:
+    using block_type = slot_array<T, _Block_Elements, true, _Layout, slot_key_32, _Stats>;
+    using value_type = T;
+    using id_type = uint64_t;
+    static const unsigned block_id_bits = 16u;
+    static const unsigned max_blocks = 1u << block_id_bits;
+
+    slot_pool(); // allocates blocks from std::pmr::get_default_resource()
+    explicit slot_pool(std::pmr::memory_resource *resource); // allocates blocks from resource
+    slot_pool(const slot_pool &) = delete;
+    slot_pool& operator=(const slot_pool &) = delete;
+    ~slot_pool() = default;
+    void clear(); // destructs every object and releases every block
+
+    template<typename... Args>
+    T& alloc(Args&&... args); // creates an element and returns a reference to it, adding a block if every block is full.
+
+    void free(T&);             // releases the object, and its block if the block empties out past the retained blocks.
+    void free(id_type ID);     // releases the object referenced by a valid ID.
+    id_type get_ID(T&)   const; // retreive the ID of the referenced element.
+    T& get(id_type ID)   const; // returns the item referenced by ID
+    T* get_safely(id_type ID) const; // validates the ID before attempting to return the elemnt. nullptr if invalid.
+
+    template<typename Function>
+    void for_each(Function f) const; // calls f(T&) for every live object, block by block
+
+    inline unsigned size()            const noexcept { return m_size; }
+    inline bool empty()               const noexcept { return m_size == 0u; }
+    inline unsigned block_count()     const noexcept { return m_block_count; }
+    inline unsigned empty_blocks()    const noexcept { return m_empty_blocks; }
+    inline size_t capacity()          const noexcept { return size_t{ m_block_count } * _Block_Elements; }
+    inline unsigned retained_blocks() const noexcept { return m_retained_blocks; }
+    void set_retained_blocks(unsigned count); // releases empty blocks past count
+    void trim();                              // releases every empty block
+    inline std::pmr::memory_resource* get_memory_resource() const noexcept { return m_resource; }
+
+  private:
+    static const unsigned no_position = ~0u;
+    static const unsigned inner_bits = 32u;
+
+    struct block_record
+    {
+      std::unique_ptr<block_type> array; // nullptr while the table entry is free
+      uint16_t generation;               // incremented every time the block of the entry is released
+      unsigned open_position;            // position in m_open_blocks, no_position while full or released
+    };
+
+    static id_type make_ID(uint16_t generation, unsigned block, typename block_type::id_type inner) noexcept;
+    static unsigned block_of(id_type ID) noexcept;
+    static uint16_t generation_of(id_type ID) noexcept;
+    static typename block_type::id_type inner_of(id_type ID) noexcept;
+
+    unsigned find_block(const T &object) const;
+    unsigned open_block();
+    void release_block(unsigned block);
+    void push_open(unsigned block);
+    void remove_open(unsigned block);
+    void after_free(unsigned block, unsigned previous_size);
+
+    std::pmr::memory_resource *m_resource;
+    std::vector<block_record> m_blocks;
+    std::vector<unsigned> m_open_blocks; // blocks with room, the last one is allocated from
+    std::vector<unsigned> m_free_entries; // table entries without a block, reused before the table grows
+    // The live blocks ordered by the address of their object storage, for find_block().
+    std::vector<std::pair<const T *, unsigned>> m_by_address;
+    unsigned m_size; // current active items
+    unsigned m_block_count; // live blocks
+    unsigned m_empty_blocks; // live blocks without objects
+    unsigned m_retained_blocks; // empty blocks kept rather than released
+  };
+
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  slot_pool<T, _Block_Elements, _Layout, _Stats>::slot_pool()
+    : slot_pool(std::pmr::get_default_resource())
+  {
+  }
+
+  /*
+  * @brief Creates an empty pool. No block is allocated until the first alloc().
+  * @param resource The memory resource the storage of the blocks is allocated from, and returned to when they are released.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  slot_pool<T, _Block_Elements, _Layout, _Stats>::slot_pool(std::pmr::memory_resource *resource)
+    : m_resource(resource)
+    , m_size(0)
+    , m_block_count(0)
+    , m_empty_blocks(0)
+    , m_retained_blocks(1)
+  {
+  }
+
+  /*
+  * @brief Destructs every object and releases every block. IDs of the objects are rejected afterwards.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::clear()
+  {
+    for (unsigned block{ 0u }; block < m_blocks.size(); ++block)
+    {
+      if (m_blocks[block].array)
+      {
+        m_blocks[block].array->clear();
+        release_block(block);
+      }
+    }
+    m_size = 0u;
+    m_empty_blocks = 0u;
+  }
+
+  /*
+  * @brief Allocates an object in the most recently opened block with room, adding a block if every block is full.
+  * @param args Any arguments passed to the function will be forwarded to the constructor of the value_type.
+  * @return A reference to the allocated object.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  template<typename... Args>
+  T& slot_pool<T, _Block_Elements, _Layout, _Stats>::alloc(Args&&... args)
+  {
+    const unsigned block{ m_open_blocks.empty() ? open_block() : m_open_blocks.back() };
+    block_type &array{ *m_blocks[block].array };
+    T& object{ array.alloc(std::forward<Args>(args)...) };
+    if (array.size() == 1u)
+    {
+      --m_empty_blocks;
+    }
+    if (array.size() == _Block_Elements)
+    {
+      remove_open(block);
+    }
+    ++m_size;
+    return object;
+  }
+
+  /*
+  * @brief Destructs an object and makes its slot available for new objects.
+  * @param object The object to be freed.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::free(T& object)
+  {
+    const unsigned block{ find_block(object) };
+    block_type &array{ *m_blocks[block].array };
+    const unsigned previous_size{ array.size() };
+    array.free(object);
+    after_free(block, previous_size);
+  }
+
+  /*
+  * @brief Destructs the object referenced by an ID and makes its slot available for new objects.
+  * @param ID An identifier known to be good that references an object in the pool.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::free(id_type ID)
+  {
+    const unsigned block{ block_of(ID) };
+    ADL_ASSERT_MSG(block < m_blocks.size() && m_blocks[block].array && m_blocks[block].generation == generation_of(ID),
+                   "Invalid ID: the block of the ID was released.");
+    block_type &array{ *m_blocks[block].array };
+    const unsigned previous_size{ array.size() };
+    array.free(array.get(inner_of(ID)));
+    after_free(block, previous_size);
+  }
+
+  /*
+  * @brief Creates an ID for an object which can be used to safely retrieve the object later.
+  * @param object The object to create an ID for.
+  * @return An ID which references the object.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  typename slot_pool<T, _Block_Elements, _Layout, _Stats>::id_type slot_pool<T, _Block_Elements, _Layout, _Stats>::get_ID(T& object) const
+  {
+    const unsigned block{ find_block(object) };
+    const block_record &record{ m_blocks[block] };
+    return make_ID(record.generation, block, record.array->get_ID(object));
+  }
+
+  /*
+  * @brief Retrieves the object referenced by a valid ID.
+  * @param ID An identifier known to be good that references an object in the pool.
+  * @return A reference to the object.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  T& slot_pool<T, _Block_Elements, _Layout, _Stats>::get(id_type ID) const
+  {
+    const unsigned block{ block_of(ID) };
+    ADL_ASSERT_MSG(block < m_blocks.size() && m_blocks[block].array && m_blocks[block].generation == generation_of(ID),
+                   "Invalid ID: the block of the ID was released.");
+    return m_blocks[block].array->get(inner_of(ID));
+  }
+
+  /*
+  * @brief Retrieves the object referenced by an ID, if the ID is still valid.
+  * @param ID Any identifier produced by this pool.
+  * @return A pointer to the object, or nullptr if the object or its block was released.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  T* slot_pool<T, _Block_Elements, _Layout, _Stats>::get_safely(id_type ID) const
+  {
+    const unsigned block{ block_of(ID) };
+    if (block >= m_blocks.size())
+    {
+      return nullptr;
+    }
+    const block_record &record{ m_blocks[block] };
+    if (!record.array || record.generation != generation_of(ID))
+    {
+      return nullptr;
+    }
+    return record.array->get_safely(inner_of(ID));
+  }
+
+  /*
+  * @brief Visits every live object.
+  * @param f Called with a T& for every live object. It must not alloc or free objects of the pool.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  template<typename Function>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::for_each(Function f) const
+  {
+    for (const block_record &record : m_blocks)
+    {
+      if (record.array)
+      {
+        for (T& object : *record.array)
+        {
+          f(object);
+        }
+      }
+    }
+  }
+
+  /*
+  * @brief Sets how many empty blocks are kept for reuse, and releases the empty blocks past that count.
+  * @param count The number of empty blocks to keep.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::set_retained_blocks(unsigned count)
+  {
+    m_retained_blocks = count;
+    for (unsigned block{ 0u }; block < m_blocks.size() && m_empty_blocks > m_retained_blocks; ++block)
+    {
+      if (m_blocks[block].array && m_blocks[block].array->empty())
+      {
+        release_block(block);
+        --m_empty_blocks;
+      }
+    }
+  }
+
+  /*
+  * @brief Releases every empty block, returning its storage to the memory resource.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::trim()
+  {
+    const unsigned retained{ m_retained_blocks };
+    set_retained_blocks(0u);
+    m_retained_blocks = retained;
+  }
+
+  /*
+  * @brief Packs the fields of an ID.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  typename slot_pool<T, _Block_Elements, _Layout, _Stats>::id_type slot_pool<T, _Block_Elements, _Layout, _Stats>::make_ID(uint16_t generation, unsigned block, typename block_type::id_type inner) noexcept
+  {
+    return ( id_type{ generation } << ( inner_bits + block_id_bits ) ) | ( id_type{ block } << inner_bits ) | id_type{ inner };
+  }
+
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  unsigned slot_pool<T, _Block_Elements, _Layout, _Stats>::block_of(id_type ID) noexcept
+  {
+    return static_cast<unsigned>( ( ID >> inner_bits ) & ( max_blocks - 1u ) );
+  }
+
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  uint16_t slot_pool<T, _Block_Elements, _Layout, _Stats>::generation_of(id_type ID) noexcept
+  {
+    return static_cast<uint16_t>( ID >> ( inner_bits + block_id_bits ) );
+  }
+
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  typename slot_pool<T, _Block_Elements, _Layout, _Stats>::block_type::id_type slot_pool<T, _Block_Elements, _Layout, _Stats>::inner_of(id_type ID) noexcept
+  {
+    return static_cast<typename block_type::id_type>( ID );
+  }
+
+  /*
+  * @brief Finds the block storing an object from the address ranges of the blocks.
+  * @param object A live object in the pool.
+  * @return The index of the block in the block table.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  unsigned slot_pool<T, _Block_Elements, _Layout, _Stats>::find_block(const T &object) const
+  {
+    const T *address{ &object };
+    // The last block starting at or before the object.
+    auto it{ std::upper_bound(m_by_address.begin(), m_by_address.end(), address,
+                              [](const T *a, const std::pair<const T *, unsigned> &b) { return std::less<const T *>()(a, b.first); }) };
+    ADL_ASSERT_MSG(it != m_by_address.begin(), "Tried to find an object which isn't in the pool.");
+    --it;
+    ADL_ASSERT_MSG(!std::less<const T *>()(m_blocks[it->second].array->as_value_type(_Block_Elements - 1u), address),
+                   "Tried to find an object which isn't in the pool.");
+    return it->second;
+  }
+
+  /*
+  * @brief Adds a block, reusing a free table entry if there is one.
+  * @return The index of the new block in the block table. The block is open.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  unsigned slot_pool<T, _Block_Elements, _Layout, _Stats>::open_block()
+  {
+    unsigned block;
+    if (!m_free_entries.empty())
+    {
+      block = m_free_entries.back();
+      m_free_entries.pop_back();
+    }
+    else
+    {
+      if (m_blocks.size() == max_blocks)
+      {
+        throw std::bad_alloc();
+      }
+      block = static_cast<unsigned>(m_blocks.size());
+      m_blocks.push_back(block_record{ nullptr, 0u, no_position });
+    }
+    block_record &record{ m_blocks[block] };
+    record.array = std::make_unique<block_type>(m_resource);
+    const std::pair<const T *, unsigned> entry{ record.array->as_value_type(0u), block };
+    m_by_address.insert(std::lower_bound(m_by_address.begin(), m_by_address.end(), entry,
+                                         [](const std::pair<const T *, unsigned> &a, const std::pair<const T *, unsigned> &b) { return std::less<const T *>()(a.first, b.first); }),
+                        entry);
+    push_open(block);
+    ++m_block_count;
+    ++m_empty_blocks;
+    return block;
+  }
+
+  /*
+  * @brief Destroys a block, returning its storage to the memory resource. IDs of the block are rejected afterwards.
+  * @detail Does not update m_empty_blocks so callers can account for the released block themselves.
+  * @param block The index of a live block in the block table.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::release_block(unsigned block)
+  {
+    block_record &record{ m_blocks[block] };
+    if (record.open_position != no_position)
+    {
+      remove_open(block);
+    }
+    const T *address{ record.array->as_value_type(0u) };
+    m_by_address.erase(std::lower_bound(m_by_address.begin(), m_by_address.end(), address,
+                                        [](const std::pair<const T *, unsigned> &a, const T *b) { return std::less<const T *>()(a.first, b); }));
+    record.array.reset();
+    ++record.generation;
+    m_free_entries.push_back(block);
+    --m_block_count;
+  }
+
+  /*
+  * @brief Makes a block the first choice of alloc().
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::push_open(unsigned block)
+  {
+    m_blocks[block].open_position = static_cast<unsigned>(m_open_blocks.size());
+    m_open_blocks.push_back(block);
+  }
+
+  /*
+  * @brief Removes a block from the open blocks, moving the last open block into its position.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::remove_open(unsigned block)
+  {
+    const unsigned position{ m_blocks[block].open_position };
+    const unsigned last{ m_open_blocks.back() };
+    m_open_blocks[position] = last;
+    m_blocks[last].open_position = position;
+    m_open_blocks.pop_back();
+    m_blocks[block].open_position = no_position;
+  }
+
+  /*
+  * @brief Reopens a block which was full, and applies the high-water policy to a block which emptied out.
+  * @param block The block an object was freed from.
+  * @param previous_size The number of objects in the block before the free.
+  */
+  template<typename T, unsigned _Block_Elements, typename _Layout, typename _Stats>
+  void slot_pool<T, _Block_Elements, _Layout, _Stats>::after_free(unsigned block, unsigned previous_size)
+  {
+    --m_size;
+    if (previous_size == _Block_Elements)
+    {
+      push_open(block);
+    }
+    if (previous_size == 1u)
+    {
+      if (m_empty_blocks == m_retained_blocks)
+      {
+        release_block(block);
+      }
+      else
+      {
+        ++m_empty_blocks;
+      }
+    }
+  }
+}
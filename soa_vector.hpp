@@ -0,0 +1,252 @@
+#pragma once
+#include <tuple>
+#include <cstddef> // size_t, ptrdiff_t
+#include <iterator> // random_access_iterator_tag, reverse_iterator
+#include <utility> // index_sequence, forward, move
+#include <type_traits> // common_type, decay, enable_if
+#include <vector>
+#include "relocate.hpp"
+
+// Tag type: slot_map<soa<Ts...>> stores every component in its own dense column instead of storing whole tuples.
+template<typename... Ts>
+struct soa {
+  static_assert( sizeof...( Ts ) > 0, "A soa type must have at least one component." );
+};
+
+// A contiguous view of one column of a soa_vector. Invalidated by any operation which inserts or erases elements.
+template<typename T>
+class column_span {
+public:
+  using element_type = T;
+  using size_type = std::size_t;
+  using iterator = T*;
+
+  constexpr column_span( ) = default;
+  constexpr column_span( T *data, size_type size ) : m_data( data ), m_size( size ) { }
+
+  constexpr T* data( ) const { return m_data; }
+  constexpr size_type size( ) const { return m_size; }
+  constexpr bool empty( ) const { return m_size == 0; }
+  constexpr iterator begin( ) const { return m_data; }
+  constexpr iterator end( ) const { return m_data + m_size; }
+  constexpr T& operator[]( size_type index ) const { return m_data[ index ]; }
+
+private:
+  T *m_data{ nullptr };
+  size_type m_size{ 0 };
+};
+
+// Proxy reference to one element of a soa_vector: a tuple of references, one into each column.
+// Assigning to a proxy assigns through to the referenced components, it never rebinds the proxy.
+// Components are read with get<I>( ), and proxies support structured bindings.
+template<typename... Refs>
+class soa_reference {
+  template<typename...> friend class soa_reference;
+public:
+  using value_type = std::tuple<std::decay_t<Refs>...>;
+
+  constexpr soa_reference( Refs... refs ) : m_refs( refs... ) { }
+  constexpr soa_reference( const soa_reference & ) = default;
+  // allows a reference to be converted to a const reference
+  template<typename... Others, typename = std::enable_if_t<std::is_constructible_v<std::tuple<Refs...>, const std::tuple<Others...>&>>>
+  constexpr soa_reference( const soa_reference<Others...> &other ) : m_refs( other.m_refs ) { }
+  // allows a value to be passed where a const reference is expected, such as slot_map::insert( const_reference )
+  template<typename Value = value_type, typename = std::enable_if_t<std::is_constructible_v<std::tuple<Refs...>, const Value&>>>
+  constexpr soa_reference( const value_type &value ) : m_refs( value ) { }
+
+  constexpr soa_reference& operator=( const soa_reference &rhs ) { m_refs = rhs.m_refs; return *this; }
+  template<typename... Others>
+  constexpr soa_reference& operator=( const soa_reference<Others...> &rhs ) { m_refs = rhs.m_refs; return *this; }
+  constexpr soa_reference& operator=( const value_type &rhs ) { m_refs = rhs; return *this; }
+  constexpr soa_reference& operator=( value_type &&rhs ) { m_refs = std::move( rhs ); return *this; }
+
+  constexpr operator value_type( ) const { return value_type( m_refs ); }
+
+  template<std::size_t I>
+  constexpr std::tuple_element_t<I, std::tuple<Refs...>> get( ) const { return std::get<I>( m_refs ); }
+
+  friend constexpr bool operator==( const soa_reference &lhs, const soa_reference &rhs ) { return lhs.m_refs == rhs.m_refs; }
+  friend constexpr bool operator!=( const soa_reference &lhs, const soa_reference &rhs ) { return !( lhs == rhs ); }
+  friend constexpr bool operator==( const soa_reference &lhs, const value_type &rhs ) { return lhs.m_refs == rhs; }
+  friend constexpr bool operator!=( const soa_reference &lhs, const value_type &rhs ) { return !( lhs == rhs ); }
+
+private:
+  std::tuple<Refs...> m_refs;
+};
+
+namespace std {
+template<typename... Refs>
+struct tuple_size<soa_reference<Refs...>> : std::integral_constant<std::size_t, sizeof...( Refs )> { };
+template<std::size_t I, typename... Refs>
+struct tuple_element<I, soa_reference<Refs...>> { using type = std::tuple_element_t<I, std::tuple<Refs...>>; };
+}
+
+// A sequence container storing std::tuple<Ts...> elements as one Container<T> per component.
+// Provides the subset of the vector interface slot_map uses, with proxy references and random access iterators.
+// When an insertion throws part way through the columns, the columns which already grew are not rolled back.
+template<template<typename...> typename Container, typename... Ts>
+class soa_vector {
+  template<bool _Const>
+  class basic_iterator;
+public:
+  using value_type = std::tuple<Ts...>;
+  using reference = soa_reference<Ts&...>;
+  using const_reference = soa_reference<const Ts&...>;
+  using pointer = void;
+  using const_pointer = void;
+  using size_type = std::common_type_t<typename Container<Ts>::size_type...>;
+  using difference_type = std::ptrdiff_t;
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  template<std::size_t I>
+  using column_value_type = std::tuple_element_t<I, value_type>;
+
+  constexpr soa_vector( ) = default;
+  // Constructs every column from allocator, converted to the allocator type of the column.
+  template<typename Allocator, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Allocator>, soa_vector>>>
+  constexpr explicit soa_vector( const Allocator &allocator ) : m_columns( Container<Ts>( allocator )... ) { }
+
+  // Iterators
+  constexpr iterator begin( ) { return iterator( this, 0 ); }
+  constexpr iterator end( ) { return iterator( this, static_cast<difference_type>( this->size( ) ) ); }
+  constexpr const_iterator begin( ) const { return const_iterator( this, 0 ); }
+  constexpr const_iterator end( ) const { return const_iterator( this, static_cast<difference_type>( this->size( ) ) ); }
+  constexpr const_iterator cbegin( ) const { return this->begin( ); }
+  constexpr const_iterator cend( ) const { return this->end( ); }
+  constexpr reverse_iterator rbegin( ) { return reverse_iterator( this->end( ) ); }
+  constexpr reverse_iterator rend( ) { return reverse_iterator( this->begin( ) ); }
+  constexpr const_reverse_iterator rbegin( ) const { return const_reverse_iterator( this->end( ) ); }
+  constexpr const_reverse_iterator rend( ) const { return const_reverse_iterator( this->begin( ) ); }
+  constexpr const_reverse_iterator crbegin( ) const { return this->rbegin( ); }
+  constexpr const_reverse_iterator crend( ) const { return this->rend( ); }
+
+  // Capacity
+  constexpr bool empty( ) const { return std::get<0>( m_columns ).empty( ); }
+  constexpr size_type size( ) const { return std::get<0>( m_columns ).size( ); }
+  constexpr size_type max_size( ) const { return std::get<0>( m_columns ).max_size( ); }
+  constexpr size_type capacity( ) const { return std::get<0>( m_columns ).capacity( ); }
+  constexpr void reserve( size_type n ) { std::apply( [n]( auto&... columns ) { ( columns.reserve( n ), ... ); }, m_columns ); }
+  constexpr void shrink_to_fit( ) { std::apply( []( auto&... columns ) { ( columns.shrink_to_fit( ), ... ); }, m_columns ); }
+
+  // Element access
+  constexpr reference operator[]( size_type index ) { return this->at_index( index, std::index_sequence_for<Ts...>{ } ); }
+  constexpr const_reference operator[]( size_type index ) const { return this->at_index( index, std::index_sequence_for<Ts...>{ } ); }
+  constexpr reference back( ) { return ( *this )[ this->size( ) - 1 ]; }
+  constexpr const_reference back( ) const { return ( *this )[ this->size( ) - 1 ]; }
+  // A contiguous span of the I-th component of every element, in the same order as iteration.
+  template<std::size_t I>
+  constexpr column_span<column_value_type<I>> column( ) { auto &c{ std::get<I>( m_columns ) }; return { c.data( ), c.size( ) }; }
+  template<std::size_t I>
+  constexpr column_span<const column_value_type<I>> column( ) const { auto &c{ std::get<I>( m_columns ) }; return { c.data( ), c.size( ) }; }
+
+  // Modifiers
+  constexpr void clear( ) { std::apply( []( auto&... columns ) { ( columns.clear( ), ... ); }, m_columns ); }
+  constexpr void push_back( const_reference value ) { this->push_back_copy( value, std::index_sequence_for<Ts...>{ } ); }
+  constexpr void push_back( value_type &&value ) { this->push_back_move( value, std::index_sequence_for<Ts...>{ } ); }
+  // Accepts no arguments, a whole value_type, or one constructor argument per component.
+  template<typename... Args>
+  constexpr void emplace_back( Args&&... args );
+  constexpr void pop_back( ) { std::apply( []( auto&... columns ) { ( columns.pop_back( ), ... ); }, m_columns ); }
+  constexpr iterator erase( const_iterator first, const_iterator last );
+  // Moves every component of the element at from into the element at to, see fill_hole( ) in relocate.hpp.
+  constexpr void move_element( size_type to, size_type from ) { this->move_element( to, from, std::index_sequence_for<Ts...>{ } ); }
+  // Swaps every component of the elements at a and b.
+  constexpr void swap_elements( size_type a, size_type b ) { this->swap_elements( a, b, std::index_sequence_for<Ts...>{ } ); }
+
+private:
+  std::tuple<Container<Ts>...> m_columns;
+
+  template<std::size_t... I>
+  constexpr reference at_index( size_type index, std::index_sequence<I...> ) { return reference( *( std::begin( std::get<I>( m_columns ) ) + index )... ); }
+  template<std::size_t... I>
+  constexpr const_reference at_index( size_type index, std::index_sequence<I...> ) const { return const_reference( *( std::cbegin( std::get<I>( m_columns ) ) + index )... ); }
+  template<std::size_t... I>
+  constexpr void push_back_copy( const_reference value, std::index_sequence<I...> ) { ( std::get<I>( m_columns ).push_back( value.template get<I>( ) ), ... ); }
+  template<std::size_t... I>
+  constexpr void push_back_move( value_type &value, std::index_sequence<I...> ) { ( std::get<I>( m_columns ).push_back( std::move( std::get<I>( value ) ) ), ... ); }
+  template<typename Args, std::size_t... I>
+  constexpr void emplace_back_each( Args &&args, std::index_sequence<I...> ) { ( std::get<I>( m_columns ).emplace_back( std::get<I>( std::move( args ) ) ), ... ); }
+  template<std::size_t... I>
+  constexpr void move_element( size_type to, size_type from, std::index_sequence<I...> ) {
+    ( fill_hole( *( std::begin( std::get<I>( m_columns ) ) + to ), *( std::begin( std::get<I>( m_columns ) ) + from ) ), ... );
+  }
+  template<std::size_t... I>
+  constexpr void swap_elements( size_type a, size_type b, std::index_sequence<I...> ) {
+    ( swap_values( *( std::begin( std::get<I>( m_columns ) ) + a ), *( std::begin( std::get<I>( m_columns ) ) + b ) ), ... );
+  }
+};
+
+template<template<typename...> typename Container, typename... Ts>
+template<bool _Const>
+class soa_vector<Container, Ts...>::basic_iterator {
+  friend class soa_vector<Container, Ts...>;
+  friend class basic_iterator<!_Const>;
+  using vector_type = std::conditional_t<_Const, const soa_vector, soa_vector>;
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = typename soa_vector::value_type;
+  using reference = std::conditional_t<_Const, typename soa_vector::const_reference, typename soa_vector::reference>;
+  using pointer = void;
+  using difference_type = std::ptrdiff_t;
+
+  constexpr basic_iterator( ) = default;
+  constexpr basic_iterator( const basic_iterator & ) = default;
+  // iterator converts to const_iterator
+  template<bool _Other, typename = std::enable_if_t<_Const && !_Other>>
+  constexpr basic_iterator( const basic_iterator<_Other> &other ) : m_vector( other.m_vector ), m_index( other.m_index ) { }
+  constexpr basic_iterator& operator=( const basic_iterator & ) = default;
+
+  constexpr reference operator*( ) const { return ( *m_vector )[ static_cast<size_type>( m_index ) ]; }
+  constexpr reference operator[]( difference_type n ) const { return ( *m_vector )[ static_cast<size_type>( m_index + n ) ]; }
+
+  constexpr basic_iterator& operator++( ) { ++m_index; return *this; }
+  constexpr basic_iterator operator++( int ) { basic_iterator result{ *this }; ++m_index; return result; }
+  constexpr basic_iterator& operator--( ) { --m_index; return *this; }
+  constexpr basic_iterator operator--( int ) { basic_iterator result{ *this }; --m_index; return result; }
+  constexpr basic_iterator& operator+=( difference_type n ) { m_index += n; return *this; }
+  constexpr basic_iterator& operator-=( difference_type n ) { m_index -= n; return *this; }
+  friend constexpr basic_iterator operator+( basic_iterator it, difference_type n ) { return it += n; }
+  friend constexpr basic_iterator operator+( difference_type n, basic_iterator it ) { return it += n; }
+  friend constexpr basic_iterator operator-( basic_iterator it, difference_type n ) { return it -= n; }
+  friend constexpr difference_type operator-( const basic_iterator &lhs, const basic_iterator &rhs ) { return lhs.m_index - rhs.m_index; }
+
+  friend constexpr bool operator==( const basic_iterator &lhs, const basic_iterator &rhs ) { return lhs.m_index == rhs.m_index && lhs.m_vector == rhs.m_vector; }
+  friend constexpr bool operator!=( const basic_iterator &lhs, const basic_iterator &rhs ) { return !( lhs == rhs ); }
+  friend constexpr bool operator<( const basic_iterator &lhs, const basic_iterator &rhs ) { return lhs.m_index < rhs.m_index; }
+  friend constexpr bool operator>( const basic_iterator &lhs, const basic_iterator &rhs ) { return rhs < lhs; }
+  friend constexpr bool operator<=( const basic_iterator &lhs, const basic_iterator &rhs ) { return !( rhs < lhs ); }
+  friend constexpr bool operator>=( const basic_iterator &lhs, const basic_iterator &rhs ) { return !( lhs < rhs ); }
+
+private:
+  constexpr basic_iterator( vector_type *vector, difference_type index ) : m_vector( vector ), m_index( index ) { }
+
+  vector_type *m_vector{ nullptr };
+  difference_type m_index{ 0 };
+};
+
+template<template<typename...> typename Container, typename... Ts>
+template<typename... Args>
+constexpr void soa_vector<Container, Ts...>::emplace_back( Args&&... args ) {
+  if constexpr( sizeof...( Args ) == 0 ) {
+    std::apply( []( auto&... columns ) { ( columns.emplace_back( ), ... ); }, m_columns );
+  }
+  else if constexpr( sizeof...( Args ) == 1 && ( std::is_same_v<std::decay_t<Args>, value_type> && ... ) ) {
+    this->push_back( value_type( std::forward<Args>( args )... ) );
+  }
+  else {
+    static_assert( sizeof...( Args ) == sizeof...( Ts ), "soa_vector::emplace_back takes one argument per component." );
+    this->emplace_back_each( std::forward_as_tuple( std::forward<Args>( args )... ), std::index_sequence_for<Ts...>{ } );
+  }
+}
+
+template<template<typename...> typename Container, typename... Ts>
+constexpr typename soa_vector<Container, Ts...>::iterator soa_vector<Container, Ts...>::erase( const_iterator first, const_iterator last ) {
+  const auto first_index{ first.m_index };
+  const auto last_index{ last.m_index };
+  std::apply( [first_index, last_index]( auto&... columns ) {
+    ( columns.erase( std::begin( columns ) + first_index, std::begin( columns ) + last_index ), ... );
+  }, m_columns );
+  return iterator( this, first_index );
+}
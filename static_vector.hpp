@@ -0,0 +1,175 @@
+#pragma once
+#include <cstddef> // size_t, ptrdiff_t
+#include <iterator> // reverse_iterator
+#include <utility> // forward, move
+#include <new> // placement new, launder
+#include <stdexcept> // length_error
+#include <type_traits> // aligned_storage, is_trivially_*
+
+// Whether a static_vector of T can keep its elements in a plain T[N]: every element is constructed up front and
+// assigned to, which needs no placement new or explicit destruction, so the vector is usable in constant expressions
+// and is trivially destructible.
+template<typename T>
+constexpr bool static_vector_is_literal( ) {
+  return std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T> && std::is_trivially_copy_assignable_v<T>;
+}
+
+// Element storage of a static_vector for trivial types: a value initialized T[N].
+template<typename T, std::size_t N, bool = static_vector_is_literal<T>( )>
+class static_vector_storage {
+protected:
+  constexpr T* elements( ) { return m_elements; }
+  constexpr const T* elements( ) const { return m_elements; }
+  template<typename... Args>
+  constexpr void construct( std::size_t index, Args&&... args ) { m_elements[ index ] = T( std::forward<Args>( args )... ); }
+  constexpr void destroy( std::size_t ) { }
+
+  T m_elements[ N ]{ };
+  std::size_t m_size{ 0 };
+};
+
+// Element storage of a static_vector for other types: uninitialized storage, elements are constructed in place.
+template<typename T, std::size_t N>
+class static_vector_storage<T, N, false> {
+protected:
+  static_vector_storage( ) = default;
+  static_vector_storage( const static_vector_storage &other ) { this->copy_from( other ); }
+  static_vector_storage( static_vector_storage &&other ) noexcept( std::is_nothrow_move_constructible_v<T> ) { this->move_from( other ); }
+  ~static_vector_storage( ) { this->destroy_all( ); }
+  static_vector_storage& operator=( const static_vector_storage &rhs ) {
+    if( this != &rhs ) {
+      this->destroy_all( );
+      this->copy_from( rhs );
+    }
+    return *this;
+  }
+  static_vector_storage& operator=( static_vector_storage &&rhs ) noexcept( std::is_nothrow_move_constructible_v<T> ) {
+    if( this != &rhs ) {
+      this->destroy_all( );
+      this->move_from( rhs );
+    }
+    return *this;
+  }
+
+  T* elements( ) { return std::launder( reinterpret_cast<T *>( m_storage ) ); }
+  const T* elements( ) const { return std::launder( reinterpret_cast<const T *>( m_storage ) ); }
+  template<typename... Args>
+  void construct( std::size_t index, Args&&... args ) { ::new( static_cast<void *>( m_storage + index ) ) T( std::forward<Args>( args )... ); }
+  void destroy( std::size_t index ) { this->elements( )[ index ].~T( ); }
+
+  std::aligned_storage_t<sizeof( T ), alignof( T )> m_storage[ N ];
+  std::size_t m_size{ 0 };
+
+private:
+  void destroy_all( ) {
+    for( ; m_size > 0; --m_size ) this->destroy( m_size - 1 );
+  }
+  void copy_from( const static_vector_storage &other ) {
+    for( ; m_size < other.m_size; ++m_size ) this->construct( m_size, other.elements( )[ m_size ] );
+  }
+  void move_from( static_vector_storage &other ) {
+    for( ; m_size < other.m_size; ++m_size ) this->construct( m_size, std::move( other.elements( )[ m_size ] ) );
+  }
+};
+
+// A sequence container with a fixed capacity of N elements stored inline: it never allocates, and capacity() is N
+// from construction. reserve() past N throws std::length_error, and growing past N through push_back or emplace_back
+// is undefined, which keeps them free of capacity checks: callers such as slot_map check capacity() first.
+// Elements are contiguous and iterators are pointers. Iterators and references are only invalidated by erasing the
+// element they refer to, or an element before it.
+// For trivial types, see static_vector_is_literal, every element of the storage is value initialized on construction
+// and the vector can be used in constant expressions.
+// Provides the subset of the vector interface slot_map uses, see static_storage below for use as a slot_map Container.
+template<typename T, std::size_t N>
+class static_vector : private static_vector_storage<T, N> {
+  static_assert( N > 0, "A static_vector must have room for at least 1 element." );
+public:
+  using value_type = T;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  constexpr static_vector( ) = default;
+
+  // Iterators
+  constexpr iterator begin( ) { return this->elements( ); }
+  constexpr iterator end( ) { return this->elements( ) + this->m_size; }
+  constexpr const_iterator begin( ) const { return this->elements( ); }
+  constexpr const_iterator end( ) const { return this->elements( ) + this->m_size; }
+  constexpr const_iterator cbegin( ) const { return this->begin( ); }
+  constexpr const_iterator cend( ) const { return this->end( ); }
+  constexpr reverse_iterator rbegin( ) { return reverse_iterator( this->end( ) ); }
+  constexpr reverse_iterator rend( ) { return reverse_iterator( this->begin( ) ); }
+  constexpr const_reverse_iterator rbegin( ) const { return const_reverse_iterator( this->end( ) ); }
+  constexpr const_reverse_iterator rend( ) const { return const_reverse_iterator( this->begin( ) ); }
+  constexpr const_reverse_iterator crbegin( ) const { return this->rbegin( ); }
+  constexpr const_reverse_iterator crend( ) const { return this->rend( ); }
+
+  // Capacity
+  constexpr bool empty( ) const { return this->m_size == 0; }
+  constexpr size_type size( ) const { return this->m_size; }
+  static constexpr size_type max_size( ) { return N; }
+  static constexpr size_type capacity( ) { return N; }
+  constexpr void reserve( size_type n ) const {
+    if( n > N ) throw std::length_error( "static_vector::reserve exceeds the fixed capacity." );
+  }
+  constexpr void shrink_to_fit( ) { }
+
+  // Element access
+  constexpr pointer data( ) { return this->elements( ); }
+  constexpr const_pointer data( ) const { return this->elements( ); }
+  constexpr reference operator[]( size_type index ) { return this->elements( )[ index ]; }
+  constexpr const_reference operator[]( size_type index ) const { return this->elements( )[ index ]; }
+  constexpr reference back( ) { return this->elements( )[ this->m_size - 1 ]; }
+  constexpr const_reference back( ) const { return this->elements( )[ this->m_size - 1 ]; }
+
+  // Modifiers
+  constexpr void clear( ) {
+    for( ; this->m_size > 0; --this->m_size ) this->destroy( this->m_size - 1 );
+  }
+  constexpr void push_back( const_reference value ) { this->emplace_back( value ); }
+  constexpr void push_back( value_type &&value ) { this->emplace_back( std::move( value ) ); }
+  template<typename... Args>
+  constexpr void emplace_back( Args&&... args ) {
+    this->construct( this->m_size, std::forward<Args>( args )... );
+    ++this->m_size;
+  }
+  constexpr void pop_back( ) {
+    --this->m_size;
+    this->destroy( this->m_size );
+  }
+  constexpr iterator erase( const_iterator first, const_iterator last );
+  // Replaces the contents with [first, last), which must hold at most N elements.
+  template<typename InputIt>
+  constexpr void assign( InputIt first, InputIt last ) {
+    this->clear( );
+    for( ; first != last; ++first ) this->emplace_back( *first );
+  }
+};
+
+template<typename T, std::size_t N>
+constexpr typename static_vector<T, N>::iterator static_vector<T, N>::erase( const_iterator first, const_iterator last ) {
+  const iterator position{ this->begin( ) + ( first - this->cbegin( ) ) };
+  const difference_type count{ last - first };
+  if( count ) {
+    // std::move is only constexpr from C++20
+    for( iterator to{ position }; to + count != this->end( ); ++to ) *to = std::move( *( to + count ) );
+    for( difference_type i{ 0 }; i < count; ++i ) this->pop_back( );
+  }
+  return position;
+}
+
+// Adapts a capacity for the Container parameter of slot_map: slot_map<T, Token, static_storage<64>::container>.
+// See static_slot_map in slot_map.hpp.
+template<std::size_t N>
+struct static_storage {
+  template<typename T>
+  using container = static_vector<T, N>;
+};
@@ -0,0 +1,109 @@
+// Tests for the batch insert( first, last, out_keys ) and emplace_n( ) of slot_map. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined batch_insert_test.cpp -o batch_insert_test
+//
+// Random batches from forward and single pass ranges are mixed with erasures and checked against a std::map
+// reference, and a counting memory resource checks that a batch allocates each container at most once.
+#include <iterator> // back_inserter, istream_iterator, next
+#include <list>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept> // length_error
+#include <vector>
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  template<typename Map>
+  void test_batches( ) {
+    using key_type = typename Map::key_type;
+    Map map;
+    std::map<key_type, int> reference;
+    std::mt19937 rng( 3 );
+    const auto record = [&]( const std::vector<key_type> &keys, const std::vector<int> &values ) {
+      check( keys.size( ) == values.size( ), "a key is written for every element" );
+      for( std::size_t i{ 0 }; i < keys.size( ); ++i ) {
+        check( reference.count( keys[ i ] ) == 0, "batches hand out fresh keys" );
+        reference[ keys[ i ] ] = values[ i ];
+      }
+    };
+    for( int round{ 0 }; round < 300; ++round ) {
+      std::vector<key_type> keys;
+      std::vector<int> values;
+      switch( rng( ) % 4 ) {
+      case 0: {
+        values.resize( rng( ) % 500 );
+        for( int &value : values ) value = static_cast<int>( rng( ) );
+        map.insert( values.begin( ), values.end( ), std::back_inserter( keys ) );
+        break;
+      }
+      case 1: {
+        const typename Map::size_type count{ static_cast<typename Map::size_type>( rng( ) % 500 ) };
+        keys.resize( count );
+        const auto end{ map.emplace_n( count, []( typename Map::size_type i ) { return static_cast<int>( i * 7 ); }, keys.begin( ) ) };
+        check( end == keys.end( ), "emplace_n( ) returns one past the last key written" );
+        for( typename Map::size_type i{ 0 }; i < count; ++i ) values.push_back( static_cast<int>( i * 7 ) );
+        break;
+      }
+      case 2: {
+        const std::list<int> list{ 1, 2, 3 };
+        std::istringstream stream( "4 5 6" );
+        map.insert( std::istream_iterator<int>( stream ), std::istream_iterator<int>( ), std::back_inserter( keys ) );
+        map.insert( list.begin( ), list.end( ), std::back_inserter( keys ) );
+        values = { 4, 5, 6, 1, 2, 3 };
+        break;
+      }
+      default:
+        for( int i{ 0 }; i < 300 && !reference.empty( ); ++i ) {
+          const auto entry{ std::next( reference.begin( ), rng( ) % reference.size( ) ) };
+          map.erase( entry->first );
+          reference.erase( entry );
+        }
+      }
+      record( keys, values );
+      check( map.size( ) == reference.size( ), "batches insert every element" );
+      for( const auto &[ key, value ] : reference ) {
+        const auto element{ map.find( key ) };
+        check( element != map.end( ) && *element == value, "batches insert the elements in order" );
+      }
+    }
+  }
+
+  void test_allocations( ) {
+    test_helpers::counting_resource counter;
+    pmr_slot_map<int> map( &counter );
+    const std::vector<int> values( 1000, 7 );
+    std::vector<pmr_slot_map<int>::key_type> keys( values.size( ) );
+    map.insert( values.begin( ), values.end( ), keys.begin( ) );
+    // The elements, the erase helper and the slots.
+    check( counter.allocations <= 3, "a forward range batch allocates each container at most once" );
+    const std::size_t allocations{ counter.allocations };
+    map.emplace_n( 5000, []( pmr_slot_map<int>::size_type i ) { return static_cast<int>( i ); }, std::back_inserter( keys ) );
+    check( counter.allocations - allocations <= 3, "emplace_n( ) allocates each container at most once" );
+  }
+
+  void test_fixed_capacity( ) {
+    static_slot_map<int, 8> map;
+    std::vector<static_slot_map<int, 8>::key_type> keys;
+    map.emplace_n( 5, []( static_slot_map<int, 8>::size_type i ) { return static_cast<int>( i ); }, std::back_inserter( keys ) );
+    const std::vector<int> values( 4, 1 );
+    bool threw{ false };
+    try { map.insert( values.begin( ), values.end( ), std::back_inserter( keys ) ); }
+    catch( const std::length_error & ) { threw = true; }
+    check( threw && map.size( ) == 5 && keys.size( ) == 5, "a batch too large for a fixed capacity throws before inserting" );
+    map.insert( values.begin( ), values.end( ) - 1, std::back_inserter( keys ) );
+    check( map.size( ) == 8, "a batch which fits fills the map" );
+  }
+}
+
+int main( ) {
+  test_batches<slot_map<int>>( );
+  test_batches<slot_map<int, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::interleaved>>( );
+  test_batches<paged_slot_map<int>>( );
+  test_allocations( );
+  test_fixed_capacity( );
+  return test_helpers::test_result( );
+}
@@ -0,0 +1,273 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+//
+// Stress tests for concurrent_slot_array and thread_cache. Plain executables, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=thread concurrent_slot_array_test.cpp -lpthread -o concurrent_slot_array_test
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined concurrent_slot_array_test.cpp -lpthread -o concurrent_slot_array_test
+//
+// Every test checks that no slot is ever handed to two owners at once: each allocation claims its slot in a table of
+// owners with a compare-exchange, so a free list which hands out a slot twice fails the claim.
+#include <atomic>
+#include <stdexcept> // runtime_error
+#include <thread>
+#include <vector>
+#include "../concurrent_slot_array.hpp"
+#include "../thread_cache.hpp"
+#include "test_helpers.hpp"
+
+namespace
+{
+  using test_helpers::check;
+
+  struct payload
+  {
+    unsigned owner;
+    unsigned sequence;
+  };
+
+  const unsigned pool_elements{ 64u };
+  const unsigned thread_count{ 8u };
+  const unsigned iterations{ 200000u };
+  using pool_type = ADL::concurrent_slot_array<payload, pool_elements>;
+
+  // Claims and releases the slot of an object in a table of owners, counting slots handed out twice.
+  struct ownership
+  {
+    std::atomic<unsigned> owners[pool_elements];
+    std::atomic<unsigned> double_allocations{ 0u };
+
+    ownership()
+    {
+      for (auto &owner : owners)
+      {
+        owner.store(0u, std::memory_order_relaxed);
+      }
+    }
+    void claim(unsigned index, unsigned owner)
+    {
+      unsigned expected{ 0u };
+      if (!owners[index].compare_exchange_strong(expected, owner + 1u, std::memory_order_acq_rel))
+      {
+        double_allocations.fetch_add(1u, std::memory_order_relaxed);
+      }
+    }
+    void release(unsigned index)
+    {
+      owners[index].store(0u, std::memory_order_release);
+    }
+  };
+
+  unsigned index_of(const pool_type &pool, payload &object)
+  {
+    return static_cast<unsigned>( pool.get_ID(object) & ADL::slot_key_32::index_mask );
+  }
+
+  // Every slot must be reachable from the free list once all objects are freed and all caches flushed.
+  void check_drained(pool_type &pool, const char *message)
+  {
+    check(pool.size() == 0u, message);
+    std::vector<payload*> objects;
+    while (payload *object = pool.alloc())
+    {
+      objects.push_back(object);
+    }
+    check(objects.size() == pool_elements, message);
+    for (payload *object : objects)
+    {
+      pool.free(*object);
+    }
+  }
+
+  // Threads share a small pool through small magazines, so refills and flushes of never constructed slots interleave
+  // constantly with the plain alloc() and free() of other threads.
+  void test_alloc_flush_stress()
+  {
+    pool_type pool;
+    ownership slots;
+    std::vector<std::thread> threads;
+    for (unsigned t{ 0u }; t < thread_count; ++t)
+    {
+      threads.emplace_back([&pool, &slots, t]
+      {
+        ADL::thread_cache<pool_type, 4u> cache(pool);
+        std::vector<payload*> held;
+        for (unsigned i{ 0u }; i < iterations; ++i)
+        {
+          const bool cached{ ( t & 1u ) == 0u || ( i & 3u ) != 0u };
+          if (held.size() < 3u && ( i % 5u ) != 4u)
+          {
+            payload *object{ cached ? cache.alloc(payload{ t, i }) : pool.alloc(payload{ t, i }) };
+            if (object)
+            {
+              slots.claim(index_of(pool, *object), t);
+              held.push_back(object);
+            }
+          }
+          else if (!held.empty())
+          {
+            payload *object{ held.back() };
+            held.pop_back();
+            check(object->owner == t, "an object was overwritten by another thread");
+            slots.release(index_of(pool, *object));
+            if (cached)
+            {
+              cache.free(*object);
+            }
+            else
+            {
+              pool.free(*object);
+            }
+          }
+          if (( i & 15u ) == 0u)
+          {
+            cache.flush();
+          }
+        }
+        for (payload *object : held)
+        {
+          slots.release(index_of(pool, *object));
+          cache.free(*object);
+        }
+      });
+    }
+    for (std::thread &thread : threads)
+    {
+      thread.join();
+    }
+    check(slots.double_allocations.load() == 0u, "a slot was allocated twice");
+    check_drained(pool, "slots were lost from the free list");
+  }
+
+  // IDs of freed objects must stay invalid for get_safely() while other threads reuse the slots.
+  void test_stale_ids()
+  {
+    pool_type pool;
+    std::atomic<unsigned> stale_hits{ 0u };
+    std::vector<std::thread> threads;
+    for (unsigned t{ 0u }; t < thread_count; ++t)
+    {
+      threads.emplace_back([&pool, &stale_hits, t]
+      {
+        ADL::thread_cache<pool_type, 8u> cache(pool);
+        for (unsigned i{ 0u }; i < iterations / 4u; ++i)
+        {
+          payload *object{ cache.alloc(payload{ t, i }) };
+          if (!object)
+          {
+            continue;
+          }
+          const pool_type::id_type ID{ pool.get_ID(*object) };
+          if (pool.get_safely(ID) != object)
+          {
+            stale_hits.fetch_add(1u, std::memory_order_relaxed);
+          }
+          cache.free(*object);
+          if (pool.get_safely(ID) != nullptr)
+          {
+            stale_hits.fetch_add(1u, std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+    for (std::thread &thread : threads)
+    {
+      thread.join();
+    }
+    check(stale_hits.load() == 0u, "get_safely() returned the wrong object for an ID");
+    check_drained(pool, "slots were lost from the free list");
+  }
+
+  struct throwing
+  {
+    explicit throwing(bool fail)
+    {
+      if (fail)
+      {
+        throw std::runtime_error("constructor failed");
+      }
+    }
+  };
+
+  // A constructor which throws must not leak the slot it was given.
+  void test_throwing_constructor()
+  {
+    using throwing_pool = ADL::concurrent_slot_array<throwing, 4u>;
+    throwing_pool pool;
+    for (unsigned i{ 0u }; i < 16u; ++i)
+    {
+      try
+      {
+        pool.alloc(true);
+        check(false, "alloc() swallowed an exception");
+      }
+      catch (const std::runtime_error &)
+      {
+      }
+    }
+    {
+      ADL::thread_cache<throwing_pool, 2u> cache(pool);
+      for (unsigned i{ 0u }; i < 16u; ++i)
+      {
+        try
+        {
+          cache.alloc(true);
+          check(false, "thread_cache::alloc() swallowed an exception");
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+      }
+    }
+    unsigned allocated{ 0u };
+    while (pool.alloc(false))
+    {
+      ++allocated;
+    }
+    check(allocated == 4u, "a throwing constructor leaked its slot");
+  }
+
+  // clear() relinks the slots held in magazines, so caches must not push them onto the free list a second time.
+  void test_clear_with_caches()
+  {
+    using small_pool = ADL::concurrent_slot_array<payload, 8u>;
+    small_pool pool;
+    {
+      ADL::thread_cache<small_pool, 4u> cache(pool);
+      cache.free(*cache.alloc(payload{ 0u, 0u }));
+      pool.clear();
+    }
+    ADL::thread_cache<small_pool, 4u> cache(pool);
+    cache.free(*cache.alloc(payload{ 0u, 1u }));
+    pool.clear();
+    payload *object{ cache.alloc(payload{ 0u, 2u }) };
+    cache.flush();
+    check(object != nullptr && pool.size() == 1u, "a cache allocates after clear()");
+
+    // A cyclic free list never runs out, stop once more slots than the pool holds were handed out.
+    std::vector<payload*> objects{ object };
+    while (objects.size() <= 8u)
+    {
+      payload *other{ pool.alloc(payload{ 1u, 0u }) };
+      if (!other)
+      {
+        break;
+      }
+      for (payload *previous : objects)
+      {
+        check(previous != other, "clear() with a live cache hands out a slot twice");
+      }
+      objects.push_back(other);
+    }
+    check(objects.size() == 8u, "clear() with a live cache keeps every slot once");
+  }
+}
+
+int main()
+{
+  test_alloc_flush_stress();
+  test_stale_ids();
+  test_throwing_constructor();
+  test_clear_with_caches();
+  return test_helpers::test_result();
+}
@@ -0,0 +1,181 @@
+// Tests for concurrent_slot_map. A plain executable, 0 on success; run it under both sanitizers:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=thread concurrent_slot_map_test.cpp -lpthread -o concurrent_slot_map_test
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined concurrent_slot_map_test.cpp -lpthread -o concurrent_slot_map_test
+//
+// The stress test runs three reader threads against a writer which inserts, erases and updates. Elements hold a
+// heap allocated string, so reclaiming a cell a reader still uses shows up as a use after free under ASan, and
+// values are checked for consistency so a torn update shows up as a failure.
+#include <atomic>
+#include <memory> // unique_ptr
+#include <random>
+#include <stdexcept> // length_error, runtime_error
+#include <string>
+#include <thread>
+#include <vector>
+#include "../concurrent_slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  struct item {
+    std::uint64_t a, b;
+    std::string text;
+    explicit item( std::uint64_t value ) : a( value ), b( value * 3 ), text( describe( value ) ) { }
+    static std::string describe( std::uint64_t value ) { return std::to_string( value ) + " padded past the small string buffer"; }
+    bool consistent( ) const { return b == a * 3 && text == describe( a ); }
+  };
+
+  using map_type = concurrent_slot_map<item, std::pair<unsigned, unsigned>, 16, 8>;
+  using key_type = map_type::key_type;
+
+  void test_single_thread( ) {
+    map_type map;
+    const key_type a{ map.emplace( 1u ) }, b{ map.insert( item( 2 ) ) };
+    check( map.find( a )->a == 1 && map.find( b )->b == 6, "find( ) returns the inserted elements" );
+    check( map.erase( a ) == 1 && !map.find( a ) && map.erase( a ) == 0, "erased keys are stale" );
+    const key_type c{ map.emplace( 3u ) };
+    check( c.first == a.first && c.second == a.second + 1, "a reused slot gets the next generation" );
+    check( map.update( b, []( item &element ) { element.a = 5; element.b = 15; } ) && map.find( b )->a == 5, "update( ) publishes the new value" );
+    check( map.replace( c, 7u ) && map.find( c )->b == 21, "replace( ) publishes the new value" );
+    int visited{ 0 };
+    map.for_each( [&]( const key_type &key, const item &element ) { check( map.find( key ) == &element, "for_each( ) visits live keys" ); ++visited; } );
+    check( visited == 2 && map.size( ) == 2, "for_each( ) visits every element" );
+
+    {
+      map_type::reader reader( map );
+      map_type::read_section section( reader );
+      check( section.find( c )->a == 7, "a section finds live keys" );
+      for( unsigned i{ 0 }; i < 500; ++i ) map.erase( map.emplace( i ) );
+      check( map.retired_count( ) >= 500, "an open section holds back reclamation" );
+      check( section.find( c )->a == 7, "a section keeps finding live keys across reclamation" );
+    }
+    map.reclaim( );
+    check( map.retired_count( ) == 0, "reclaim( ) frees everything once no section is open" );
+
+    std::vector<std::unique_ptr<map_type::reader>> readers;
+    for( int i{ 0 }; i < 8; ++i ) readers.emplace_back( new map_type::reader( map ) );
+    bool threw{ false };
+    try { map_type::reader extra( map ); }
+    catch( const std::length_error & ) { threw = true; }
+    check( threw, "claiming more than MaxReaders readers throws" );
+    readers.pop_back( );
+    map_type::reader again( map );
+
+    map.clear( );
+    check( map.empty( ) && !map.find( b ), "clear( ) makes every key stale" );
+  }
+
+  // Elements which count themselves and can be told to throw from their constructor.
+  struct counted {
+    static inline int live{ 0 };
+    explicit counted( bool fail ) {
+      if( fail ) throw std::runtime_error( "constructor failed" );
+      ++live;
+    }
+    counted( const counted & ) { ++live; }
+    ~counted( ) { --live; }
+  };
+
+  void test_exceptions( ) {
+    {
+      concurrent_slot_map<counted, std::pair<unsigned, unsigned>, 16, 8> map;
+      std::vector<std::pair<unsigned, unsigned>> keys;
+      std::size_t erased{ 0 };
+      for( int i{ 0 }; i < 100; ++i ) {
+        keys.push_back( map.emplace( false ) );
+        bool threw{ false };
+        try { map.emplace( true ); }
+        catch( const std::runtime_error & ) { threw = true; }
+        check( threw && map.size( ) == keys.size( ) - erased, "a throwing constructor inserts nothing" );
+        if( i % 3 == 2 ) {
+          map.erase( keys[ erased++ ] );
+          threw = false;
+          try { map.replace( keys.back( ), true ); }
+          catch( const std::runtime_error & ) { threw = true; }
+          check( threw && map.find( keys.back( ) ), "a throwing replace( ) keeps the old element" );
+        }
+      }
+      const auto key{ map.emplace( false ) };
+      check( map.find( key ) && map.find( keys.back( ) ), "slots are not lost to throwing constructors" );
+    }
+    check( counted::live == 0, "every constructed element is destroyed" );
+
+    // With 16 bit keys the slots run out, and the element must not be constructed.
+    {
+      concurrent_slot_map<counted, std::pair<unsigned short, unsigned short>, 1024, 8> map;
+      for( unsigned i{ 0 }; i < 0xFFFFu; ++i ) map.emplace( false );
+      bool threw{ false };
+      try { map.emplace( false ); }
+      catch( const std::length_error & ) { threw = true; }
+      check( threw && map.size( ) == 0xFFFFu && counted::live == 0xFFFF, "running out of keys constructs nothing" );
+    }
+    check( counted::live == 0, "every constructed element is destroyed" );
+  }
+
+  void test_readers_and_writer( ) {
+    map_type map;
+    constexpr int published_count{ 256 };
+    constexpr std::uint64_t none{ ~std::uint64_t{ 0 } };
+    // Keys the writer has handed out, packed into words readers can load. Some are stale by the time they are read.
+    std::atomic<std::uint64_t> published[ published_count ];
+    for( auto &word : published ) word.store( none, std::memory_order_relaxed );
+    const auto pack = []( const key_type &key ) { return ( static_cast<std::uint64_t>( key.second ) << 32 ) | key.first; };
+    std::atomic<bool> stop{ false };
+    std::atomic<long> hits{ 0 };
+
+    std::vector<std::thread> readers;
+    for( unsigned t{ 0 }; t < 3; ++t ) {
+      readers.emplace_back( [&, t] {
+        map_type::reader reader( map );
+        std::mt19937 rng( t );
+        long found{ 0 };
+        while( !stop.load( ) ) {
+          map_type::read_section section( reader );
+          for( int i{ 0 }; i < 32; ++i ) {
+            const std::uint64_t word{ published[ rng( ) % published_count ].load( std::memory_order_acquire ) };
+            if( word == none ) continue;
+            const item *element{ section.find( key_type{ static_cast<unsigned>( word ), static_cast<unsigned>( word >> 32 ) } ) };
+            if( element ) {
+              ++found;
+              check( element->consistent( ), "a reader saw a torn element" );
+            }
+          }
+        }
+        hits += found;
+      } );
+    }
+
+    std::mt19937 rng( 99 );
+    std::vector<key_type> live( published_count );
+    std::vector<bool> has( published_count, false );
+    for( int op{ 0 }; op < 200000; ++op ) {
+      const int i{ static_cast<int>( rng( ) % published_count ) };
+      if( !has[ i ] ) {
+        live[ i ] = map.emplace( static_cast<std::uint64_t>( rng( ) ) );
+        has[ i ] = true;
+        published[ i ].store( pack( live[ i ] ), std::memory_order_release );
+      }
+      else if( rng( ) % 2 ) {
+        map.erase( live[ i ] );
+        has[ i ] = false;
+      }
+      else {
+        const std::uint64_t value{ rng( ) };
+        map.update( live[ i ], [value]( item &element ) { element.a = value; element.b = value * 3; element.text = item::describe( value ); } );
+      }
+      if( op % 1000 == 0 ) std::this_thread::yield( );
+    }
+    stop = true;
+    for( std::thread &reader : readers ) reader.join( );
+    check( hits.load( ) > 0, "readers found published keys" );
+  }
+}
+
+int main( ) {
+  test_single_thread( );
+  test_exceptions( );
+  test_readers_and_writer( );
+  return test_helpers::test_result( );
+}
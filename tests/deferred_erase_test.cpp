@@ -0,0 +1,178 @@
+// Tests for defer_erase() and flush_erases() of slot_map and slot_array. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined deferred_erase_test.cpp -o deferred_erase_test
+//
+// Every round kills elements while iterating, mixes in stale keys and direct erasures before the flush, and checks
+// the survivors against a std::map reference.
+#include <cstddef> // size_t
+#include <map>
+#include <memory> // unique_ptr
+#include <memory_resource>
+#include <new> // align_val_t
+#include <random>
+#include <set>
+#include <stdexcept> // length_error
+#include <utility> // pair
+#include <vector>
+#include "../slot_array.hpp"
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  using token = std::pair<unsigned, unsigned>;
+  using queue = slot_map_deferred_erase::queue;
+  template<typename T>
+  using deferred_slot_map = slot_map<T, token, std::vector, slot_map_layout::separate, slot_map_growth::automatic, slot_map_stats::none, queue>;
+
+  template<typename Map>
+  void test_map( ) {
+    Map map;
+    std::map<typename Map::key_type, int> reference;
+    std::mt19937 rng( 7 );
+    for( int round{ 0 }; round < 300; ++round ) {
+      const int inserts{ static_cast<int>( rng( ) % 40 ) };
+      for( int i{ 0 }; i < inserts && map.size( ) < 60; ++i ) {
+        const int value{ static_cast<int>( rng( ) % 100000 ) };
+        reference[ map.insert( value ) ] = value;
+      }
+      std::set<typename Map::key_type> killed;
+      for( auto element{ map.cbegin( ) }; element != map.cend( ); ++element ) {
+        if( *element % 3 == 0 ) map.defer_erase( element );
+      }
+      for( const auto &[ key, value ] : reference ) {
+        if( value % 3 == 0 ) killed.insert( key );
+        if( value % 5 == 0 ) {
+          map.defer_erase( key );
+          killed.insert( key );
+        }
+      }
+      for( const auto &key : killed ) {
+        if( rng( ) % 7 == 0 ) map.erase( key );
+      }
+      const auto stale{ map.insert( 1 ) };
+      map.erase( stale );
+      map.defer_erase( stale );
+      check( map.pending_erases( ) >= killed.size( ), "every queued key is pending" );
+
+      map.flush_erases( );
+      check( map.pending_erases( ) == 0, "flush_erases( ) empties the queue" );
+      for( const auto &key : killed ) reference.erase( key );
+      check( map.size( ) == reference.size( ), "flush_erases( ) erases exactly the queued elements" );
+      for( const auto &[ key, value ] : reference ) {
+        const auto element{ map.find( key ) };
+        check( element != map.end( ) && *element == value, "survivors keep their keys" );
+      }
+      for( const auto &key : killed ) check( map.find( key ) == map.end( ), "queued keys are erased" );
+    }
+  }
+
+  void test_map_policy( ) {
+    static_assert( sizeof( static_slot_map<int, 64> ) < sizeof( static_slot_map<int, 64, token, slot_map_layout::separate, slot_map_stats::none, queue> ),
+                   "Maps without the deferred erase queue don't hold one." );
+    static_slot_map<int, 4, token, slot_map_layout::separate, slot_map_stats::none, queue> map;
+    const auto key{ map.insert( 1 ) };
+    for( int i{ 0 }; i < 4; ++i ) map.defer_erase( key );
+    bool threw{ false };
+    try { map.defer_erase( key ); }
+    catch( const std::length_error & ) { threw = true; }
+    check( threw, "a full fixed capacity queue throws" );
+    check( map.flush_erases( ) == 1 && map.empty( ), "keys queued twice are erased once" );
+  }
+
+  template<typename Array>
+  void test_array( ) {
+    std::unique_ptr<Array> array{ new Array };
+    std::map<typename Array::id_type, int> reference;
+    std::mt19937 rng( 9 );
+    for( int round{ 0 }; round < 300; ++round ) {
+      const int allocations{ static_cast<int>( rng( ) % 200 ) };
+      for( int i{ 0 }; i < allocations && array->size( ) < 1500; ++i ) {
+        const int value{ static_cast<int>( rng( ) % 100000 ) };
+        reference[ array->get_ID( array->alloc( value ) ) ] = value;
+      }
+      std::set<typename Array::id_type> killed;
+      for( auto object{ array->begin( ) }; object != array->end( ); ++object ) {
+        if( *object % 3 == 0 ) {
+          array->defer_erase( object );
+          array->defer_erase( *object );
+        }
+      }
+      for( const auto &[ ID, value ] : reference ) {
+        if( value % 3 == 0 ) killed.insert( ID );
+        if( value % 5 == 0 ) {
+          array->defer_erase( ID );
+          killed.insert( ID );
+        }
+      }
+      unsigned freed{ 0u };
+      for( const auto &ID : killed ) {
+        if( rng( ) % 7 == 0 ) {
+          array->free( array->get( ID ) );
+          ++freed;
+        }
+      }
+      check( array->pending_erases( ) == killed.size( ) - freed, "freeing a marked object unmarks it" );
+      // A slot freed directly is reused here, and the new object must survive the flush.
+      const auto fresh{ array->get_ID( array->alloc( 1 ) ) };
+      check( array->flush_erases( ) == killed.size( ) - freed, "flush_erases( ) frees every marked object" );
+      for( const auto &ID : killed ) reference.erase( ID );
+      reference[ fresh ] = 1;
+      check( array->size( ) == reference.size( ), "flush_erases( ) frees exactly the marked objects" );
+      for( const auto &[ ID, value ] : reference ) {
+        const int *object{ array->get_safely( ID ) };
+        check( object && *object == value, "survivors keep their IDs" );
+      }
+      for( const auto &ID : killed ) check( array->get_safely( ID ) == nullptr, "marked objects are freed" );
+      if( round % 97 == 96 ) {
+        array->defer_erase( array->get_ID( *array->begin( ) ) );
+        array->clear( );
+        reference.clear( );
+        check( array->pending_erases( ) == 0 && array->flush_erases( ) == 0, "clear( ) drops the marks" );
+      }
+    }
+  }
+
+  void test_array_allocation( ) {
+    test_helpers::counting_resource counter;
+    ADL::slot_array<int, 1000> array( &counter );
+    const std::size_t allocations{ counter.allocations };
+    int &object{ array.alloc( 1 ) };
+    array.free( object );
+    check( counter.allocations == allocations, "the marks aren't allocated before the first defer_erase( )" );
+    array.defer_erase( array.alloc( 2 ) );
+    check( counter.allocations == allocations + 1, "the first defer_erase( ) allocates the marks once" );
+    array.defer_erase( array.alloc( 3 ) );
+    check( counter.allocations == allocations + 1 && array.flush_erases( ) == 2, "later defer_erase( ) calls reuse the marks" );
+
+    // Adopted storage can't allocate, the marks come from the resource passed to the constructor.
+    using adopting_array = ADL::slot_array<int, 100>;
+    adopting_array source;
+    const auto ID{ source.get_ID( source.alloc( 4 ) ) };
+    void *image{ ::operator new( adopting_array::snapshot_size( ), std::align_val_t{ adopting_array::snapshot_alignment } ) };
+    source.write_snapshot( image );
+    {
+      adopting_array adopted( &counter );
+      check( adopted.adopt_snapshot( image, adopting_array::snapshot_size( ) ), "the image is adopted" );
+      adopted.defer_erase( ID );
+      check( adopted.flush_erases( ) == 1 && adopted.empty( ), "adopted slot_arrays defer frees" );
+    }
+    ::operator delete( image, std::align_val_t{ adopting_array::snapshot_alignment } );
+  }
+}
+
+int main( ) {
+  test_map<deferred_slot_map<int>>( );
+  test_map<slot_map<int, token, std::vector, slot_map_layout::interleaved, slot_map_growth::automatic, slot_map_stats::none, queue>>( );
+  test_map<paged_slot_map<int, token, slot_map_layout::separate, slot_map_growth::automatic, slot_map_stats::none, queue>>( );
+  test_map<static_slot_map<int, 64, token, slot_map_layout::separate, slot_map_stats::none, queue>>( );
+  test_map_policy( );
+  test_array<ADL::slot_array<int, 2048, true, ADL::slot_layout::in_place>>( );
+  test_array<ADL::slot_array<int, 2048, true, ADL::slot_layout::split>>( );
+  test_array<ADL::slot_array<int, 2048, true, ADL::slot_layout::dense>>( );
+  test_array<ADL::slot_array<int, 2048, false, ADL::slot_layout::dense>>( );
+  test_array<ADL::slot_array<int, 2000, false, ADL::slot_layout::in_place>>( );
+  test_array_allocation( );
+  return test_helpers::test_result( );
+}
@@ -0,0 +1,142 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+//
+// Tests for slot_layout::dense. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined dense_layout_test.cpp -o dense_layout_test
+//
+// Random allocations and frees by ID, by reference and by iterator are checked against a std::map reference after
+// every round: IDs must stay valid while their objects move, and the live objects must stay packed.
+#include <iterator> // next
+#include <map>
+#include <memory> // unique_ptr
+#include <random>
+#include <string>
+#include <vector>
+#include "../slot_array.hpp"
+#include "test_helpers.hpp"
+
+namespace
+{
+  using test_helpers::check;
+
+  std::string text(unsigned i)
+  {
+    return std::to_string(i) + " padded past the small string buffer";
+  }
+
+  template<typename Array>
+  void check_packed(const Array &array, const std::map<typename Array::id_type, std::string> &reference)
+  {
+    check(array.size() == reference.size(), "the size matches the reference");
+    unsigned visited{ 0u };
+    std::string *first{ nullptr };
+    for (std::string &object : array)
+    {
+      if (!first)
+      {
+        first = &object;
+      }
+      check(&object == first + visited, "live objects are packed at the front");
+      ++visited;
+    }
+    check(visited == array.size(), "iteration visits every live object");
+    for (const auto &[ID, value] : reference)
+    {
+      const std::string *object{ array.get_safely(ID) };
+      check(object && *object == value && &array.get(ID) == object, "IDs follow their objects when they move");
+    }
+  }
+
+  template<typename Array>
+  void test_churn()
+  {
+    std::unique_ptr<Array> array{ new Array };
+    std::map<typename Array::id_type, std::string> reference;
+    std::vector<typename Array::id_type> stale;
+    std::mt19937 rng(11);
+    unsigned next{ 0u };
+    for (unsigned round{ 0u }; round < 500u; ++round)
+    {
+      const unsigned allocations{ rng() % 64u };
+      for (unsigned i{ 0u }; i < allocations && array->size() < array->capacity(); ++i)
+      {
+        const std::string value{ text(next++) };
+        reference[array->get_ID(array->alloc(value))] = value;
+      }
+      const unsigned frees{ rng() % 64u };
+      for (unsigned i{ 0u }; i < frees && !reference.empty(); ++i)
+      {
+        auto entry{ std::next(reference.begin(), rng() % reference.size()) };
+        switch (rng() % 3u)
+        {
+        case 0u:
+          array->free(array->get(entry->first));
+          break;
+        case 1u:
+          array->free_n(&entry->first, 1u);
+          break;
+        default:
+        {
+          const auto position{ array->erase(typename Array::iterator(*array, entry->first)) };
+          check(position == array->end() || array->get_safely(array->get_ID(*position)), "erase() returns the object moved into the hole");
+          break;
+        }
+        }
+        stale.push_back(entry->first);
+        reference.erase(entry);
+      }
+      check_packed(*array, reference);
+    }
+    for (const auto &ID : stale)
+    {
+      check(array->get_safely(ID) == nullptr, "IDs of freed objects are stale");
+    }
+    array->clear();
+    check(array->empty() && array->begin() == array->end(), "clear() frees every object");
+  }
+
+  void test_range_erase()
+  {
+    using array_type = ADL::slot_array<std::string, 64, true, ADL::slot_layout::dense>;
+    std::unique_ptr<array_type> array{ new array_type };
+    std::map<array_type::id_type, std::string> reference;
+    std::vector<array_type::id_type> IDs;
+    for (unsigned i{ 0u }; i < 40u; ++i)
+    {
+      IDs.push_back(array->get_ID(array->alloc(text(i))));
+      reference[IDs.back()] = text(i);
+    }
+    // Frees the objects at packed positions [10, 20), the objects moved into them come from past the range.
+    for (unsigned i{ 10u }; i < 20u; ++i)
+    {
+      reference.erase(IDs[i]);
+    }
+    array->erase(typename array_type::iterator(*array, IDs[10]), typename array_type::iterator(*array, IDs[20]));
+    check_packed(*array, reference);
+    array->erase(array->begin(), array->end());
+    check(array->empty(), "erasing every object empties the array");
+  }
+
+  void test_statistics()
+  {
+    using array_type = ADL::slot_array<int, 16, true, ADL::slot_layout::dense, ADL::slot_key_32, ADL::slot_stats::counters>;
+    array_type array;
+    int &first{ array.alloc(1) };
+    array.alloc(2);
+    int &last{ array.alloc(3) };
+    array.free(last);
+    array.free(first);
+    check(array.statistics().dense_moves == 1u, "freeing the last object moves nothing, freeing another moves one");
+  }
+}
+
+int main()
+{
+  test_churn<ADL::slot_array<std::string, 512, true, ADL::slot_layout::dense>>();
+  test_churn<ADL::slot_array<std::string, 512, false, ADL::slot_layout::dense>>();
+  test_churn<ADL::slot_array<std::string, 512, true, ADL::slot_layout::dense, ADL::slot_key_64>>();
+  test_range_erase();
+  test_statistics();
+  return test_helpers::test_result();
+}
@@ -0,0 +1,119 @@
+// Tests for the growth policies, shrink_to_fit( ) and compact_slots( ) of slot_map. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined growth_policy_test.cpp -o growth_policy_test
+//
+// Phases of growth and shrinking interleaved with compaction are checked against a std::map reference, and keys of
+// the slots compaction dropped must stay stale once the slots grow back.
+#include <iterator> // next
+#include <map>
+#include <random>
+#include <stdexcept> // length_error
+#include <vector>
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  template<typename Map>
+  void test_phases( unsigned seed ) {
+    using key_type = typename Map::key_type;
+    Map map;
+    std::map<key_type, int> reference;
+    std::vector<key_type> stale;
+    std::mt19937 rng( seed );
+    for( int op{ 0 }; op < 40000; ++op ) {
+      const unsigned choice{ static_cast<unsigned>( rng( ) % 100 ) };
+      const bool growing{ ( op / 5000 ) % 2 == 0 };
+      if( choice < ( growing ? 70u : 25u ) || reference.empty( ) ) {
+        const int value{ static_cast<int>( rng( ) ) };
+        const key_type key{ map.insert( value ) };
+        check( reference.count( key ) == 0, "insert( ) hands out fresh keys" );
+        reference[ key ] = value;
+      }
+      else if( choice < 97 ) {
+        const auto entry{ std::next( reference.begin( ), rng( ) % reference.size( ) ) };
+        check( map.erase( entry->first ) == 1, "erase( key ) erases live keys" );
+        stale.push_back( entry->first );
+        reference.erase( entry );
+      }
+      else if( choice < 98 ) {
+        map.compact_slots( );
+      }
+      else if( choice < 99 ) {
+        map.shrink_to_fit( );
+      }
+      else {
+        map.compact_slots( );
+        map.shrink_to_fit( );
+        check( map.capacity( ) >= map.size( ) && map.capacity_slots( ) >= map.size( ), "shrinking keeps room for every element" );
+      }
+      if( op % 500 == 0 ) {
+        check( map.size( ) == reference.size( ), "the size matches the reference" );
+        for( const auto &[ key, value ] : reference ) {
+          const auto element{ map.find( key ) };
+          check( element != map.end( ) && *element == value, "compaction keeps the keys of live elements" );
+        }
+        for( const key_type &key : stale ) {
+          check( reference.count( key ) || map.find( key ) == map.end( ), "keys of erased elements stay stale" );
+        }
+      }
+    }
+  }
+
+  void test_capped( ) {
+    using map_type = slot_map<int, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::separate, slot_map_growth::capped<100>>;
+    map_type map;
+    std::vector<map_type::key_type> keys;
+    for( int i{ 0 }; i < 100; ++i ) keys.push_back( map.insert( i ) );
+    bool threw{ false };
+    try { map.insert( 100 ); }
+    catch( const std::length_error & ) { threw = true; }
+    check( threw && map.size( ) == 100, "inserting past the cap throws" );
+    check( map.capacity( ) <= 100 && map.capacity_slots( ) <= 100, "growth never passes the cap" );
+    map.erase( keys[ 5 ] );
+    check( map[ map.insert( 5 ) ] == 5, "a full capped map reuses erased slots" );
+    threw = false;
+    try { map.reserve( 101 ); }
+    catch( const std::length_error & ) { threw = true; }
+    check( threw, "reserving past the cap throws" );
+  }
+
+  // Compaction drops the trailing free slots. When they grow back, their generation has to start past every key the
+  // dropped slots handed out.
+  void test_generation_floor( ) {
+    slot_map<int> map;
+    std::vector<slot_map<int>::key_type> keys;
+    for( int i{ 0 }; i < 50000; ++i ) keys.push_back( map.insert( i ) );
+    for( int i{ 500 }; i < 50000; ++i ) map.erase( keys[ i ] );
+    map.compact_slots( );
+    map.shrink_to_fit( );
+    check( map.capacity_slots( ) < 50000 && map.size( ) == 500, "compact_slots( ) drops the trailing free slots" );
+    std::vector<slot_map<int>::key_type> fresh;
+    for( int i{ 0 }; i < 60000; ++i ) fresh.push_back( map.insert( i ) );
+    bool stale{ true };
+    for( int i{ 500 }; i < 50000; ++i ) stale = stale && map.find( keys[ i ] ) == map.end( );
+    check( stale, "keys of dropped slots stay stale when the slots grow back" );
+    bool found{ true };
+    for( int i{ 0 }; i < 500; ++i ) found = found && map[ keys[ i ] ] == i;
+    for( int i{ 0 }; i < 60000; ++i ) found = found && map[ fresh[ i ] ] == i;
+    check( found, "compaction keeps the keys of live elements" );
+
+    const auto old_key{ map.insert( 1 ) };
+    map.clear( );
+    map.insert( 2 );
+    check( map.find( old_key ) == map.end( ), "clear( ) raises the generation floor as well" );
+  }
+}
+
+int main( ) {
+  test_phases<slot_map<int>>( 1 );
+  test_phases<slot_map<int, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::interleaved>>( 2 );
+  test_phases<slot_map<int, std::pair<unsigned, unsigned>, paged<16>::container>>( 3 );
+  test_phases<slot_map<int, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::separate, slot_map_growth::linear<7>>>( 4 );
+  test_phases<slot_map<int, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::separate, slot_map_growth::geometric<3, 1>>>( 5 );
+  test_phases<paged_slot_map<int, std::pair<unsigned, unsigned>, slot_map_layout::interleaved, slot_map_growth::linear<100>>>( 6 );
+  test_capped( );
+  test_generation_floor( );
+  return test_helpers::test_result( );
+}
@@ -0,0 +1,94 @@
+// Tests for the allocator and memory resource support of slot_array, slot_map and paged_vector.
+// A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined memory_resource_test.cpp -o memory_resource_test
+//
+// The arena tests use a monotonic_buffer_resource with a null upstream, so any allocation which bypasses the given
+// resource for the global heap throws. The counting tests check that everything allocated is returned.
+#include <cstddef> // size_t
+#include <memory_resource>
+#include <new> // bad_alloc
+#include <string>
+#include <utility> // move, pair
+#include <vector>
+#include "../slot_array.hpp"
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  using key_type = std::pair<unsigned, unsigned>;
+  const char *const long_text{ "a string long enough to defeat the small string buffer" };
+
+  void test_arena( ) {
+    static char buffer[ 1 << 22 ];
+    std::pmr::monotonic_buffer_resource arena( buffer, sizeof( buffer ), std::pmr::null_memory_resource( ) );
+    try {
+      pmr_slot_map<std::pmr::string> map( &arena );
+      std::vector<key_type> keys;
+      for( int i{ 0 }; i < 5000; ++i ) keys.push_back( map.emplace( long_text ) );
+      for( int i{ 0 }; i < 5000; i += 2 ) map.erase( keys[ i ] );
+      check( map.size( ) == 2500 && map[ keys[ 1 ] ] == long_text, "pmr_slot_map works from an arena" );
+      check( map.begin( )->get_allocator( ).resource( ) == &arena, "pmr_slot_map elements use the map's resource" );
+
+      slot_map<std::pmr::string, key_type, pmr_paged_container> paged( &arena );
+      for( int i{ 0 }; i < 5000; ++i ) paged.emplace( long_text );
+      check( paged.begin( )->get_allocator( ).resource( ) == &arena, "paged_vector elements use the map's resource" );
+
+      slot_map<soa<int, float>, key_type, std::pmr::vector> columns( &arena );
+      for( int i{ 0 }; i < 1000; ++i ) columns.emplace( i, 1.f );
+      check( columns.size( ) == 1000, "soa columns work from an arena" );
+
+      ADL::slot_array<int, 3000, true, ADL::slot_layout::dense> dense( &arena );
+      for( int i{ 0 }; i < 3000; ++i ) dense.alloc( i );
+      check( dense.get_memory_resource( ) == &arena, "slot_array reports its resource" );
+      ADL::slot_array<int, 3000, true, ADL::slot_layout::split> split( &arena );
+      for( int i{ 0 }; i < 3000; ++i ) split.alloc( i );
+    }
+    catch( const std::bad_alloc & ) {
+      check( false, "an allocation bypassed the arena" );
+    }
+  }
+
+  void test_no_leaks( ) {
+    test_helpers::counting_resource counter;
+    {
+      ADL::slot_array<std::string, 1000> array( &counter );
+      array.alloc( long_text );
+      slot_map<int, key_type, pmr_paged_container> map( &counter );
+      for( int i{ 0 }; i < 100000; ++i ) map.insert( i );
+      auto copy{ map };
+      auto moved{ std::move( map ) };
+      moved.shrink_to_fit( );
+      moved.compact_slots( );
+      check( copy.size( ) == 100000 && moved.size( ) == 100000, "copies and moves keep every element" );
+
+      paged_vector<int, 16, std::pmr::polymorphic_allocator<int>> source( &counter ), target;
+      for( int i{ 0 }; i < 100; ++i ) source.push_back( i );
+      target = std::move( source );
+      check( target.size( ) == 100 && target[ 99 ] == 99, "move assignment between unequal allocators keeps the elements" );
+      source = target;
+      check( source.size( ) == 100, "copy assignment keeps the elements" );
+    }
+    check( counter.total != 0, "the resource was used" );
+    check( counter.live == 0, "everything allocated from the resource was returned" );
+  }
+
+  void test_defaults( ) {
+    ADL::slot_array<int> heap;
+    check( heap.get_memory_resource( ) == std::pmr::get_default_resource( ), "slot_array defaults to the default resource" );
+    ADL::slot_array<int, 100, false> in_place;
+    check( in_place.get_memory_resource( ) == nullptr, "an in place slot_array has no resource" );
+    slot_map<int> map( std::allocator<int>{ } );
+    map.insert( 1 );
+    check( map.size( ) == 1, "slot_map takes a std::allocator" );
+  }
+}
+
+int main( ) {
+  test_arena( );
+  test_no_leaks( );
+  test_defaults( );
+  return test_helpers::test_result( );
+}
@@ -0,0 +1,77 @@
+// Tests for slot_map::erase( first, last ). A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined range_erase_test.cpp -o range_erase_test
+//
+// Every round erases a random range and checks the survivors against a std::map reference. Refilling the map then
+// has to reuse every slot the ranges spliced onto the free list before it grows.
+#include <iterator> // next
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  std::string text( int i ) { return std::to_string( i ) + " padded past the small string buffer"; }
+
+  template<typename Map>
+  void test_ranges( ) {
+    using key_type = typename Map::key_type;
+    Map map;
+    std::map<key_type, std::string> reference;
+    std::mt19937 rng( 3 );
+    int next{ 0 };
+    for( int round{ 0 }; round < 400; ++round ) {
+      while( map.size( ) < 100 ) {
+        const std::string value{ text( next++ ) };
+        reference[ map.insert( value ) ] = value;
+      }
+      const std::size_t slots{ static_cast<std::size_t>( map.capacity_slots( ) ) };
+      const auto first_index{ static_cast<std::ptrdiff_t>( rng( ) % map.size( ) ) };
+      const auto last_index{ first_index + static_cast<std::ptrdiff_t>( rng( ) % ( map.size( ) - first_index + 1 ) ) };
+      std::set<key_type> erased;
+      for( auto i{ first_index }; i != last_index; ++i ) erased.insert( map.key_at( static_cast<typename Map::size_type>( i ) ) );
+
+      const auto result{ map.erase( std::next( map.cbegin( ), first_index ), std::next( map.cbegin( ), last_index ) ) };
+      check( result == std::next( map.begin( ), first_index ), "erase( first, last ) returns an iterator to the position of first" );
+      for( const key_type &key : erased ) {
+        check( map.find( key ) == map.end( ), "erased keys are stale" );
+        reference.erase( key );
+      }
+      check( map.size( ) == reference.size( ), "erase( first, last ) erases exactly the range" );
+      for( const auto &[ key, value ] : reference ) {
+        const auto element{ map.find( key ) };
+        check( element != map.end( ) && *element == value, "elements moved into the range keep their keys" );
+      }
+      for( typename Map::size_type i{ 0 }; i < map.size( ); ++i ) {
+        check( map.find( map.key_at( i ) ) == std::next( map.begin( ), i ), "the erase helper matches the slots" );
+      }
+
+      // The slots of the range are on the free list, refilling reuses them without growing.
+      std::set<key_type> fresh;
+      for( std::size_t i{ 0 }; i < erased.size( ); ++i ) {
+        const std::string value{ text( next++ ) };
+        const key_type key{ map.insert( value ) };
+        check( !reference.count( key ) && !erased.count( key ) && fresh.insert( key ).second, "reused slots get fresh keys" );
+        reference[ key ] = value;
+      }
+      check( static_cast<std::size_t>( map.capacity_slots( ) ) == slots, "refilling reuses the erased slots" );
+      if( round % 50 == 49 ) {
+        map.erase( map.begin( ), map.end( ) );
+        check( map.empty( ), "erasing everything empties the map" );
+        reference.clear( );
+      }
+    }
+  }
+}
+
+int main( ) {
+  test_ranges<slot_map<std::string>>( );
+  test_ranges<slot_map<std::string, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::interleaved>>( );
+  test_ranges<paged_slot_map<std::string>>( );
+  return test_helpers::test_result( );
+}
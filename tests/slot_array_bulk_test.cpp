@@ -0,0 +1,132 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+//
+// Tests for slot_array::alloc_n() and free_n(). A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined slot_array_bulk_test.cpp -o slot_array_bulk_test
+//
+// Elements are heap allocated strings, so an object constructed over a live one or never destroyed shows up as a
+// leak under ASan.
+#include <memory> // unique_ptr
+#include <stdexcept> // runtime_error
+#include <string>
+#include <vector>
+#include "../slot_array.hpp"
+#include "test_helpers.hpp"
+
+namespace
+{
+  using test_helpers::check;
+
+  std::string text(unsigned i)
+  {
+    return std::to_string(i) + " padded past the small string buffer";
+  }
+
+  template<typename Array>
+  void test_alloc_and_free(bool by_pointer)
+  {
+    std::unique_ptr<Array> array{ new Array };
+    array->alloc(std::string("first"));
+    std::vector<typename Array::id_type> IDs(200);
+    array->alloc_n(200u, [](unsigned i) { return text(i); }, IDs.data());
+    check(array->size() == 201u && array->max_usage() == 201u, "alloc_n() updates the size and max usage");
+    for (unsigned i{ 0u }; i < 200u; ++i)
+    {
+      const std::string *object{ array->get_safely(IDs[i]) };
+      check(object && *object == text(i), "alloc_n() returns the IDs in allocation order");
+    }
+
+    std::vector<typename Array::id_type> odd;
+    for (unsigned i{ 1u }; i < 200u; i += 2u)
+    {
+      odd.push_back(IDs[i]);
+    }
+    array->free_n(odd.data(), static_cast<unsigned>( odd.size() ));
+    for (unsigned i{ 0u }; i < 200u; ++i)
+    {
+      const std::string *object{ array->get_safely(IDs[i]) };
+      check(( i & 1u ) ? object == nullptr : ( object && *object == text(i) ), "free_n() frees exactly the given IDs");
+    }
+
+    if (by_pointer)
+    {
+      std::vector<std::string*> objects;
+      for (std::string &object : *array)
+      {
+        if (object != "first")
+        {
+          objects.push_back(&object);
+        }
+      }
+      array->free_n(objects.data(), static_cast<unsigned>( objects.size() ));
+    }
+    else
+    {
+      std::vector<typename Array::id_type> even;
+      for (unsigned i{ 0u }; i < 200u; i += 2u)
+      {
+        even.push_back(IDs[i]);
+      }
+      array->free_n(even.data(), static_cast<unsigned>( even.size() ));
+    }
+    check(array->size() == 1u, "free_n() of objects frees them all");
+    array->alloc_n(255u, [](unsigned) { return std::string("reused"); });
+    check(array->size() == 256u, "alloc_n() reuses freed slots and fills the array");
+  }
+
+  // A generator which throws part way through leaves the objects it already made allocated, and the slot it was
+  // filling free.
+  template<typename Array>
+  void test_throwing_generator()
+  {
+    std::unique_ptr<Array> array{ new Array };
+    const auto generator = [](unsigned i)
+    {
+      if (i == 2u)
+      {
+        throw std::runtime_error("generator failed");
+      }
+      return text(i);
+    };
+    std::vector<typename Array::id_type> IDs(5);
+    for (unsigned round{ 0u }; round < 3u; ++round)
+    {
+      bool threw{ false };
+      try
+      {
+        array->alloc_n(5u, generator, IDs.data());
+      }
+      catch (const std::runtime_error &)
+      {
+        threw = true;
+      }
+      check(threw, "alloc_n() passes on the exception");
+      check(array->size() == 2u * ( round + 1u ), "the objects made before the exception stay allocated");
+      check(*array->get_safely(IDs[0]) == text(0u) && *array->get_safely(IDs[1]) == text(1u), "the objects made before the exception are intact");
+    }
+    unsigned allocated{ array->size() };
+    while (array->size() < array->capacity())
+    {
+      array->alloc(text(allocated++));
+    }
+    unsigned visited{ 0u };
+    for (const std::string &object : *array)
+    {
+      check(!object.empty(), "every allocated object is intact");
+      ++visited;
+    }
+    check(visited == array->capacity(), "the slot of the failed object is not lost");
+  }
+}
+
+int main()
+{
+  test_alloc_and_free<ADL::slot_array<std::string, 256>>(true);
+  test_alloc_and_free<ADL::slot_array<std::string, 256, true, ADL::slot_layout::split>>(true);
+  test_alloc_and_free<ADL::slot_array<std::string, 256, true, ADL::slot_layout::dense>>(false);
+  test_throwing_generator<ADL::slot_array<std::string, 16>>();
+  test_throwing_generator<ADL::slot_array<std::string, 16, true, ADL::slot_layout::split>>();
+  test_throwing_generator<ADL::slot_array<std::string, 16, true, ADL::slot_layout::dense>>();
+  return test_helpers::test_result();
+}
@@ -0,0 +1,152 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+//
+// Tests for the snapshots of slot_array. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined slot_array_snapshot_test.cpp -o slot_array_snapshot_test
+//
+// A churned slot_array is written to an image, then loaded and adopted by other slot_arrays which must find every
+// live ID, reject every stale one and keep allocating. Truncated and corrupt images must be refused.
+#include <cstddef> // byte, size_t
+#include <memory> // unique_ptr
+#include <vector>
+#include "../slot_array.hpp"
+#include "test_helpers.hpp"
+
+namespace
+{
+  using test_helpers::check;
+
+  struct particle
+  {
+    float x, y, z;
+    int id;
+  };
+
+  // Image buffers have to be aligned to snapshot_alignment.
+  struct alignas(64) block
+  {
+    std::byte bytes[64];
+  };
+
+  std::unique_ptr<block[]> make_image(size_t size)
+  {
+    return std::unique_ptr<block[]>(new block[( size + 63u ) / 64u]);
+  }
+
+  template<typename Array>
+  void check_copy(const Array &original, Array &copy, const std::vector<typename Array::id_type> &IDs,
+                  const std::vector<typename Array::id_type> &stale)
+  {
+    check(copy.size() == original.size(), "the copy has every object");
+    for (const auto &ID : IDs)
+    {
+      const particle *object{ original.get_safely(ID) };
+      const particle *copied{ copy.get_safely(ID) };
+      check(!object == !copied && ( !object || object->id == copied->id ), "IDs stay valid across a round trip");
+    }
+    for (const auto &ID : stale)
+    {
+      check(copy.get_safely(ID) == nullptr, "stale IDs stay stale across a round trip");
+    }
+    unsigned visited{ 0u };
+    for (const particle &object : copy)
+    {
+      static_cast<void>( object );
+      ++visited;
+    }
+    check(visited == copy.size(), "iteration visits every copied object");
+    for (int i{ 0 }; i < 200; ++i)
+    {
+      copy.free(copy.alloc(particle{ 0.0f, 0.0f, 0.0f, -i }));
+    }
+    check(copy.size() == original.size(), "the copy keeps allocating");
+  }
+
+  template<typename Array>
+  void test_round_trip()
+  {
+    static_assert(Array::snapshot_alignment == 64u, "block matches the alignment of the image.");
+    std::unique_ptr<Array> array{ new Array };
+    std::vector<typename Array::id_type> IDs, stale;
+    for (int i{ 0 }; i < 3000; ++i)
+    {
+      IDs.push_back(array->get_ID(array->alloc(particle{ float(i), 0.0f, 0.0f, i })));
+    }
+    for (unsigned i{ 0u }; i < 3000u; i += 4u)
+    {
+      stale.push_back(IDs[i]);
+      array->free(array->get(IDs[i]));
+    }
+    for (int i{ 0 }; i < 300; ++i)
+    {
+      IDs.push_back(array->get_ID(array->alloc(particle{ 0.0f, 0.0f, 0.0f, 5000 + i })));
+    }
+
+    const size_t size{ Array::snapshot_size() };
+    const auto image{ make_image(size) };
+    array->write_snapshot(image.get());
+    {
+      std::unique_ptr<Array> loaded{ new Array };
+      loaded->alloc(particle{});
+      check(loaded->load_snapshot(image.get(), size), "load_snapshot() accepts images of its type");
+      check_copy(*array, *loaded, IDs, stale);
+    }
+    {
+      // The adopted copy writes to the image, so it gets one of its own.
+      const auto adopted_image{ make_image(size) };
+      array->write_snapshot(adopted_image.get());
+      std::unique_ptr<Array> adopted{ new Array };
+      check(adopted->adopt_snapshot(adopted_image.get(), size), "adopt_snapshot() accepts images of its type");
+      check(adopted->get_memory_resource() == ADL::detail::adopted_resource(), "adopted storage is owned by the image");
+      check_copy(*array, *adopted, IDs, stale);
+    }
+
+    std::unique_ptr<Array> other{ new Array };
+    check(!other->load_snapshot(image.get(), size - 1u), "truncated images are refused");
+    check(!other->adopt_snapshot(image.get() + 1, size - 64u), "images without a header are refused");
+    image[0].bytes[4] ^= std::byte{ 1 };
+    check(!other->load_snapshot(image.get(), size), "images with a corrupt header are refused");
+    check(other->empty(), "refused images leave the slot_array untouched");
+  }
+
+  // In place storage can't adopt an image, but it loads one.
+  void test_in_place()
+  {
+    using array_type = ADL::slot_array<particle, 512, false>;
+    std::unique_ptr<array_type> array{ new array_type };
+    const auto ID{ array->get_ID(array->alloc(particle{ 1.0f, 2.0f, 3.0f, 4 })) };
+    const size_t size{ array_type::snapshot_size() };
+    const auto image{ make_image(size) };
+    array->write_snapshot(image.get());
+    std::unique_ptr<array_type> loaded{ new array_type };
+    check(loaded->load_snapshot(image.get(), size), "in place storage loads images");
+    const particle *object{ loaded->get_safely(ID) };
+    check(object && object->id == 4, "IDs stay valid across a round trip of in place storage");
+  }
+
+  // Images of one slot_array type are refused by the others.
+  void test_other_types()
+  {
+    using array_type = ADL::slot_array<particle, 64>;
+    std::unique_ptr<array_type> array{ new array_type };
+    array->alloc(particle{});
+    const size_t size{ array_type::snapshot_size() };
+    const auto image{ make_image(size) };
+    array->write_snapshot(image.get());
+    using split_type = ADL::slot_array<particle, 64, true, ADL::slot_layout::split>;
+    std::unique_ptr<split_type> split{ new split_type };
+    check(!split->load_snapshot(image.get(), size), "images of another layout are refused");
+  }
+}
+
+int main()
+{
+  test_round_trip<ADL::slot_array<particle, 4096>>();
+  test_round_trip<ADL::slot_array<particle, 4096, true, ADL::slot_layout::split>>();
+  test_round_trip<ADL::slot_array<particle, 4096, true, ADL::slot_layout::dense>>();
+  test_round_trip<ADL::slot_array<particle, 4096, true, ADL::slot_layout::in_place, ADL::slot_key_64>>();
+  test_in_place();
+  test_other_types();
+  return test_helpers::test_result();
+}
@@ -0,0 +1,99 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+//
+// Tests for the slot_key layouts of slot_array IDs. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined slot_key_test.cpp -o slot_key_test
+//
+// slot_arrays past the 64k elements of slot_key_32 are filled and churned with slot_key_64, and a narrow custom key
+// checks that the field widths follow the template arguments.
+#include <cstdint> // uint16_t, uint64_t
+#include <memory> // unique_ptr
+#include <vector>
+#include "../slot_array.hpp"
+#include "test_helpers.hpp"
+
+namespace
+{
+  using test_helpers::check;
+
+  static_assert(sizeof(ADL::slot_key_32::id_type) == 4u && ADL::slot_key_32::index_bits == 16u && ADL::slot_key_32::generation_bits == 15u,
+                "slot_key_32 packs 16 index bits and 15 generation bits below the liveness bit.");
+  static_assert(sizeof(ADL::slot_key_64::id_type) == 8u && ADL::slot_key_64::index_bits == 32u && ADL::slot_key_64::generation_bits == 31u,
+                "slot_key_64 packs 32 index bits and 31 generation bits below the liveness bit.");
+  static_assert(ADL::slot_key_64::max_elements == 0xFFFFFFFFu, "slot_key_64 indexes 4 billion elements.");
+  static_assert(sizeof(ADL::slot_key_32::index_type) == 2u && sizeof(ADL::slot_key_64::index_type) == 4u,
+                "Index tables use the smallest type which holds an index.");
+  static_assert(sizeof(ADL::slot_array<int>::id_type) == 4u, "slot_key_32 stays the default.");
+
+  // Fills a slot_array past 64k elements, frees every third object and reallocates them.
+  template<typename Array>
+  void test_large()
+  {
+    std::unique_ptr<Array> array{ new Array };
+    std::vector<typename Array::id_type> IDs;
+    for (unsigned i{ 0u }; i < array->capacity(); ++i)
+    {
+      IDs.push_back(array->get_ID(array->alloc(static_cast<uint64_t>( i ))));
+    }
+    check(( IDs.back() & ADL::slot_key_64::index_mask ) > 0xFFFFu, "indices past 64k fit in the ID");
+    std::vector<typename Array::id_type> stale;
+    for (unsigned i{ 0u }; i < array->capacity(); i += 3u)
+    {
+      array->free(array->get(IDs[i]));
+      stale.push_back(IDs[i]);
+    }
+    for (unsigned i{ 0u }; i < array->capacity(); i += 3u)
+    {
+      IDs[i] = array->get_ID(array->alloc(static_cast<uint64_t>( i )));
+    }
+    check(array->size() == array->capacity(), "freed slots are reused");
+    for (unsigned i{ 0u }; i < array->capacity(); ++i)
+    {
+      const uint64_t *object{ array->get_safely(IDs[i]) };
+      check(object && *object == i, "IDs past 64k find their objects");
+    }
+    for (const auto &ID : stale)
+    {
+      check(array->get_safely(ID) == nullptr, "IDs of reused slots past 64k are stale");
+    }
+    uint64_t sum{ 0u };
+    for (const uint64_t value : *array)
+    {
+      sum += value;
+    }
+    const uint64_t count{ array->capacity() };
+    check(sum == count * ( count - 1u ) / 2u, "iteration visits every object past 64k");
+  }
+
+  // 16 bit IDs with 8 index bits leave 7 bits for the generation, which wraps after 128 reuses of a slot.
+  void test_custom_widths()
+  {
+    using key_type = ADL::slot_key<uint16_t, 8u>;
+    static_assert(key_type::generation_bits == 7u && key_type::max_elements == 255u, "The fields follow the template arguments.");
+    ADL::slot_array<int, 200, true, ADL::slot_layout::in_place, key_type> array;
+    static_assert(sizeof(decltype(array)::id_type) == 2u, "The ID type is the one given to slot_key.");
+    for (int i{ 0 }; i < 199; ++i)
+    {
+      array.alloc(i);
+    }
+    const auto first{ array.get_ID(array.alloc(199)) };
+    auto ID{ first };
+    for (unsigned reuse{ 1u }; reuse < 128u; ++reuse)
+    {
+      array.free(array.get(ID));
+      ID = array.get_ID(array.alloc(static_cast<int>( reuse )));
+      check(( ID & key_type::index_mask ) == ( first & key_type::index_mask ) && array.get_safely(first) == nullptr,
+            "every reuse of a slot before the generation wraps makes the old ID stale");
+    }
+  }
+}
+
+int main()
+{
+  test_large<ADL::slot_array<uint64_t, 70000, true, ADL::slot_layout::in_place, ADL::slot_key_64>>();
+  test_large<ADL::slot_array<uint64_t, 70000, true, ADL::slot_layout::split, ADL::slot_key_64>>();
+  test_large<ADL::slot_array<uint64_t, 70000, true, ADL::slot_layout::dense, ADL::slot_key_64>>();
+  test_custom_widths();
+  return test_helpers::test_result();
+}
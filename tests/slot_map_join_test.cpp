@@ -0,0 +1,96 @@
+// Tests for slot_map_join. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined slot_map_join_test.cpp -o slot_map_join_test
+//
+// The maps share a key space by inserting the same entities in the same order, then erase different subsets of it,
+// and every join is checked against the intersection of the subsets.
+#include <random>
+#include <set>
+#include <vector>
+#include "../slot_map_join.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  struct transform {
+    float x;
+    unsigned id;
+  };
+
+  using key_type = slot_map<transform>::key_type;
+
+  void test_subsets( ) {
+    slot_map<transform> transforms;
+    paged_slot_map<double> weights;
+    slot_map<soa<int, float>> columns;
+    std::vector<key_type> keys;
+    for( unsigned i{ 0 }; i < 5000; ++i ) {
+      const key_type key{ transforms.insert( transform{ static_cast<float>( i ), i } ) };
+      check( weights.insert( static_cast<double>( i ) ) == key && columns.emplace( static_cast<int>( i ), static_cast<float>( i ) ) == key,
+             "mirrored maps hand out the same keys" );
+      keys.push_back( key );
+    }
+    std::mt19937 rng( 5 );
+    std::set<key_type> weighted, columned;
+    for( const key_type &key : keys ) {
+      if( rng( ) % 3 ) weighted.insert( key );
+      else weights.erase( key );
+      if( rng( ) % 5 ) columned.insert( key );
+      else columns.erase( key );
+    }
+
+    std::set<key_type> visited;
+    join_slot_maps( transforms, weights, columns ).for_each( [&]( const key_type &key, transform &t, double &weight, auto row ) {
+      check( visited.insert( key ).second, "every key is visited once" );
+      check( weighted.count( key ) && columned.count( key ), "only keys valid in every map are visited" );
+      check( t.id == static_cast<unsigned>( weight ) && row.template get<0>( ) == static_cast<int>( t.id ), "the elements of a key are passed together" );
+    } );
+    std::size_t expected{ 0 };
+    for( const key_type &key : keys ) expected += weighted.count( key ) && columned.count( key );
+    check( visited.size( ) == expected, "every key valid in every map is visited" );
+
+    const slot_map<transform> &const_transforms{ transforms };
+    check( join_slot_maps( weights, const_transforms ).count( ) == weighted.size( ), "the smallest map drives the join" );
+    check( join_slot_maps( transforms ).count( ) == transforms.size( ), "a join of one map visits every element" );
+    slot_map<transform> empty;
+    check( join_slot_maps( transforms, empty ).count( ) == 0, "a join with an empty map is empty" );
+  }
+
+  // The driver's keys name slots the other map has grown but never used. Their generation matches, so only the
+  // ownership check keeps the join from reading past the other map's elements.
+  void test_unused_slots( ) {
+    slot_map<int> sparse;
+    slot_map<int> dense;
+    std::vector<key_type> keys;
+    for( int i{ 0 }; i < 13; ++i ) keys.push_back( sparse.insert( i ) );
+    for( int i{ 0 }; i < 10; ++i ) sparse.erase( keys[ i ] );
+    for( int i{ 0 }; i < 10; ++i ) dense.insert( i );
+    join_slot_maps( sparse, dense ).for_each( [&]( const key_type &, int &, int & ) {
+      check( false, "keys of free slots are not visited" );
+    } );
+    check( join_slot_maps( dense, sparse ).count( ) == 0, "maps which share no keys have an empty join" );
+
+    // The dense map grows into the keys the sparse map holds, while slot 0, erased in both, has the same generation.
+    dense.erase( keys[ 0 ] );
+    std::set<key_type> shared;
+    for( int i{ 0 }; i < 4; ++i ) {
+      const key_type key{ dense.insert( 10 + i ) };
+      for( int j{ 10 }; j < 13; ++j ) {
+        if( keys[ j ] == key ) shared.insert( key );
+      }
+    }
+    std::size_t visited{ 0 };
+    join_slot_maps( sparse, dense ).for_each( [&]( const key_type &key, int &a, int &b ) {
+      check( shared.count( key ) && a == *sparse.find( key ) && b == *dense.find( key ), "only keys both maps issued are visited" );
+      ++visited;
+    } );
+    check( visited == shared.size( ), "every key both maps issued is visited" );
+  }
+}
+
+int main( ) {
+  test_subsets( );
+  test_unused_slots( );
+  return test_helpers::test_result( );
+}
@@ -0,0 +1,112 @@
+// Tests for the snapshots of slot_map. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined slot_map_snapshot_test.cpp -o slot_map_snapshot_test
+//
+// A churned map is written to an image and loaded into another map, which must find every live key, reject every
+// stale one and keep working. Truncated and corrupt images must be rejected without touching the map.
+#include <cstddef> // byte, size_t
+#include <memory> // unique_ptr
+#include <stdexcept> // invalid_argument
+#include <vector>
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  struct particle {
+    float x, y, z;
+    int id;
+  };
+
+  // Image buffers have to be aligned to snapshot_alignment.
+  struct alignas( 64 ) block {
+    std::byte bytes[ 64 ];
+  };
+
+  std::unique_ptr<block[ ]> make_image( std::size_t size ) { return std::unique_ptr<block[ ]>( new block[ ( size + 63 ) / 64 ] ); }
+
+  template<typename Map>
+  bool rejects( Map &map, const void *image, std::size_t size ) {
+    try { map.load_snapshot( image, size ); }
+    catch( const std::invalid_argument & ) { return true; }
+    return false;
+  }
+
+  template<typename Map>
+  void test_round_trip( ) {
+    using key_type = typename Map::key_type;
+    static_assert( Map::snapshot_alignment == 64, "block matches the alignment of the image." );
+    Map map;
+    std::vector<key_type> keys, stale;
+    for( int i{ 0 }; i < 5000; ++i ) keys.push_back( map.insert( particle{ float( i ), 0, 0, i } ) );
+    for( int i{ 0 }; i < 5000; i += 3 ) {
+      map.erase( keys[ i ] );
+      stale.push_back( keys[ i ] );
+    }
+    for( int i{ 0 }; i < 700; ++i ) keys.push_back( map.insert( particle{ float( i ), 1, 0, 10000 + i } ) );
+    map.compact_slots( );
+
+    const std::size_t size{ map.snapshot_size( ) };
+    const auto image{ make_image( size ) };
+    map.write_snapshot( image.get( ) );
+    Map loaded;
+    loaded.insert( particle{ } );
+    loaded.load_snapshot( image.get( ), size );
+    check( loaded.size( ) == map.size( ), "load_snapshot( ) replaces the contents of the map" );
+    for( const key_type &key : keys ) {
+      const auto original{ map.find( key ) };
+      const auto copy{ loaded.find( key ) };
+      check( ( original == map.end( ) ) == ( copy == loaded.end( ) ), "every key stays valid across a round trip" );
+      if( original != map.end( ) && copy != loaded.end( ) ) check( original->id == copy->id, "keys find the same elements" );
+    }
+    for( const key_type &key : stale ) check( loaded.find( key ) == loaded.end( ), "stale keys stay stale across a round trip" );
+
+    // The loaded free list and generations keep working.
+    for( int i{ 0 }; i < 3000; ++i ) {
+      const key_type key{ loaded.insert( particle{ 0, 0, 0, -i } ) };
+      check( loaded[ key ].id == -i, "the loaded map inserts" );
+      if( i % 2 ) loaded.erase( key );
+    }
+    for( const key_type &key : stale ) check( loaded.find( key ) == loaded.end( ), "reusing loaded slots keeps stale keys stale" );
+    for( const key_type &key : keys ) {
+      if( map.find( key ) != map.end( ) ) check( loaded.erase( key ) == 1, "the loaded map erases" );
+    }
+    check( loaded.size( ) == 1500, "only the elements inserted after loading remain" );
+
+    check( rejects( loaded, image.get( ), size - 64 ), "truncated images are rejected" );
+    check( rejects( loaded, image[ 0 ].bytes + 8, size - 8 ), "misaligned images are rejected" );
+    image[ 0 ].bytes[ 0 ] ^= std::byte{ 1 };
+    check( rejects( loaded, image.get( ), size ), "images with a corrupt header are rejected" );
+    check( loaded.size( ) == 1500, "rejected images leave the map untouched" );
+
+    const Map empty;
+    const std::size_t empty_size{ empty.snapshot_size( ) };
+    const auto empty_image{ make_image( empty_size ) };
+    empty.write_snapshot( empty_image.get( ) );
+    Map reloaded;
+    reloaded.load_snapshot( empty_image.get( ), empty_size );
+    const key_type key{ reloaded.insert( particle{ } ) };
+    check( reloaded.size( ) == 1 && reloaded.find( key ) != reloaded.end( ), "an empty map round trips" );
+  }
+
+  void test_other_types( ) {
+    slot_map<particle> map;
+    map.insert( particle{ } );
+    const std::size_t size{ map.snapshot_size( ) };
+    const auto image{ make_image( size ) };
+    map.write_snapshot( image.get( ) );
+    slot_map<particle, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::interleaved> interleaved;
+    check( rejects( interleaved, image.get( ), size ), "images of another layout are rejected" );
+    slot_map<particle, std::pair<unsigned short, unsigned short>> narrow;
+    check( rejects( narrow, image.get( ), size ), "images with another key type are rejected" );
+  }
+}
+
+int main( ) {
+  test_round_trip<slot_map<particle>>( );
+  test_round_trip<slot_map<particle, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::interleaved>>( );
+  test_round_trip<pmr_slot_map<particle>>( );
+  test_other_types( );
+  return test_helpers::test_result( );
+}
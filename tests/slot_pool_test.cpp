@@ -0,0 +1,137 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+//
+// Tests for slot_pool. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined slot_pool_test.cpp -o slot_pool_test
+//
+// Phases of growth and shrinking are checked against a std::map reference: blocks must be released once they empty
+// out past the retained blocks, and IDs into released blocks must be rejected after the blocks are reused.
+#include <cstdint> // uint64_t
+#include <iterator> // next
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "../slot_pool.hpp"
+#include "test_helpers.hpp"
+
+namespace
+{
+  using test_helpers::check;
+
+  template<typename Layout>
+  void test_phases()
+  {
+    test_helpers::counting_resource resource;
+    {
+      ADL::slot_pool<std::string, 64, Layout> pool(&resource);
+      std::map<uint64_t, std::string> reference;
+      std::vector<uint64_t> stale;
+      std::mt19937 rng(3);
+      for (int op{ 0 }; op < 60000; ++op)
+      {
+        const unsigned choice{ rng() % 10u };
+        const bool growing{ ( op / 5000 ) % 2 == 0 };
+        if (choice < ( growing ? 7u : 3u ) || reference.empty())
+        {
+          const std::string value{ std::to_string(rng()) + " padded past the small string buffer" };
+          std::string &object{ pool.alloc(value) };
+          const uint64_t ID{ pool.get_ID(object) };
+          check(reference.count(ID) == 0u && pool.get_safely(ID) == &object, "alloc() hands out fresh IDs");
+          reference[ID] = value;
+        }
+        else
+        {
+          const auto entry{ std::next(reference.begin(), rng() % reference.size()) };
+          if (rng() % 2u)
+          {
+            pool.free(entry->first);
+          }
+          else
+          {
+            pool.free(pool.get(entry->first));
+          }
+          stale.push_back(entry->first);
+          reference.erase(entry);
+        }
+        if (op % 997 == 0)
+        {
+          check(pool.size() == reference.size(), "the size matches the reference");
+          for (const auto &[ID, value] : reference)
+          {
+            std::string *object{ pool.get_safely(ID) };
+            check(object && *object == value && pool.get_ID(*object) == ID, "IDs find their objects");
+          }
+          for (const uint64_t ID : stale)
+          {
+            check(reference.count(ID) || pool.get_safely(ID) == nullptr, "IDs of freed objects are rejected");
+          }
+          unsigned visited{ 0u };
+          pool.for_each([&](std::string &) { ++visited; });
+          check(visited == reference.size(), "for_each() visits every live object");
+          check(pool.empty_blocks() <= pool.retained_blocks(), "blocks past the retained blocks are released");
+        }
+      }
+      check(pool.get_safely(0u) == nullptr && pool.get_safely(~uint64_t{ 0u }) == nullptr, "forged IDs are rejected");
+
+      while (!reference.empty())
+      {
+        pool.free(reference.begin()->first);
+        reference.erase(reference.begin());
+      }
+      check(pool.block_count() == 1u && pool.empty_blocks() == 1u, "an empty pool retains one block");
+      pool.trim();
+      check(pool.block_count() == 0u, "trim() releases every empty block");
+
+      std::vector<uint64_t> IDs;
+      for (int i{ 0 }; i < 300; ++i)
+      {
+        IDs.push_back(pool.get_ID(pool.alloc("x")));
+      }
+      pool.set_retained_blocks(3u);
+      for (const uint64_t ID : IDs)
+      {
+        pool.free(ID);
+      }
+      check(pool.block_count() == 3u && pool.empty_blocks() == 3u, "set_retained_blocks() sets how many empty blocks stay");
+      for (const uint64_t ID : IDs)
+      {
+        check(pool.get_safely(ID) == nullptr, "IDs into emptied blocks are rejected");
+      }
+      for (int i{ 0 }; i < 100; ++i)
+      {
+        pool.alloc("y");
+      }
+      pool.clear();
+      check(pool.empty() && pool.block_count() == 0u, "clear() releases every block");
+    }
+    check(resource.live == 0u, "every block is returned to the memory resource");
+  }
+
+  // With one element per block every free releases a block, and the next alloc reuses its table entry.
+  void test_reused_blocks()
+  {
+    ADL::slot_pool<int, 1> pool;
+    pool.set_retained_blocks(0u);
+    const uint64_t first{ pool.get_ID(pool.alloc(1)) };
+    pool.free(first);
+    check(pool.block_count() == 0u, "a block is released once it empties out");
+    const uint64_t second{ pool.get_ID(pool.alloc(2)) };
+    check(second != first && pool.get_safely(first) == nullptr, "IDs into a released block are rejected after the block is reused");
+    const int &third{ pool.alloc(3) };
+    check(pool.block_count() == 2u && *pool.get_safely(second) == 2 && third == 3, "alloc() adds a block when every block is full");
+    pool.free(second);
+    check(pool.block_count() == 1u && pool.get_safely(second) == nullptr && pool.get_safely(first) == nullptr,
+          "released blocks reject every ID they handed out");
+  }
+}
+
+int main()
+{
+  test_phases<ADL::slot_layout::in_place>();
+  test_phases<ADL::slot_layout::split>();
+  test_phases<ADL::slot_layout::dense>();
+  test_reused_blocks();
+  return test_helpers::test_result();
+}
@@ -0,0 +1,99 @@
+// Tests for slot_map<soa<Ts...>>, which stores each component in its own column. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined soa_storage_test.cpp -o soa_storage_test
+//
+// Random insertions, erasures and batches are checked against a std::map of tuples, and the columns are checked to
+// stay parallel: the element at position i of every column belongs to the same key.
+#include <iterator> // next
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits> // is_same
+#include <utility> // as_const
+#include <vector>
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  struct position {
+    float x, y;
+  };
+  struct velocity {
+    float x, y;
+  };
+
+  template<typename Map>
+  void test_churn( ) {
+    using key_type = typename Map::key_type;
+    using value_type = std::tuple<int, std::string>;
+    static_assert( std::is_same_v<typename Map::value_type, value_type>, "The value type of a soa map is the tuple of its components." );
+    Map map;
+    std::map<key_type, value_type> reference;
+    std::mt19937 rng( 5 );
+    for( int op{ 0 }; op < 20000; ++op ) {
+      const unsigned choice{ static_cast<unsigned>( rng( ) % 10 ) };
+      if( choice < 4 || reference.empty( ) ) {
+        const int value{ static_cast<int>( rng( ) % 1000 ) };
+        const key_type key{ choice % 2 ? map.emplace( value, std::to_string( value ) ) : map.insert( value_type( value, std::to_string( value ) ) ) };
+        reference[ key ] = value_type( value, std::to_string( value ) );
+      }
+      else if( choice < 7 ) {
+        const auto entry{ std::next( reference.begin( ), rng( ) % reference.size( ) ) };
+        check( map.erase( entry->first ) == 1, "erase( key ) erases live keys" );
+        reference.erase( entry );
+      }
+      else if( choice < 8 ) {
+        const auto first{ static_cast<typename Map::size_type>( rng( ) % map.size( ) ) };
+        const auto last{ static_cast<typename Map::size_type>( first + rng( ) % ( map.size( ) - first + 1 ) ) };
+        for( auto i{ first }; i != last; ++i ) reference.erase( map.key_at( i ) );
+        map.erase( map.begin( ) + first, map.begin( ) + last );
+      }
+      else {
+        std::vector<key_type> keys( 5 );
+        map.emplace_n( 5, []( typename Map::size_type i ) { return value_type( static_cast<int>( i ), "batch" ); }, keys.begin( ) );
+        for( int i{ 0 }; i < 5; ++i ) reference[ keys[ i ] ] = value_type( i, "batch" );
+      }
+      if( op % 200 == 0 ) {
+        check( map.size( ) == reference.size( ), "the size matches the reference" );
+        check( map.template column<0>( ).size( ) == map.size( ) && map.template column<1>( ).size( ) == map.size( ), "every column has an entry per element" );
+        for( const auto &[ key, value ] : reference ) {
+          const auto element{ map.find( key ) };
+          check( element != map.end( ) && *element == value, "find( ) returns every component of the element" );
+          const auto position{ static_cast<std::size_t>( element - map.begin( ) ) };
+          check( map.template column<0>( )[ position ] == std::get<0>( value ) && map.template column<1>( )[ position ] == std::get<1>( value ),
+                 "the columns stay parallel" );
+          const auto [ number, text ] = map.find_unchecked( key );
+          check( number == std::get<0>( value ) && text == std::get<1>( value ), "proxies support structured bindings" );
+        }
+      }
+    }
+
+    long column_sum{ 0 }, element_sum{ 0 };
+    for( const int value : map.template column<0>( ) ) column_sum += value;
+    for( const auto element : map ) element_sum += element.template get<0>( );
+    check( column_sum == element_sum, "a column holds the components in iteration order" );
+    for( int &value : map.template column<0>( ) ) value = 1;
+    for( const auto element : std::as_const( map ) ) check( element.template get<0>( ) == 1, "writes to a column are seen through the elements" );
+    for( auto element{ map.rbegin( ) }; element != map.rend( ); ++element ) ( *element ).template get<1>( ) = "written";
+    for( const auto [ number, text ] : map ) check( text == "written", "writes through proxies reach the column" );
+  }
+
+  void test_components( ) {
+    slot_map<soa<position, velocity>> map;
+    const auto key{ map.emplace( position{ 1, 2 }, velocity{ 3, 4 } ) };
+    map[ key ].get<0>( ).x += map[ key ].get<1>( ).x;
+    check( map.at( key ).get<0>( ).x == 4 && map.column<0>( ).size( ) == 1 && map.column<0>( )[ 0 ].y == 2, "components are stored by value in their columns" );
+    const std::tuple<position, velocity> copy = *map.begin( );
+    check( std::get<1>( copy ).y == 4, "a proxy converts to the value type" );
+  }
+}
+
+int main( ) {
+  test_churn<slot_map<soa<int, std::string>>>( );
+  test_churn<slot_map<soa<int, std::string>, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::interleaved>>( );
+  test_components( );
+  return test_helpers::test_result( );
+}
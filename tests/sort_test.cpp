@@ -0,0 +1,96 @@
+// Tests for sort( ), reorder( ) and the budgeted reorder( ) of slot_map. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined sort_test.cpp -o sort_test
+//
+// Every reordering must leave the elements in the requested order while every key keeps finding its element, and
+// a budgeted reorder has to reach the same order over many small steps that skip stale keys.
+#include <algorithm> // reverse
+#include <iterator> // back_inserter
+#include <random>
+#include <vector>
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  template<typename Map, typename Get, typename Make>
+  void test_orders( Get get, Make make ) {
+    using key_type = typename Map::key_type;
+    using size_type = typename Map::size_type;
+    Map map;
+    std::vector<key_type> keys;
+    std::vector<int> values;
+    std::mt19937 rng( 3 );
+    for( int i{ 0 }; i < 3000; ++i ) {
+      values.push_back( static_cast<int>( rng( ) % 100000 ) );
+      keys.push_back( make( map, values.back( ) ) );
+    }
+    for( std::size_t i{ 0 }; i < keys.size( ); i += 3 ) map.erase( keys[ i ] );
+    const auto check_keys = [&]( const char *message ) {
+      bool valid{ true };
+      for( std::size_t i{ 0 }; i < keys.size( ); ++i ) {
+        const auto element{ map.find( keys[ i ] ) };
+        valid = valid && ( i % 3 == 0 ? element == map.end( ) : element != map.end( ) && get( *element ) == values[ i ] );
+      }
+      check( valid, message );
+    };
+    const auto ordered = [&]( auto comp ) {
+      for( auto element{ map.begin( ) }; element + 1 < map.end( ); ++element ) {
+        if( comp( get( *( element + 1 ) ), get( *element ) ) ) return false;
+      }
+      return true;
+    };
+    const auto ascending = []( int a, int b ) { return a < b; };
+    const auto descending = []( int a, int b ) { return a > b; };
+
+    map.sort( [&]( const auto &a, const auto &b ) { return get( a ) < get( b ); } );
+    check( ordered( ascending ), "sort( ) orders the elements" );
+    check_keys( "keys follow their elements through sort( )" );
+
+    // Stale keys in the target are skipped.
+    std::vector<key_type> target;
+    map.sorted_keys( [&]( const auto &a, const auto &b ) { return get( a ) > get( b ); }, std::back_inserter( target ) );
+    check( target.size( ) == map.size( ), "sorted_keys( ) writes a key per element" );
+    target.insert( target.begin( ) + static_cast<std::ptrdiff_t>( target.size( ) / 2 ), keys[ 0 ] );
+    size_type position{ 0 };
+    std::size_t consumed{ 0 };
+    int calls{ 0 };
+    while( consumed < target.size( ) ) {
+      const size_type before{ position };
+      consumed += map.reorder( target.data( ) + consumed, static_cast<size_type>( target.size( ) - consumed ), position, 37 );
+      check( position >= before, "a budgeted reorder advances the position" );
+      ++calls;
+    }
+    check_keys( "keys follow their elements through a budgeted reorder" );
+    check( calls > 10 && position == map.size( ), "a budgeted reorder is spread over many calls" );
+    check( ordered( descending ), "a budgeted reorder reaches the order of sorted_keys( )" );
+
+    std::vector<size_type> order( map.size( ) );
+    for( size_type i{ 0 }; i < map.size( ); ++i ) order[ i ] = i;
+    std::reverse( order.begin( ), order.end( ) );
+    map.reorder( order.data( ) );
+    check( ordered( ascending ), "reorder( order ) applies the permutation" );
+    check_keys( "keys follow their elements through reorder( order )" );
+
+    bool reused{ true };
+    for( int i{ 0 }; i < 500; ++i ) {
+      const key_type key{ make( map, -i ) };
+      reused = reused && get( map[ key ] ) == -i;
+      map.erase( key );
+    }
+    check( reused, "a reordered map inserts and erases" );
+    check_keys( "inserting and erasing after reordering keeps the keys" );
+  }
+}
+
+int main( ) {
+  const auto get = []( const int &value ) { return value; };
+  const auto insert = []( auto &map, int value ) { return map.insert( value ); };
+  test_orders<slot_map<int>>( get, insert );
+  test_orders<slot_map<int, std::pair<unsigned, unsigned>, std::vector, slot_map_layout::interleaved>>( get, insert );
+  test_orders<paged_slot_map<int>>( get, insert );
+  test_orders<slot_map<soa<int, float>>>( []( const auto &element ) { return static_cast<int>( element.template get<0>( ) ); },
+                                          []( auto &map, int value ) { return map.emplace( value, 1.0f ); } );
+  return test_helpers::test_result( );
+}
@@ -0,0 +1,79 @@
+// Tests for static_slot_map. A plain executable, 0 on success; the constant expression tests fail to compile:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined static_slot_map_test.cpp -o static_slot_map_test
+//
+#include <stdexcept> // length_error
+#include <string>
+#include <type_traits> // is_trivially_destructible
+#include <vector>
+#include "../slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  // Inserts, erases, finds and iterates with the default key, in a constant expression.
+  constexpr int constant_round_trip( ) {
+    static_slot_map<int, 8> map;
+    using key_type = static_slot_map<int, 8>::key_type;
+    const key_type a{ map.insert( 1 ) };
+    const key_type b{ map.insert( 2 ) };
+    const key_type c{ map.emplace( 3 ) };
+    map.erase( b );
+    const key_type d{ map.insert( 4 ) };
+    if( map.find( b ) != map.end( ) || map.find( d ) == map.end( ) || map.size( ) != 3 ) return -1;
+    int sum{ 0 };
+    for( const int value : map ) sum += value;
+    return sum * 100 + map[ a ] * 10 + map.at( c ) + ( *map.find( d ) == 4 ? 0 : 1000 );
+  }
+  static_assert( constant_round_trip( ) == 813, "static_slot_map works in constant expressions" );
+
+  constexpr int constant_interleaved( ) {
+    static_slot_map<int, 4, static_slot_map<int, 4>::key_type, slot_map_layout::interleaved> map;
+    const auto first{ map.insert( 1 ) };
+    map.insert( 2 );
+    const auto third{ map.insert( 3 ) };
+    map.insert( 4 );
+    map.erase( first );
+    map.erase( third );
+    map.insert( 5 );
+    map.insert( 6 );
+    int sum{ 0 };
+    for( const int value : map ) sum += value;
+    return sum;
+  }
+  static_assert( constant_interleaved( ) == 17, "the interleaved layout works in constant expressions" );
+  static_assert( std::is_trivially_destructible_v<static_slot_map<int, 8>>, "static_slot_maps of trivial types are trivially destructible" );
+
+  void test_capacity( ) {
+    static_slot_map<std::string, 16> map;
+    using key_type = static_slot_map<std::string, 16>::key_type;
+    check( map.capacity( ) == 16 && map.capacity_slots( ) == 16, "every slot exists up front" );
+    std::vector<key_type> keys;
+    for( int i{ 0 }; i < 16; ++i ) keys.push_back( map.insert( std::to_string( i ) ) );
+    bool threw{ false };
+    try { map.insert( "full" ); }
+    catch( const std::length_error & ) { threw = true; }
+    check( threw && map.size( ) == 16, "inserting into a full map throws" );
+    threw = false;
+    try { map.reserve( 17 ); }
+    catch( const std::length_error & ) { threw = true; }
+    check( threw, "reserving past the capacity throws" );
+
+    for( int i{ 0 }; i < 16; i += 2 ) map.erase( keys[ i ] );
+    const auto copy{ map };
+    for( int i{ 0 }; i < 8; ++i ) map.insert( "new" );
+    for( int i{ 1 }; i < 16; i += 2 ) {
+      check( map.at( keys[ i ] ) == std::to_string( i ) && copy.at( keys[ i ] ) == std::to_string( i ), "erasing and copying keep the other keys" );
+    }
+    for( int i{ 0 }; i < 16; i += 2 ) check( copy.find( keys[ i ] ) == copy.end( ), "erased keys are stale" );
+    map.clear( );
+    check( map.empty( ) && map.capacity_slots( ) == 16, "clear( ) keeps the slots" );
+  }
+}
+
+int main( ) {
+  check( constant_round_trip( ) == 813 && constant_interleaved( ) == 17, "the constant expression tests run at run time too" );
+  test_capacity( );
+  return test_helpers::test_result( );
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic> // atomic
+#include <cstddef> // size_t
+#include <cstdio> // printf
+#include <memory_resource>
+
+// Shared by the tests in this directory. Each test is a plain executable: checks report failures as they happen and
+// main( ) returns test_result( ), 0 when every check passed.
+namespace test_helpers {
+  // Atomic so checks can run on several threads of a stress test.
+  inline std::atomic<int> failures{ 0 };
+
+  inline void check( bool condition, const char *message ) {
+    if( !condition ) {
+      std::printf( "FAILED: %s\n", message );
+      failures.fetch_add( 1, std::memory_order_relaxed );
+    }
+  }
+
+  // Prints the outcome, the exit code of the test.
+  inline int test_result( ) {
+    const bool passed{ failures.load( ) == 0 };
+    std::printf( "%s\n", passed ? "passed" : "FAILED" );
+    return passed ? 0 : 1;
+  }
+
+  // Forwards to new_delete_resource( ), counting allocations and the bytes outstanding.
+  class counting_resource : public std::pmr::memory_resource {
+  public:
+    std::size_t allocations{ 0 };
+    std::size_t live{ 0 };
+    std::size_t total{ 0 };
+
+  private:
+    void* do_allocate( std::size_t bytes, std::size_t alignment ) override {
+      ++allocations;
+      live += bytes;
+      total += bytes;
+      return std::pmr::new_delete_resource( )->allocate( bytes, alignment );
+    }
+    void do_deallocate( void *p, std::size_t bytes, std::size_t alignment ) override {
+      live -= bytes;
+      std::pmr::new_delete_resource( )->deallocate( p, bytes, alignment );
+    }
+    bool do_is_equal( const std::pmr::memory_resource &other ) const noexcept override { return this == &other; }
+  };
+}
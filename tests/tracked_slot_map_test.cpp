@@ -0,0 +1,122 @@
+// Tests for tracked_slot_map. A plain executable, 0 on success:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined tracked_slot_map_test.cpp -o tracked_slot_map_test
+//
+// The replication test applies every consumed change to a std::map replica and compares it with the tracked map,
+// which is what a consumer of the changes relies on.
+#include <map>
+#include <random>
+#include <stdexcept> // range_error
+#include <vector>
+#include "../tracked_slot_map.hpp"
+#include "test_helpers.hpp"
+
+namespace {
+  using test_helpers::check;
+
+  template<typename Map>
+  std::map<typename Map::key_type, slot_map_change> consume( Map &map ) {
+    std::map<typename Map::key_type, slot_map_change> changes;
+    map.consume_changes( [&changes]( const typename Map::key_type &key, slot_map_change change ) {
+      check( changes.count( key ) == 0, "a key was reported twice" );
+      changes[ key ] = change;
+    } );
+    return changes;
+  }
+
+  void test_changes( ) {
+    tracked_slot_map<slot_map<int>> map;
+    using key_type = tracked_slot_map<slot_map<int>>::key_type;
+    const key_type a{ map.insert( 1 ) }, b{ map.insert( 2 ) }, c{ map.emplace( 3 ) };
+    map[ a ] = 10;
+    auto changes{ consume( map ) };
+    check( changes.size( ) == 3 && changes[ a ] == slot_map_change::inserted && changes[ c ] == slot_map_change::inserted,
+           "insertions are reported as inserted, including modified ones" );
+    check( map.change_count( ) == 0, "consume_changes( ) forgets the changes" );
+
+    map.at( b ) = 20;
+    check( map.mark_dirty( c ), "mark_dirty( ) accepts a valid key" );
+    map.erase( a );
+    const key_type d{ map.insert( 4 ) };
+    const key_type e{ map.insert( 5 ) };
+    map.erase( e );
+    changes = consume( map );
+    check( changes.size( ) == 4 && changes[ b ] == slot_map_change::modified && changes[ c ] == slot_map_change::modified &&
+           changes[ a ] == slot_map_change::erased && changes[ d ] == slot_map_change::inserted,
+           "keys inserted and erased between consumes are not reported" );
+
+    check( !map.mark_dirty( a ) && map.erase( a ) == 0 && consume( map ).empty( ), "stale keys are not recorded" );
+    bool threw{ false };
+    try { map.at( a ); }
+    catch( const std::range_error & ) { threw = true; }
+    check( threw, "at( ) throws for stale keys" );
+  }
+
+  void test_clear_and_reinsert( ) {
+    tracked_slot_map<slot_map<int>> map;
+    using key_type = tracked_slot_map<slot_map<int>>::key_type;
+    const key_type a{ map.insert( 1 ) };
+    consume( map );
+
+    map.clear( );
+    const key_type b{ map.insert( 2 ) };
+    check( a != b, "a key inserted after clear( ) differs from the keys it erased" );
+    check( map.map( ).find( a ) == map.map( ).end( ), "keys from before clear( ) stay invalid" );
+    auto changes{ consume( map ) };
+    check( changes.size( ) == 2 && changes[ a ] == slot_map_change::erased && changes[ b ] == slot_map_change::inserted,
+           "clear( ) followed by an insertion reports both changes" );
+
+    map.insert( 3 );
+    map.insert( 4 );
+    map.clear( );
+    changes = consume( map );
+    check( changes.size( ) == 1 && changes[ b ] == slot_map_change::erased, "clear( ) reports every erased key once" );
+  }
+
+  void test_replication( ) {
+    using map_type = tracked_slot_map<paged_slot_map<int>>;
+    using key_type = map_type::key_type;
+    std::mt19937 rng( 7 );
+    map_type map;
+    std::map<key_type, int> replica;
+    std::vector<key_type> live;
+    for( int round{ 0 }; round < 200; ++round ) {
+      for( int op{ 0 }; op < 50; ++op ) {
+        const unsigned choice{ static_cast<unsigned>( rng( ) % 100 ) };
+        if( choice == 0 ) {
+          map.clear( );
+          live.clear( );
+        }
+        else if( choice < 30 || live.empty( ) ) live.push_back( map.insert( static_cast<int>( rng( ) ) ) );
+        else if( choice < 55 ) {
+          const std::size_t i{ rng( ) % live.size( ) };
+          map.erase( live[ i ] );
+          live[ i ] = live.back( );
+          live.pop_back( );
+        }
+        else if( choice < 80 ) map[ live[ rng( ) % live.size( ) ] ] = static_cast<int>( rng( ) );
+        else map.mark_dirty( live[ rng( ) % live.size( ) ] );
+      }
+      map.consume_changes( [&]( const key_type &key, slot_map_change change ) {
+        if( change == slot_map_change::erased ) {
+          check( replica.erase( key ) == 1, "an erased key was never reported as inserted" );
+        }
+        else {
+          check( ( replica.count( key ) == 0 ) == ( change == slot_map_change::inserted ), "an insertion was misreported" );
+          replica[ key ] = map.map( ).at( key );
+        }
+      } );
+      check( replica.size( ) == map.size( ), "the replica has as many elements as the map" );
+      for( const auto &[ key, value ] : replica ) {
+        check( map.contains( key ) && map.map( ).at( key ) == value, "the replica matches the map" );
+      }
+    }
+  }
+}
+
+int main( ) {
+  test_changes( );
+  test_clear_and_reinsert( );
+  test_replication( );
+  return test_helpers::test_result( );
+}
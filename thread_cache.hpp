@@ -0,0 +1,176 @@
+// Author: Allan Deutsch
+// All content copyright (C) Allan Deutsch 2015. All rights reserved.
+#pragma once
+#include <utility> // forward
+#include <cstdint> // uint64_t
+#include "concurrent_slot_array.hpp"
+#include "../Debugging/Asserts.hpp"
+namespace ADL
+{
+  /*
+  * @brief: thread_cache is a per-thread magazine of free slots in front of a concurrent_slot_array.
+  * Allocations and frees go through the magazine, and the shared free list is only touched once per batch:
+  * an empty magazine is refilled with half a magazine of slots in one exchange, and a full magazine returns half of
+  * its slots in one exchange.
+  *
+  * @param _Pool The concurrent_slot_array type being cached.
+  * @param _Magazine_Size The max number of free slots held by the cache. Defaults to 64.
+  *
+  * @note: A thread_cache must only be used by one thread at a time. Create one per worker thread.
+  * @note: Slots held in a magazine can't be allocated by other threads, so a pool may report saturation while up to\n
+  *        _Magazine_Size slots per cache are free. Call flush() to return them.
+  * @note: The hit/miss counters are plain integers owned by the cache, use them to size _Magazine_Size.
+  * @note: clear() on the pool hands every slot back to the free list, and the cache drops its magazine on its next
+  *        alloc(), free() or flush(). cached() reports the stale count until then.
+  */
+  template<typename _Pool, unsigned _Magazine_Size = 64u>
+  class thread_cache
+  {
+    static_assert(_Magazine_Size >= 2u, "A thread_cache magazine must be able to hold at least 2 slots.");
+  public:
+    using pool_type = _Pool;
+    using value_type = typename _Pool::value_type;
+    using id_type = typename _Pool::id_type;
+
+    struct statistics
+    {
+      uint64_t alloc_hits;   // allocations served from the magazine
+      uint64_t alloc_misses; // allocations which had to refill the magazine from the pool
+      uint64_t free_hits;    // frees which fit in the magazine
+      uint64_t free_misses;  // frees which had to return half of the magazine to the pool
+    };
+
+    explicit thread_cache(_Pool &pool);
+    thread_cache(const thread_cache &) = delete;
+    thread_cache& operator=(const thread_cache &) = delete;
+    ~thread_cache(); // returns every cached slot to the pool
+
+    template<typename... Args>
+    value_type* alloc(Args&&... args); // creates an element and returns a pointer to it. nullptr if the pool is saturated.
+    void free(value_type &);           // releases the object into the magazine.
+    void flush();                      // returns every cached slot to the pool.
+
+    inline _Pool& pool()                    const noexcept { return *m_pool; }
+    inline unsigned cached()                const noexcept { return m_count; }
+    inline const statistics& stats()        const noexcept { return m_stats; }
+    inline void reset_stats()                     noexcept { m_stats = statistics{}; }
+
+  private:
+    static const unsigned batch_size = _Magazine_Size / 2u;
+
+    void drop_if_cleared();
+
+    _Pool *m_pool;
+    unsigned m_epoch; // the clear epoch of the pool when the magazine was last known to be valid
+    unsigned m_count; // number of free slots in the magazine
+    unsigned m_magazine[_Magazine_Size]; // used as a stack, the most recently freed slot is reused first
+    statistics m_stats;
+  };
+
+  template<typename _Pool, unsigned _Magazine_Size>
+  thread_cache<_Pool, _Magazine_Size>::thread_cache(_Pool &pool)
+    : m_pool(&pool)
+    , m_epoch(pool.m_clear_epoch.load(std::memory_order_relaxed))
+    , m_count(0)
+    , m_stats()
+  {
+  }
+
+  template<typename _Pool, unsigned _Magazine_Size>
+  thread_cache<_Pool, _Magazine_Size>::~thread_cache()
+  {
+    flush();
+  }
+
+  /*
+  * @brief Allocates an object in the pool using a slot from the magazine.
+  * @detail Refills the magazine with a batch of slots in a single exchange on the pool's free list when it is empty.
+  *         If the constructor throws, the slot stays in the magazine.
+  * @param args Any arguments passed to the function will be forwarded to the constructor of the value_type.
+  * @return A pointer to the allocated object, or nullptr if both the magazine and the pool are out of slots.
+  */
+  template<typename _Pool, unsigned _Magazine_Size>
+  template<typename... Args>
+  typename thread_cache<_Pool, _Magazine_Size>::value_type* thread_cache<_Pool, _Magazine_Size>::alloc(Args&&... args)
+  {
+    drop_if_cleared();
+    if (m_count == 0u)
+    {
+      ++m_stats.alloc_misses;
+      m_count = m_pool->pop_free(m_magazine, batch_size);
+      if (m_count == 0u)
+      {
+        return nullptr;
+      }
+    }
+    else
+    {
+      ++m_stats.alloc_hits;
+    }
+    const unsigned index{ m_magazine[--m_count] };
+    try
+    {
+      return m_pool->construct(index, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      ++m_count;
+      throw;
+    }
+  }
+
+  /*
+  * @brief Destructs the referenced object and keeps its slot in the magazine for reuse by this thread.
+  * @detail Returns the older half of the magazine to the pool in a single exchange when it is full.
+  * @param object The object to be freed.
+  */
+  template<typename _Pool, unsigned _Magazine_Size>
+  void thread_cache<_Pool, _Magazine_Size>::free(value_type &object)
+  {
+    drop_if_cleared();
+    if (m_count == _Magazine_Size)
+    {
+      ++m_stats.free_misses;
+      // The bottom of the stack holds the slots which have gone unused the longest.
+      m_pool->push_free(m_magazine, batch_size);
+      for (unsigned i{ batch_size }; i < _Magazine_Size; ++i)
+      {
+        m_magazine[i - batch_size] = m_magazine[i];
+      }
+      m_count -= batch_size;
+    }
+    else
+    {
+      ++m_stats.free_hits;
+    }
+    m_magazine[m_count++] = m_pool->destroy(object);
+  }
+
+  /*
+  * @brief Returns every slot held in the magazine to the pool so other threads can allocate them.
+  */
+  template<typename _Pool, unsigned _Magazine_Size>
+  void thread_cache<_Pool, _Magazine_Size>::flush()
+  {
+    drop_if_cleared();
+    m_pool->push_free(m_magazine, m_count);
+    m_count = 0u;
+  }
+
+  /*
+  * @brief Forgets the magazine if the pool was cleared since it was filled.
+  * @detail clear() already relinked those slots into the free list, pushing them again would make it cyclic.
+  *         clear() must not race with the cache, so a relaxed load sees the epoch of the last clear().
+  */
+  template<typename _Pool, unsigned _Magazine_Size>
+  void thread_cache<_Pool, _Magazine_Size>::drop_if_cleared()
+  {
+    const unsigned epoch{ m_pool->m_clear_epoch.load(std::memory_order_relaxed) };
+    if (epoch != m_epoch)
+    {
+      m_epoch = epoch;
+      m_count = 0u;
+    }
+  }
+
+}
@@ -0,0 +1,196 @@
+#pragma once
+#include <cstddef> // size_t
+#include <algorithm> // max
+#include <tuple> // get
+#include <type_traits> // enable_if, is_same, decay
+#include <utility> // forward, move
+#include <vector>
+#include "slot_map.hpp"
+
+// What happened to a key since the changes of a tracked_slot_map were last consumed.
+enum class slot_map_change : unsigned char {
+  inserted = 1, // the key was inserted, and may also have been modified
+  modified = 2, // the element of a key which existed before was accessed mutably or marked dirty
+  erased = 4    // a key which existed before was erased, and may also have been modified first
+};
+
+// A slot_map which records the keys touched by insertions, erasures and mutable accesses, so changes since the last
+// consume_changes( ) can be visited in O(changes) instead of diffing every element, for replication and save deltas.
+// Changes are journaled once per key in the order keys were first touched; a per slot index into the journal merges
+// later events for the same key. Keys inserted and erased between two consumes are not reported at all.
+// Const access, lookups and iteration go through map( ). Mutable access is only available through the tracked members
+// below, so elements can't change without being recorded. Reordering the elements doesn't change any key, and isn't
+// a change.
+// Map is a slot_map type, such as slot_map<T> or paged_slot_map<T>.
+template<typename Map>
+class tracked_slot_map {
+public:
+  using map_type = Map;
+  using key_type = typename Map::key_type;
+  using size_type = typename Map::size_type;
+  using value_type = typename Map::value_type;
+  using reference = typename Map::reference;
+  using const_reference = typename Map::const_reference;
+
+  tracked_slot_map( ) = default;
+  // Forwards allocator to the slot_map, see slot_map( const Allocator & ).
+  template<typename Allocator, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Allocator>, tracked_slot_map>>>
+  explicit tracked_slot_map( const Allocator &allocator ) : m_map( allocator ) { }
+
+  // Read only access to the slot_map, for lookups and iteration
+  const Map& map( ) const { return m_map; }
+  bool empty( ) const { return m_map.empty( ); }
+  size_type size( ) const { return m_map.size( ); }
+  bool contains( const key_type &key ) const { return m_map.find( key ) != m_map.end( ); }
+
+  // Tracked modifiers
+  key_type insert( const_reference value );                     // O(1), O(N) when allocation is required
+  key_type insert( value_type &&value );                        // O(1), O(N) when allocation is required
+  template<typename... Args>
+  key_type emplace( Args&&... args );                           // O(1), O(N) when allocation is required
+  size_type erase( const key_type &key );                       // O(1), returns how many elements were erased
+  void clear( );                                                // O(N), every element is recorded as erased
+  // Mutable access, which records the key as modified. Throws std::range_error for invalid keys, like slot_map::at( ).
+  reference at( const key_type &key );                          // O(1)
+  reference operator[]( const key_type &key );                  // O(1)
+  // Records the key as modified if it is valid, for changes made through references obtained earlier.
+  bool mark_dirty( const key_type &key );                       // O(1), returns whether the key was valid
+
+  // Changes
+  size_type change_count( ) const;                              // O(1), journal entries, including reverted insertions
+  // Calls fn( key, change ) for every key changed since the last consume_changes( ), in the order keys were first
+  // touched. Erased keys are no longer valid in map( ).
+  template<typename Function>
+  void for_each_change( Function fn ) const;                    // O(changes)
+  // for_each_change( fn ), then forgets the changes.
+  template<typename Function>
+  void consume_changes( Function fn );                          // O(changes)
+  void discard_changes( );                                      // O(changes)
+
+private:
+  struct change_record {
+    key_type key;
+    unsigned char changes; // slot_map_change bits
+  };
+
+  Map m_map;
+  std::vector<change_record> m_journal;
+  // For every slot, 1 + the position in m_journal of the last record for a key of the slot, or 0.
+  std::vector<size_type> m_slot_records;
+
+  void record( const key_type &key, slot_map_change change );
+  static size_type slot_index( const key_type &key ) { return static_cast<size_type>( std::get<0>( key ) ); }
+};
+
+#pragma region modifiers_impl
+
+template<typename Map>
+typename tracked_slot_map<Map>::key_type tracked_slot_map<Map>::insert( const_reference value ) {
+  const key_type key{ m_map.insert( value ) };
+  this->record( key, slot_map_change::inserted );
+  return key;
+}
+
+template<typename Map>
+typename tracked_slot_map<Map>::key_type tracked_slot_map<Map>::insert( value_type &&value ) {
+  const key_type key{ m_map.insert( std::move( value ) ) };
+  this->record( key, slot_map_change::inserted );
+  return key;
+}
+
+template<typename Map>
+template<typename... Args>
+typename tracked_slot_map<Map>::key_type tracked_slot_map<Map>::emplace( Args&&... args ) {
+  const key_type key{ m_map.emplace( std::forward<Args>( args )... ) };
+  this->record( key, slot_map_change::inserted );
+  return key;
+}
+
+template<typename Map>
+typename tracked_slot_map<Map>::size_type tracked_slot_map<Map>::erase( const key_type &key ) {
+  const size_type erased{ static_cast<size_type>( m_map.erase( key ) ) };
+  if( erased ) this->record( key, slot_map_change::erased );
+  return erased;
+}
+
+template<typename Map>
+void tracked_slot_map<Map>::clear( ) {
+  for( size_type i{ 0 }; i < m_map.size( ); ++i ) this->record( m_map.key_at( i ), slot_map_change::erased );
+  m_map.clear( );
+}
+
+template<typename Map>
+typename tracked_slot_map<Map>::reference tracked_slot_map<Map>::at( const key_type &key ) {
+  reference value{ m_map.at( key ) };
+  this->record( key, slot_map_change::modified );
+  return value;
+}
+
+template<typename Map>
+typename tracked_slot_map<Map>::reference tracked_slot_map<Map>::operator[]( const key_type &key ) {
+  reference value{ m_map[ key ] };
+  this->record( key, slot_map_change::modified );
+  return value;
+}
+
+template<typename Map>
+bool tracked_slot_map<Map>::mark_dirty( const key_type &key ) {
+  if( !this->contains( key ) ) return false;
+  this->record( key, slot_map_change::modified );
+  return true;
+}
+
+#pragma endregion
+
+#pragma region changes_impl
+
+template<typename Map>
+typename tracked_slot_map<Map>::size_type tracked_slot_map<Map>::change_count( ) const {
+  return static_cast<size_type>( m_journal.size( ) );
+}
+
+template<typename Map>
+template<typename Function>
+void tracked_slot_map<Map>::for_each_change( Function fn ) const {
+  constexpr unsigned char inserted{ static_cast<unsigned char>( slot_map_change::inserted ) };
+  constexpr unsigned char erased{ static_cast<unsigned char>( slot_map_change::erased ) };
+  for( const change_record &record : m_journal ) {
+    // inserted wins over modified, and erased over modified. Both means the key never existed outside this window.
+    if( ( record.changes & inserted ) && ( record.changes & erased ) ) continue;
+    else if( record.changes & inserted ) fn( record.key, slot_map_change::inserted );
+    else if( record.changes & erased ) fn( record.key, slot_map_change::erased );
+    else fn( record.key, slot_map_change::modified );
+  }
+}
+
+template<typename Map>
+template<typename Function>
+void tracked_slot_map<Map>::consume_changes( Function fn ) {
+  this->for_each_change( fn );
+  this->discard_changes( );
+}
+
+template<typename Map>
+void tracked_slot_map<Map>::discard_changes( ) {
+  for( const change_record &record : m_journal ) m_slot_records[ slot_index( record.key ) ] = 0;
+  m_journal.clear( );
+}
+
+#pragma endregion
+
+#pragma region helpers_impl
+
+template<typename Map>
+void tracked_slot_map<Map>::record( const key_type &key, slot_map_change change ) {
+  // A slot is reused by keys of later generations, which get records of their own.
+  const size_type slot{ slot_index( key ) };
+  if( slot >= m_slot_records.size( ) ) m_slot_records.resize( std::max<std::size_t>( m_map.capacity_slots( ), slot + std::size_t{ 1 } ) );
+  size_type &position{ m_slot_records[ slot ] };
+  if( position == 0 || m_journal[ position - 1 ].key != key ) {
+    m_journal.push_back( change_record{ key, 0 } );
+    position = static_cast<size_type>( m_journal.size( ) );
+  }
+  m_journal[ position - 1 ].changes |= static_cast<unsigned char>( change );
+}
+
+#pragma endregion